@@ -0,0 +1,324 @@
+#pragma once
+/**
+ * @file	Accuracy.hpp
+ * @author	radj307
+ * @brief	Differential accuracy & speed report for alternative numeric paths. This is used by the ckconv_accuracy test program.
+ * @details	Every path converts the same corpus of unit pairs & values, and is compared against the reference path *(conv::convert() in-
+ *\n		 -long double, formatted by format_fp())*. The corpus is deterministic, & is made up of:
+ *\n		  - generated samples; random pairs of units with the same dimension *(including every SI prefix from yocto to yotta)*,-
+ *\n		     -with values that have a full-precision mantissa & an exponent between 1e-30 & 1e30.
+ *\n		  - adversarial samples; zero, denormals, the largest & smallest finite values, values that overflow double, & values with-
+ *\n		     -many decimal places, each converted between the most extreme SI prefixes & some random pairs.
+ *\n		For each path, the report shows the largest error in units in the last place *(of the path's own precision)*, the largest-
+ *\n		 -relative error, how many results overflowed or underflowed differently, how many results format differently, & throughput.
+ */
+#include "conv.hpp"
+#include "global.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace ckconv::accuracy {
+	/// @brief	Seed for the generated corpus, so every run uses the same samples.
+	inline constexpr uint64_t SEED{ 307 };
+	/// @brief	Number of generated samples when the number isn't specified.
+	inline constexpr size_t DEFAULT_SAMPLE_COUNT{ 100000 };
+	/// @brief	Number of random unit pairs that each adversarial value is converted between.
+	inline constexpr size_t ADVERSARIAL_PAIRS{ 64 };
+	/// @brief	Minimum number of conversions that each path is timed over.
+	inline constexpr size_t MIN_TIMED_CONVERSIONS{ 1000000 };
+
+	/**
+	 * @struct	Sample
+	 * @brief	One conversion in the corpus.
+	 */
+	struct Sample {
+		const conv::Unit* in;
+		const conv::Unit* out;
+		conv::number_t value;
+		/// @brief	The factor between the units, for paths that multiply by a precomputed factor.
+		conv::number_t factor;
+	};
+
+	/**
+	 * @class	Corpus
+	 * @brief	Every built-in unit *(with each SI prefix & dimension)*, & the samples converted between them.
+	 */
+	class Corpus {
+		/// @brief	Units grouped by dimension; index 0 is length.
+		std::array<std::vector<conv::Unit>, conv::MAX_DIMENSION> units;
+		std::mt19937_64 rng{ SEED };
+
+		conv::Unit const& randomUnit(const unsigned dimension)
+		{
+			auto& group{ units[dimension - 1] };
+			return group[std::uniform_int_distribution<size_t>{ 0, group.size() - 1 }(rng)];
+		}
+		void add(conv::Unit const& in, conv::Unit const& out, const conv::number_t value)
+		{
+			samples.emplace_back(Sample{ &in, &out, value, conv::getConversionFactor(in, out) });
+		}
+
+	public:
+		std::vector<Sample> samples;
+		size_t generatedCount{ 0 }, adversarialCount{ 0 };
+
+		Corpus(const size_t count)
+		{
+			for (const auto* system : conv::BuiltinSystems) {
+				for (const auto& unit : system->units) {
+					for (unsigned dim{ 1 }; dim <= conv::MAX_DIMENSION; ++dim) {
+						units[dim - 1].emplace_back(unit.WithDimension(dim));
+						if (system->siPrefixable)
+							for (const auto& prefix : conv::SI_PREFIXES)
+								units[dim - 1].emplace_back(unit.ApplyPrefix(prefix).WithDimension(dim));
+					}
+				}
+			}
+			// the samples point to the units, so no units can be added after this
+			samples.reserve(count);
+
+			std::uniform_real_distribution<long double> mantissa{ 1.0L, 10.0L };
+			std::uniform_int_distribution<int> exponent{ -30, 30 };
+			std::uniform_int_distribution<unsigned> dimension{ 1, conv::MAX_DIMENSION };
+			std::bernoulli_distribution negative{ 0.1 };
+			for (size_t i{ 0 }; i < count; ++i) {
+				const unsigned dim{ dimension(rng) };
+				const auto& in{ randomUnit(dim) };
+				const auto& out{ randomUnit(dim) };
+				const conv::number_t value{ mantissa(rng) * conv::pow10(exponent(rng)) };
+				add(in, out, negative(rng) ? -value : value);
+			}
+			generatedCount = samples.size();
+
+			using limits = std::numeric_limits<conv::number_t>;
+			std::vector<conv::number_t> values{
+				0.0L, -0.0L, 1.0L, -1.0L,
+				limits::denorm_min(), limits::min(), limits::min() / 3.0L,
+				limits::max(), limits::max() / 1e6L, limits::lowest(),
+				1e-300L, 1e300L, 1e-320L, 1e-4000L, 1e4000L,
+				0.1L, 0.05L, 0.005L, 0.5L, 1.0L / 3.0L, 2.0L / 3.0L,
+				0.123456789012345678901L, 123456789.987654321L, 999999.5L, 9.99999999999999999e17L,
+			};
+			for (int e{ -24 }; e <= 24; e += 3)
+				values.emplace_back(conv::pow10(e));
+
+			const auto& findPrefixed{ [this](const unsigned dim, const conv::SIPrefix prefix) -> const conv::Unit* {
+				for (const auto& unit : units[dim - 1])
+					if (unit.GetPrefix() == prefix && unit.GetSystemID() == conv::SystemID::METRIC)
+						return &unit;
+				return nullptr;
+			} };
+			for (const auto& value : values) {
+				for (unsigned dim{ 1 }; dim <= conv::MAX_DIMENSION; ++dim) {
+					const auto* yocto{ findPrefixed(dim, conv::SIPrefix::YOCTO) }, * yotta{ findPrefixed(dim, conv::SIPrefix::YOTTA) };
+					if (yocto != nullptr && yotta != nullptr) {
+						add(*yocto, *yotta, value);
+						add(*yotta, *yocto, value);
+					}
+				}
+				for (size_t i{ 0 }; i < ADVERSARIAL_PAIRS; ++i) {
+					const unsigned dim{ dimension(rng) };
+					const auto& in{ randomUnit(dim) };
+					add(in, randomUnit(dim), value);
+				}
+			}
+			adversarialCount = samples.size() - generatedCount;
+		}
+
+		size_t getUnitCount() const noexcept
+		{
+			size_t count{ 0 };
+			for (const auto& group : units)
+				count += group.size();
+			return count;
+		}
+	};
+
+	/// @brief	Gets the distance between a result & the reference, in units in the last place of the result's type.
+	template<std::floating_point T>
+	inline long double getULPError(const long double reference, const T value)
+	{
+		const T ref{ static_cast<T>(reference) };
+		if (std::isnan(ref) || std::isnan(value))
+			return std::isnan(ref) && std::isnan(value) ? 0.0L : std::numeric_limits<long double>::infinity();
+		if (std::isinf(ref) || std::isinf(value))
+			return ref == value ? 0.0L : std::numeric_limits<long double>::infinity();
+		const T magnitude{ std::abs(ref) };
+		const T ulp{ std::nextafter(magnitude, std::numeric_limits<T>::max()) - magnitude };
+		if (ulp == T{ 0 }) // ref is the largest finite value
+			return ref == value ? 0.0L : std::numeric_limits<long double>::infinity();
+		return std::abs(static_cast<long double>(value) - reference) / static_cast<long double>(ulp);
+	}
+
+	/**
+	 * @struct	PathResult
+	 * @brief	The accuracy & speed of one path.
+	 */
+	struct PathResult {
+		std::string name;
+		long double maxULP{ 0.0L }, maxRelative{ 0.0L };
+		/// @brief	The largest error in ULPs of the generated samples. The adversarial samples include subnormal results, which have-
+		///			 -fewer significant bits, so their errors in ULPs are expected to be large.
+		long double maxGeneratedULP{ 0.0L };
+		/// @brief	Results that are finite when the reference isn't, or vice versa.
+		size_t rangeErrors{ 0 };
+		/// @brief	Results that format differently than the reference.
+		size_t formatErrors{ 0 };
+		/// @brief	The sample with the largest error in ULPs.
+		const Sample* worst{ nullptr };
+		double conversionsPerSecond{ 0.0 };
+	};
+
+	/**
+	 * @brief				Measures one path against the reference results.
+	 * @param name			The name of the path.
+	 * @param samples		The corpus.
+	 * @param references	The result of the reference path for each sample.
+	 * @param generated		The number of generated samples, which come before the adversarial samples.
+	 * @param convert		Function that converts a sample. Its return type is the precision of the path.
+	 * @returns				PathResult
+	 */
+	template<typename TFunc>
+	inline PathResult measure(std::string name, std::vector<Sample> const& samples, std::vector<long double> const& references, const size_t generated, TFunc&& convert)
+	{
+		PathResult result{ std::move(name) };
+
+		for (size_t i{ 0 }; i < samples.size(); ++i) {
+			const auto value{ convert(samples[i]) };
+			const long double reference{ references[i] };
+
+			if (std::isfinite(reference) != std::isfinite(static_cast<long double>(value)))
+				++result.rangeErrors;
+			else if (std::isfinite(reference)) {
+				const auto& ulp{ getULPError(reference, value) };
+				if (ulp > result.maxULP || result.worst == nullptr) {
+					result.maxULP = ulp;
+					result.worst = &samples[i];
+				}
+				if (i < generated)
+					result.maxGeneratedULP = std::max(result.maxGeneratedULP, ulp);
+				if (reference != 0.0L)
+					result.maxRelative = std::max(result.maxRelative, std::abs((static_cast<long double>(value) - reference) / reference));
+			}
+			if (format_fp(static_cast<long double>(value)) != format_fp(reference))
+				++result.formatErrors;
+		}
+
+		// the results are summed so the loop can't be optimized away
+		const size_t passes{ std::max<size_t>(1, MIN_TIMED_CONVERSIONS / std::max<size_t>(1, samples.size())) };
+		volatile long double sink{ 0.0L };
+		const auto& begin{ std::chrono::steady_clock::now() };
+		for (size_t pass{ 0 }; pass < passes; ++pass) {
+			long double sum{ 0.0L };
+			for (const auto& sample : samples)
+				sum += static_cast<long double>(convert(sample));
+			sink = sink + sum;
+		}
+		const std::chrono::duration<double> elapsed{ std::chrono::steady_clock::now() - begin };
+		result.conversionsPerSecond = static_cast<double>(passes * samples.size()) / elapsed.count();
+		return result;
+	}
+
+	/**
+	 * @struct	Report
+	 * @brief	The results of every path, for checking them against thresholds after the report is printed.
+	 */
+	struct Report {
+		std::vector<PathResult> paths;
+		/// @brief	Values that append_fp() formats differently than format_fp().
+		size_t appendFormatErrors{ 0 };
+	};
+
+	/**
+	 * @brief		Converts the corpus with every path, & prints the report.
+	 * @param os	Output stream.
+	 * @param count	The number of generated samples.
+	 * @returns		Report
+	 */
+	inline Report printReport(std::ostream& os, const size_t count = DEFAULT_SAMPLE_COUNT)
+	{
+		const Corpus corpus{ count };
+		const auto& samples{ corpus.samples };
+
+		std::vector<long double> references;
+		references.reserve(samples.size());
+		for (const auto& sample : samples)
+			references.emplace_back(conv::convert(*sample.in, sample.value, *sample.out));
+
+		std::vector<PathResult> results{
+			measure("convert (reference)", samples, references, corpus.generatedCount, [](Sample const& s) { return conv::convert(*s.in, s.value, *s.out); }),
+			measure("factor", samples, references, corpus.generatedCount, [](Sample const& s) { return s.value * s.factor; }),
+			measure("convert -> double", samples, references, corpus.generatedCount, [](Sample const& s) { return static_cast<double>(conv::convert(*s.in, s.value, *s.out)); }),
+			measure("factor (double)", samples, references, corpus.generatedCount, [](Sample const& s) { return static_cast<double>(s.value) * static_cast<double>(s.factor); }),
+			measure("factor (float)", samples, references, corpus.generatedCount, [](Sample const& s) { return static_cast<float>(s.value) * static_cast<float>(s.factor); }),
+		};
+
+		os << "Accuracy (" << samples.size() << " conversions: " << corpus.generatedCount << " generated, " << corpus.adversarialCount << " adversarial; " << corpus.getUnitCount() << " units):\n"
+			<< "  Path                  Max ULP       Generated ULP Max Relative  Range Errors  Format Diffs  Conversions/s\n"
+			<< "  ---------------------------------------------------------------------------------------------------------\n";
+		for (const auto& r : results) {
+			os << "  " << std::left << std::setw(22) << r.name
+				<< std::setw(14) << std::setprecision(4) << static_cast<double>(r.maxULP)
+				<< std::setw(14) << std::setprecision(4) << static_cast<double>(r.maxGeneratedULP)
+				<< std::setw(14) << std::setprecision(4) << static_cast<double>(r.maxRelative)
+				<< std::setw(14) << r.rangeErrors
+				<< std::setw(14) << r.formatErrors
+				<< std::scientific << std::setprecision(3) << r.conversionsPerSecond << std::defaultfloat
+				<< std::right << '\n';
+		}
+		os << "  Worst samples (by ULP):\n";
+		for (const auto& r : results) {
+			if (r.worst == nullptr || r.maxULP == 0.0L)
+				continue;
+			os << "    " << std::left << std::setw(22) << r.name << std::right << std::setprecision(21) << r.worst->value << ' '
+				<< format_unit(*r.worst->in, true) << " -> " << format_unit(*r.worst->out, true) << std::defaultfloat << std::setprecision(6) << '\n';
+		}
+
+		// formatting paths; append_fp() is compared to format_fp() using the reference results
+		size_t formatErrors{ 0 };
+		std::string buffer;
+		for (const auto& reference : references) {
+			buffer.clear();
+			append_fp(buffer, reference);
+			if (buffer != format_fp(reference))
+				++formatErrors;
+		}
+		const auto& time{ [&references](auto&& format) {
+			const size_t passes{ std::max<size_t>(1, MIN_TIMED_CONVERSIONS / 10 / std::max<size_t>(1, references.size())) };
+			size_t length{ 0 };
+			const auto& begin{ std::chrono::steady_clock::now() };
+			for (size_t pass{ 0 }; pass < passes; ++pass)
+				for (const auto& reference : references)
+					length += format(reference);
+			const std::chrono::duration<double> elapsed{ std::chrono::steady_clock::now() - begin };
+			volatile size_t sink{ length };
+			(void)sink;
+			return static_cast<double>(passes * references.size()) / elapsed.count();
+		} };
+		const double formatRate{ time([](const long double value) { return format_fp(value).size(); }) };
+		const double appendRate{ time([&buffer](const long double value) {
+			buffer.clear();
+			append_fp(buffer, value);
+			return buffer.size();
+		}) };
+
+		os << "Formatting (" << references.size() << " values, using the current notation & precision options):\n"
+			<< "  Path                  Format Diffs  Values/s\n"
+			<< "  --------------------------------------------\n"
+			<< "  " << std::left << std::setw(22) << "format_fp (reference)" << std::setw(14) << 0 << std::scientific << std::setprecision(3) << formatRate << std::defaultfloat << std::right << '\n'
+			<< "  " << std::left << std::setw(22) << "append_fp" << std::setw(14) << formatErrors << std::scientific << std::setprecision(3) << appendRate << std::defaultfloat << std::right << '\n';
+		os << std::setprecision(6);
+		return { std::move(results), formatErrors };
+	}
+}
@@ -0,0 +1,356 @@
+#pragma once
+/**
+ * @file	Aggregate.hpp
+ * @author	radj307
+ * @brief	Accumulates summary statistics for a stream of conversions, instead of printing each result.
+ */
+#include "conv.hpp"
+#include "global.h"
+#include "util.h"
+
+#include <indentor.hpp>
+#include <make_exception.hpp>
+#include <str.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <ranges>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace ckconv {
+	/// @brief	A summary statistic that can be requested with --aggregate.
+	enum class Statistic : unsigned char {
+		SUM,
+		MIN,
+		MAX,
+		MEAN,
+		COUNT,
+		HIST,
+	};
+
+	/**
+	 * @struct	AggregateSpec
+	 * @brief	The statistics requested by the user, in the order that they should be printed.
+	 */
+	struct AggregateSpec {
+		/// @brief	The default number of histogram bins.
+		static constexpr size_t DEFAULT_BINS{ 10 };
+
+		std::vector<Statistic> statistics;
+		size_t bins{ DEFAULT_BINS };
+
+		/**
+		 * @brief		Parses a comma-separated list of statistics, i.e. "sum,min,max,mean,count,hist".
+		 *\n			The number of histogram bins can be specified with "hist:<#>".
+		 * @param s		Input string.
+		 * @returns		AggregateSpec
+		 */
+		static AggregateSpec parse(std::string const& s)
+		{
+			AggregateSpec spec;
+			for (const auto& it : str::split_all(s, ",")) {
+				const auto& name{ str::tolower(str::trim(it, " \t\v\r\n"s)) };
+				if (name.empty())
+					continue;
+				Statistic stat;
+				if (name == "sum" || name == "total")
+					stat = Statistic::SUM;
+				else if (name == "min")
+					stat = Statistic::MIN;
+				else if (name == "max")
+					stat = Statistic::MAX;
+				else if (name == "mean" || name == "avg" || name == "average")
+					stat = Statistic::MEAN;
+				else if (name == "count")
+					stat = Statistic::COUNT;
+				else if (name == "hist" || name.starts_with("hist:")) {
+					stat = Statistic::HIST;
+					if (const auto pos{ name.find(':') }; pos != std::string::npos) {
+						spec.bins = static_cast<size_t>(std::stoull(name.substr(pos + 1)));
+						if (spec.bins == 0)
+							throw make_exception("The number of histogram bins must be greater than zero!");
+					}
+				}
+				else throw make_exception("Invalid statistic '", name, "'; expected 'sum', 'min', 'max', 'mean', 'count', or 'hist[:<BINS>]'!");
+
+				if (std::find(spec.statistics.begin(), spec.statistics.end(), stat) == spec.statistics.end())
+					spec.statistics.emplace_back(stat);
+			}
+			if (spec.statistics.empty())
+				throw make_exception("No statistics were specified for the --aggregate option!");
+			return spec;
+		}
+	};
+
+	/**
+	 * @struct	Accumulator
+	 * @brief	Mergeable running sum, minimum, maximum, & count of a set of values.
+	 *\n		The sum uses Neumaier's compensated summation, so the result doesn't depend much on the order of the values, and-
+	 *\n		 -partial results from separate threads can be merged without losing precision.
+	 */
+	struct Accumulator {
+		conv::number_t sum{ 0.0L };
+		conv::number_t compensation{ 0.0L };
+		conv::number_t min{ std::numeric_limits<conv::number_t>::infinity() };
+		conv::number_t max{ -std::numeric_limits<conv::number_t>::infinity() };
+		size_t count{ 0 };
+
+		/// @brief	Adds a value to the compensated sum.
+		void addToSum(const conv::number_t value) noexcept
+		{
+			const conv::number_t t{ sum + value };
+			// branchless form of Neumaier's correction, so the block loop below can be vectorized
+			compensation += (std::abs(sum) >= std::abs(value)) ? ((sum - t) + value) : ((value - t) + sum);
+			sum = t;
+		}
+
+		/// @brief	Adds a single value.
+		void add(const conv::number_t value) noexcept
+		{
+			addToSum(value);
+			min = std::min(min, value);
+			max = std::max(max, value);
+			++count;
+		}
+
+		/**
+		 * @brief			Adds a contiguous block of values.
+		 *\n				Values are distributed across independent lanes so there are no loop-carried dependencies between adjacent values.
+		 * @param values	Pointer to the first value.
+		 * @param size		The number of values.
+		 */
+		void add(const conv::number_t* const values, const size_t size) noexcept
+		{
+			constexpr size_t LANES{ 4 };
+			std::array<Accumulator, LANES> lanes{};
+
+			size_t i{ 0 };
+			for (; i + LANES <= size; i += LANES)
+				for (size_t lane{ 0 }; lane < LANES; ++lane)
+					lanes[lane].add(values[i + lane]);
+			for (; i < size; ++i)
+				lanes[0].add(values[i]);
+
+			for (const auto& lane : lanes)
+				merge(lane);
+		}
+
+		/// @brief	Merges another accumulator into this one.
+		void merge(Accumulator const& other) noexcept
+		{
+			if (other.count == 0)
+				return;
+			addToSum(other.sum);
+			compensation += other.compensation;
+			min = std::min(min, other.min);
+			max = std::max(max, other.max);
+			count += other.count;
+		}
+
+		/// @brief	Gets the compensated sum.
+		constexpr conv::number_t total() const noexcept { return sum + compensation; }
+		/// @brief	Gets the arithmetic mean, or NaN if there aren't any values.
+		constexpr conv::number_t mean() const noexcept { return count == 0 ? std::numeric_limits<conv::number_t>::quiet_NaN() : total() / static_cast<conv::number_t>(count); }
+	};
+
+	/**
+	 * @struct	Histogram
+	 * @brief	Mergeable histogram with evenly-sized bins between a minimum & maximum value.
+	 */
+	struct Histogram {
+		conv::number_t min, max;
+		std::vector<size_t> bins;
+
+		Histogram(const conv::number_t min, const conv::number_t max, const size_t binCount) : min{ min }, max{ max }, bins(binCount, 0) {}
+
+		/// @brief	Gets the width of each bin.
+		conv::number_t width() const noexcept { return (max - min) / static_cast<conv::number_t>(bins.size()); }
+
+		/// @brief	Adds a contiguous block of values. Values outside of the range are clamped to the first or last bin.
+		void add(const conv::number_t* const values, const size_t size) noexcept
+		{
+			const conv::number_t w{ width() };
+			const size_t last{ bins.size() - 1 };
+			for (size_t i{ 0 }; i < size; ++i) {
+				const conv::number_t pos{ w > 0.0L ? (values[i] - min) / w : 0.0L };
+				++bins[pos <= 0.0L ? 0 : std::min(static_cast<size_t>(pos), last)];
+			}
+		}
+
+		void merge(Histogram const& other) noexcept
+		{
+			for (size_t i{ 0 }; i < bins.size(); ++i)
+				bins[i] += other.bins[i];
+		}
+	};
+
+	/**
+	 * @class	Aggregator
+	 * @brief	Converts a stream of conversions & groups the results by output unit. The sum, minimum, maximum, mean, & count are-
+	 *\n		 -accumulated as the values arrive; values are only kept when a histogram was requested, which is reduced in parallel.
+	 */
+	class Aggregator {
+		/// @brief	The number of values that each thread reduces at a time.
+		static constexpr size_t CHUNK_SIZE{ 65536 };
+		/// @brief	The number of values that are buffered before they're added to a group's accumulator as one block.
+		static constexpr size_t BLOCK_SIZE{ 4096 };
+
+		struct Group {
+			conv::Unit unit;
+			Accumulator acc{};
+			/// @brief	Values that haven't been added to the accumulator yet, so they can be added in blocks.
+			std::vector<conv::number_t> pending{};
+			/// @brief	Every value in the group; only used for histograms, since their range isn't known until the end.
+			std::vector<conv::number_t> values{};
+		};
+
+		AggregateSpec spec;
+		bool keepValues;
+		std::vector<Group> groups;
+
+		Group& getGroup(conv::Unit const& unit)
+		{
+			// conversions usually share an output unit, so check the most recent group first
+			for (auto it{ groups.rbegin() }; it != groups.rend(); ++it)
+				if (it->unit.GetSymbol() == unit.GetSymbol() && it->unit.GetFullName() == unit.GetFullName())
+					return *it;
+			return groups.emplace_back(Group{ unit });
+		}
+
+		/// @brief	Calls the given function for each chunk of the given values in parallel, & merges the partial results in order.
+		template<typename T, typename TFunc>
+		static T reduce(std::vector<conv::number_t> const& values, T init, TFunc const& func)
+		{
+			const size_t threadCount{ std::max(1u, std::thread::hardware_concurrency()) };
+			if (values.size() <= CHUNK_SIZE || threadCount == 1) {
+				func(init, values.data(), values.size());
+				return init;
+			}
+			std::vector<std::future<T>> chunks;
+			const size_t chunkSize{ std::max(CHUNK_SIZE, (values.size() + threadCount - 1) / threadCount) };
+			for (size_t begin{ 0 }; begin < values.size(); begin += chunkSize) {
+				const size_t size{ std::min(chunkSize, values.size() - begin) };
+				// the initial value is copied when the task is created, since it's merged into while later tasks are still starting
+				chunks.emplace_back(std::async(std::launch::async, [&values, seed = init, &func, begin, size]() {
+					T partial{ seed };
+					func(partial, values.data() + begin, size);
+					return partial;
+				}));
+			}
+			for (auto& chunk : chunks)
+				init.merge(chunk.get());
+			return init;
+		}
+
+	public:
+		Aggregator(AggregateSpec const& spec) : spec{ spec }, keepValues{ std::find(spec.statistics.begin(), spec.statistics.end(), Statistic::HIST) != spec.statistics.end() } {}
+
+		/**
+		 * @brief				Converts the given operations & adds the results. Errors are printed to STDERR.
+		 * @param userInputs	Operations returned by processInput(), or a lazy range of operations from pipeline::operations().
+		 * @returns				The number of operations that were processed.
+		 */
+		template<std::ranges::input_range TRange>
+		size_t add(TRange&& userInputs)
+		{
+			size_t count{ 0 };
+			for (auto&& it : userInputs) {
+				++count;
+				try {
+					const auto& inUnit{ conv::getUnit(std::string{ std::get<0>(it) }) };
+					const auto inValue{ str::stold(std::string{ std::get<1>(it) }) };
+					const auto& outs{ getUnitList(std::get<2>(it)) };
+					const auto& outValues{ conv::convert_all(inUnit, inValue, outs) };
+					for (size_t i{ 0 }; i < outs.size(); ++i) {
+						auto& group{ getGroup(outs[i]) };
+						group.pending.emplace_back(outValues[i]);
+						if (keepValues)
+							group.values.emplace_back(outValues[i]);
+						if (group.pending.size() == BLOCK_SIZE) {
+							group.acc.add(group.pending.data(), group.pending.size());
+							group.pending.clear();
+						}
+					}
+				} catch (const std::exception& ex) {
+					std::cerr << global.csync.get_error() << ex.what() << std::endl;
+				}
+			}
+			return count;
+		}
+
+		/// @brief	Prints the requested statistics for each output unit.
+		void print(std::ostream& os) const
+		{
+			for (const auto& [unit, groupAcc, pending, values] : groups) {
+				const auto& unitName{ format_unit(unit, true) };
+				Accumulator acc{ groupAcc };
+				acc.add(pending.data(), pending.size());
+
+				if (!global.quiet && groups.size() > 1)
+					os << global.csync(global.HeaderColor) << unitName << ':' << global.csync() << '\n';
+
+				const auto& printValue{ [&](std::string const& label, std::string const& value, const bool showUnit) {
+					if (!global.quiet)
+						os << "  " << label << indent(8ull, label.size());
+					os << global.csync(global.ResultColor) << value << global.csync();
+					if (!global.quiet && showUnit)
+						os << ' ' << global.csync(global.UnitColor) << unitName << global.csync();
+					os << '\n';
+				} };
+
+				for (const auto& stat : spec.statistics) {
+					switch (stat) {
+					case Statistic::SUM:
+						printValue("Sum:", format_fp(acc.total()), true);
+						break;
+					case Statistic::MIN:
+						printValue("Min:", format_fp(acc.min), true);
+						break;
+					case Statistic::MAX:
+						printValue("Max:", format_fp(acc.max), true);
+						break;
+					case Statistic::MEAN:
+						printValue("Mean:", format_fp(acc.mean()), true);
+						break;
+					case Statistic::COUNT:
+						printValue("Count:", std::to_string(acc.count), false);
+						break;
+					case Statistic::HIST: {
+						if (acc.count == 0)
+							break;
+						const auto& hist{ reduce(values, Histogram{ acc.min, acc.max, spec.bins }, [](Histogram& h, const conv::number_t* v, const size_t n) { h.add(v, n); }) };
+						if (!global.quiet)
+							os << "  Histogram:\n";
+						const size_t largest{ *std::max_element(hist.bins.begin(), hist.bins.end()) };
+						for (size_t i{ 0 }; i < hist.bins.size(); ++i) {
+							const auto& lower{ format_fp(hist.min + hist.width() * static_cast<conv::number_t>(i)) };
+							const auto& upper{ format_fp(i + 1 == hist.bins.size() ? hist.max : hist.min + hist.width() * static_cast<conv::number_t>(i + 1)) };
+							if (global.quiet) {
+								os << lower << '\t' << upper << '\t' << hist.bins[i] << '\n';
+								continue;
+							}
+							const auto& range{ '[' + lower + ", " + upper + (i + 1 == hist.bins.size() ? "]" : ")") };
+							const auto& count{ std::to_string(hist.bins[i]) };
+							os
+								<< "    " << range << indent(32ull, range.size())
+								<< global.csync(global.ResultColor) << count << global.csync() << indent(10ull, count.size())
+								<< std::string(largest == 0 ? 0 : (hist.bins[i] * 40 + largest - 1) / largest, '#')
+								<< '\n';
+						}
+						break;
+					}
+					default:break;
+					}
+				}
+			}
+			os.flush();
+		}
+	};
+}
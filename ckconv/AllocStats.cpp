@@ -0,0 +1,69 @@
+/**
+ * @file	AllocStats.cpp
+ * @author	radj307
+ * @brief	Replacement global operator new & delete that count allocations. Only compiled when ENABLE_ALLOC_STATS is defined.
+ */
+#ifdef ENABLE_ALLOC_STATS
+#include "AllocStats.hpp"
+
+#include <sysarch.h>
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+	void* allocate(const std::size_t size)
+	{
+		ckconv::alloc::record(size);
+		if (void* p{ std::malloc(size == 0 ? 1 : size) }; p != nullptr)
+			return p;
+		throw std::bad_alloc{};
+	}
+	void* allocate_aligned(const std::size_t size, const std::align_val_t alignment)
+	{
+		ckconv::alloc::record(size);
+		const auto align{ static_cast<std::size_t>(alignment) };
+	#ifdef OS_WIN
+		if (void* p{ _aligned_malloc(size == 0 ? 1 : size, align) }; p != nullptr)
+			return p;
+	#else
+		// aligned_alloc requires the size to be a multiple of the alignment
+		if (void* p{ std::aligned_alloc(align, ((size == 0 ? 1 : size) + align - 1) / align * align) }; p != nullptr)
+			return p;
+	#endif
+		throw std::bad_alloc{};
+	}
+	void deallocate_aligned(void* p) noexcept
+	{
+	#ifdef OS_WIN
+		_aligned_free(p);
+	#else
+		std::free(p);
+	#endif
+	}
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	try { return allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	try { return allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocate_aligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocate_aligned(size, alignment); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { deallocate_aligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { deallocate_aligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { deallocate_aligned(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { deallocate_aligned(p); }
+#endif
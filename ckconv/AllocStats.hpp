@@ -0,0 +1,104 @@
+#pragma once
+/**
+ * @file	AllocStats.hpp
+ * @author	radj307
+ * @brief	Heap allocation accounting for diagnostic builds. Enabled by the ckconv_ENABLE_ALLOC_STATS CMake option.
+ *\n		The global operator new & delete replacements are defined in AllocStats.cpp, and attribute each allocation to the
+ *\n		 pipeline stage that the calling thread is currently in. When the option is disabled, the stage macros expand to nothing.
+ */
+#ifdef ENABLE_ALLOC_STATS
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+
+namespace ckconv::alloc {
+	/// @brief	Pipeline stages that allocations are attributed to.
+	enum class Stage : unsigned char {
+		/// @brief	Argument parsing, configuration, & anything else that happens once per run.
+		STARTUP,
+		/// @brief	Reading & tokenizing input.
+		INPUT,
+		/// @brief	Parsing numbers & looking up units.
+		LOOKUP,
+		/// @brief	Converting values.
+		CONVERT,
+		/// @brief	Formatting results.
+		FORMAT,
+		/// @brief	Writing results to the output stream.
+		OUTPUT,
+		COUNT,
+	};
+	inline constexpr size_t STAGE_COUNT{ static_cast<size_t>(Stage::COUNT) };
+	inline constexpr const char* STAGE_NAMES[STAGE_COUNT]{ "startup", "input", "lookup", "convert", "format", "output" };
+
+	struct StageCounters {
+		std::atomic<uint64_t> allocations{ 0 };
+		std::atomic<uint64_t> bytes{ 0 };
+	};
+
+	/// @brief	Allocation counters for each stage.
+	inline std::array<StageCounters, STAGE_COUNT> counters{};
+	/// @brief	The number of lines that were converted, which is used to calculate per-line averages.
+	inline std::atomic<uint64_t> convertedLines{ 0 };
+	/// @brief	The stage that the current thread is in.
+	inline thread_local Stage currentStage{ Stage::STARTUP };
+
+	inline void setStage(const Stage stage) noexcept { currentStage = stage; }
+
+	/// @brief	Records an allocation of the given size. This is called by the replacement operator new.
+	inline void record(const size_t bytes) noexcept
+	{
+		auto& c{ counters[static_cast<size_t>(currentStage)] };
+		c.allocations.fetch_add(1, std::memory_order_relaxed);
+		c.bytes.fetch_add(bytes, std::memory_order_relaxed);
+	}
+
+	/// @brief	Gets the average number of allocations per converted line, excluding the startup stage.
+	inline double getAllocationsPerLine() noexcept
+	{
+		const uint64_t lines{ convertedLines.load() };
+		if (lines == 0)
+			return 0.0;
+		uint64_t total{ 0 };
+		for (size_t i{ static_cast<size_t>(Stage::STARTUP) + 1 }; i < STAGE_COUNT; ++i)
+			total += counters[i].allocations.load();
+		return static_cast<double>(total) / static_cast<double>(lines);
+	}
+
+	/**
+	 * @brief		Prints the number of allocations & bytes allocated by each stage.
+	 * @param os	Output stream. This should be STDERR, so the report doesn't mix with the results.
+	 */
+	inline void printReport(std::ostream& os)
+	{
+		const uint64_t lines{ convertedLines.load() };
+		os << "Allocations (" << lines << " converted line" << (lines == 1 ? "" : "s") << "):\n"
+			<< "  Stage       Allocations  Bytes         Per Line\n"
+			<< "  -----------------------------------------------\n";
+		for (size_t i{ 0 }; i < STAGE_COUNT; ++i) {
+			const uint64_t allocations{ counters[i].allocations.load() }, bytes{ counters[i].bytes.load() };
+			os << "  " << std::left << std::setw(12) << STAGE_NAMES[i]
+				<< std::setw(13) << allocations
+				<< std::setw(14) << bytes;
+			if (i != static_cast<size_t>(Stage::STARTUP) && lines != 0)
+				os << std::fixed << std::setprecision(2) << static_cast<double>(allocations) / static_cast<double>(lines) << std::defaultfloat;
+			os << std::right << '\n';
+		}
+		os << "  Total per line (excluding startup): " << std::fixed << std::setprecision(2) << getAllocationsPerLine() << std::defaultfloat << '\n';
+	}
+}
+
+/// @brief	Attributes subsequent allocations on the current thread to the given ckconv::alloc::Stage.
+#define $alloc_stage(stage) ::ckconv::alloc::setStage(::ckconv::alloc::Stage::stage)
+/// @brief	Counts a converted line, for calculating per-line averages.
+#define $alloc_count_line() ::ckconv::alloc::convertedLines.fetch_add(1, std::memory_order_relaxed)
+/// @brief	Counts several converted lines at once, for modes that convert values in bulk.
+#define $alloc_count_lines(count) ::ckconv::alloc::convertedLines.fetch_add((count), std::memory_order_relaxed)
+#else
+#define $alloc_stage(stage)
+#define $alloc_count_line()
+#define $alloc_count_lines(count)
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+/**
+ * @file	Arena.hpp
+ * @author	radj307
+ * @brief	Per-batch memory arena for tokens & operations, which is released all at once instead of one allocation at a time.
+ * @details	Containers that hold per-batch data *(see token_list & operation_list in util.h)* use std::pmr allocators, so they can be-
+ *\n		 -allocated from a BatchArena. Allocating from an arena is a pointer bump, and freeing is a no-op until the whole batch is-
+ *\n		 -released. Arenas aren't thread-safe, so each thread should own its own arena; this also means that threads never contend-
+ *\n		 -for the global heap lock while processing a batch.
+ */
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+namespace ckconv {
+	/// @brief	The size of the block that an arena allocates up front, which is reused by every batch.
+	inline constexpr size_t DEFAULT_ARENA_SIZE{ 1ull << 16 };
+
+	/**
+	 * @class	BatchArena
+	 * @brief	Monotonic memory resource that keeps its first block between batches. Batches that need more memory than the first block-
+	 *\n		 -get additional blocks from the heap, which are freed when the arena is released.
+	 */
+	class BatchArena {
+		std::unique_ptr<std::byte[]> block;
+		std::pmr::monotonic_buffer_resource arena;
+
+	public:
+		BatchArena(const size_t size = DEFAULT_ARENA_SIZE) : block{ std::make_unique_for_overwrite<std::byte[]>(size) }, arena{ block.get(), size, std::pmr::new_delete_resource() } {}
+		BatchArena(BatchArena const&) = delete;
+		BatchArena& operator=(BatchArena const&) = delete;
+
+		/// @brief	Gets the memory resource to allocate the batch from.
+		std::pmr::memory_resource* resource() noexcept { return &arena; }
+
+		/// @brief	Frees everything that was allocated since the last release. Nothing allocated from the arena may be used after this.
+		void release() { arena.release(); }
+	};
+}
@@ -0,0 +1,397 @@
+#pragma once
+/**
+ * @file	Compound.hpp
+ * @author	radj307
+ * @brief	Compound *(mixed-radix)* values, such as 6'2" or 5 ft 3 in as input, & "ft+in" as an output unit.
+ * @details	Compound input is a sequence of Imperial length components in strictly decreasing order, which may be written in one token-
+ *\n		 -or spread over several, i.e. 6'2", 5ft3in, 5ft 3in, or 1 mi 200 yd. The components are summed in one pass through the-
+ *\n		 -Imperial table, in the smallest unit of the compound, so 5ft 3in is read as 63 in. Only the first component may be negative,-
+ *\n		 -in which case the whole value is negative. A trailing comma ends a compound, i.e. "5ft, 3in" is two separate values.
+ *\n		Compound output units are '+'-separated lists of units in strictly decreasing order, where each unit is a whole multiple of the-
+ *\n		 -next one, i.e. "ft+in", "mi+yd+ft", or "m+cm". The input is converted to the smallest unit once, then its integer part is-
+ *\n		 -split into each unit with a single divmod chain; the fractional part is kept by the smallest unit.
+ */
+#include "conv.hpp"
+
+#include <make_exception.hpp>
+#include <str.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ckconv::compound {
+	/// @brief	The maximum number of tokens that a compound value can span, i.e. 6 for "1 mi 200 yd 2 ft".
+	inline constexpr size_t MAX_TOKENS{ 8 };
+
+	/**
+	 * @brief		Gets the ratio between two units as an integer, if it is a whole number.
+	 *\n			Conversion factors like 1/12 aren't exact, so ratios within a few ULPs of an integer are rounded to it.
+	 * @param big	The larger unit.
+	 * @param small	The smaller unit.
+	 * @returns		The number of small units in one big unit, or 0 if it isn't a whole number greater than 1.
+	 */
+	inline uint64_t getWholeRatio(conv::Unit const& big, conv::Unit const& small)
+	{
+		const conv::number_t ratio{ conv::getConversionFactor(big, small) };
+		const conv::number_t rounded{ std::round(ratio) };
+		if (rounded < 2.0L || rounded > static_cast<conv::number_t>(std::numeric_limits<uint32_t>::max()) || std::fabs(ratio - rounded) > rounded * 1e-15L)
+			return 0ull;
+		return static_cast<uint64_t>(rounded);
+	}
+
+	/**
+	 * @class	ImperialTable
+	 * @brief	Lookup table for the names & symbols of Imperial units, which doesn't allocate. Names are matched the same way as-
+	 *\n		 -System::find(); case-insensitive, with an optional plural 's'. Symbols are case-sensitive.
+	 */
+	class ImperialTable {
+		struct Entry {
+			std::string name;
+			bool isSymbol;
+			const conv::Unit* unit;
+		};
+		std::vector<Entry> entries;
+
+		static bool iequals(std::string_view const& l, std::string_view const& r) noexcept
+		{
+			return l.size() == r.size() && std::equal(l.begin(), l.end(), r.begin(), [](const unsigned char a, const unsigned char b) { return std::tolower(a) == std::tolower(b); });
+		}
+
+	public:
+		ImperialTable()
+		{
+			for (const auto& unit : conv::Imperial) {
+				if (unit.HasSymbol())
+					entries.emplace_back(Entry{ unit.GetSymbol(), true, &unit });
+				if (unit.HasFullName()) {
+					entries.emplace_back(Entry{ unit.GetFullName(false), false, &unit });
+					entries.emplace_back(Entry{ unit.GetFullName(true), false, &unit });
+				}
+				for (const auto& name : unit.GetExtraNames())
+					entries.emplace_back(Entry{ name, false, &unit });
+			}
+		}
+
+		/// @brief	Finds the Imperial unit with the given name or symbol. Returns nullptr if there isn't one.
+		const conv::Unit* find(std::string_view const& s) const noexcept
+		{
+			const std::string_view singular{ s.ends_with('s') || s.ends_with('S') ? s.substr(0ull, s.size() - 1ull) : std::string_view{} };
+			for (const auto& [name, isSymbol, unit] : entries) {
+				if (isSymbol ? s == name : (iequals(s, name) || (!singular.empty() && iequals(singular, name))))
+					return unit;
+			}
+			return nullptr;
+		}
+	};
+
+	/// @brief	Gets the table of Imperial units, which is created the first time that it is used.
+	inline ImperialTable const& getImperialTable()
+	{
+		static const ImperialTable table;
+		return table;
+	}
+
+	/**
+	 * @struct	Sum
+	 * @brief	The total of a compound input value, in its smallest unit.
+	 */
+	struct Sum {
+		const conv::Unit* unit;
+		conv::number_t value;
+		/// @brief	The number of tokens that the compound value spans.
+		size_t tokenCount;
+	};
+
+	/**
+	 * @brief			Splits a token into runs of numbers & units, i.e. "6'2\"" -> "6", "'", "2", "\"".
+	 * @param token		Input token.
+	 * @param func		Called with (isNumber, segment) for each run. Returns false to stop.
+	 * @returns			false when func returned false or the token contains anything else; otherwise true.
+	 */
+	template<std::invocable<bool, std::string_view> TFunc>
+	inline bool forEachSegment(std::string_view const& token, TFunc&& func)
+	{
+		if (token.empty())
+			return false;
+		for (size_t pos{ 0ull }; pos < token.size(); ) {
+			const bool isNumber{ str::stdpred::isdigit(token[pos]) || token[pos] == '.' || token[pos] == '-' };
+			size_t end{ pos + 1ull };
+			if (isNumber) {
+				while (end < token.size() && (str::stdpred::isdigit(token[end]) || token[end] == '.'))
+					++end;
+			}
+			else if (token[pos] == '\'' || token[pos] == '"') {
+				// quote symbols are always one character, i.e. the foot & inch symbols in 6'2"
+			}
+			else if (str::stdpred::isalpha(token[pos])) {
+				while (end < token.size() && str::stdpred::isalpha(token[end]))
+					++end;
+			}
+			else return false;
+
+			if (!func(isNumber, token.substr(pos, end - pos)))
+				return false;
+			pos = end;
+		}
+		return true;
+	}
+
+	/**
+	 * @class	Parser
+	 * @brief	Sums the components of a compound value as they are read. Each component is added to the total after multiplying the-
+	 *\n		 -total by the ratio between the previous unit & the new unit, so the total is always in the smallest unit so far.
+	 */
+	class Parser {
+		ImperialTable const& table{ getImperialTable() };
+		std::optional<conv::number_t> number;
+		const conv::Unit* unit{ nullptr };
+		conv::number_t total{ 0.0L };
+		size_t count{ 0 };
+		bool negative{ false };
+
+		bool addNumber(std::string_view s)
+		{
+			if (number.has_value())
+				return false;
+			// only the first number can be negative
+			if (s.starts_with('-')) {
+				if (count != 0)
+					return false;
+				negative = true;
+				s.remove_prefix(1ull);
+			}
+			conv::number_t value;
+			if (s.empty() || std::from_chars(s.data(), s.data() + s.size(), value, std::chars_format::fixed).ptr != s.data() + s.size())
+				return false;
+			number = value;
+			return true;
+		}
+		bool addUnit(std::string_view const& s)
+		{
+			// the number is checked first, since most units that follow a complete component are output units
+			if (!number.has_value())
+				return false;
+			const conv::Unit* next{ table.find(s) };
+			if (next == nullptr)
+				return false;
+			if (unit == nullptr)
+				total = number.value();
+			else if (next->GetConversionFactor() < unit->GetConversionFactor()) {
+				// whole ratios are used exactly, so 5ft 3in is exactly 63 in
+				const uint64_t whole{ getWholeRatio(*unit, *next) };
+				total = total * (whole != 0ull ? static_cast<conv::number_t>(whole) : conv::getConversionFactor(*unit, *next)) + number.value();
+			}
+			else return false;
+			unit = next;
+			number.reset();
+			++count;
+			return true;
+		}
+
+	public:
+		/**
+		 * @brief		Adds the components in a token.
+		 * @param token	A token that contains numbers & Imperial units, i.e. "6'2\"", "5ft", "3", or "in".
+		 * @returns		false when the token can't continue the compound value; otherwise true.
+		 */
+		bool add(std::string_view const& token)
+		{
+			return forEachSegment(token, [this](const bool isNumber, std::string_view const& segment) { return isNumber ? addNumber(segment) : addUnit(segment); });
+		}
+
+		/// @brief	Returns true when the components so far are a complete compound value, which has at least two components.
+		bool isComplete() const noexcept { return count >= 2ull && !number.has_value(); }
+
+		/// @brief	Gets the total of the components so far, in the smallest unit.
+		conv::number_t getValue() const noexcept { return negative ? -total : total; }
+		/// @brief	Gets the smallest unit so far.
+		const conv::Unit* getUnit() const noexcept { return unit; }
+	};
+
+	/**
+	 * @brief		Gets the number of tokens that have the shape of a compound value, without looking up any units. Most numbers are-
+	 *\n			 -followed by a single unit, so this is much cheaper than parsing them.
+	 * @param src	A token source that can look ahead by more than one token. *(see token_source in util.h)*
+	 * @returns		The number of tokens in the longest sequence that alternates between numbers & units with at least two units, or 0.
+	 */
+	template<typename TSource>
+	inline size_t getShapeLength(TSource& src)
+	{
+		if (const auto& first{ src.peek() }; first.empty() || !(str::stdpred::isdigit(first.front()) || first.front() == '.' || first.front() == '-'))
+			return 0ull;
+		size_t length{ 0ull }, units{ 0ull };
+		bool hasNumber{ false };
+		for (size_t i{ 0ull }; i < MAX_TOKENS; ++i) {
+			const auto& token{ src.peek(i) };
+			if (!token.has_value() || !forEachSegment(token.value(), [&](const bool isNumber, std::string_view const&) {
+				if (isNumber == hasNumber)
+					return false;
+				hasNumber = isNumber;
+				units += !isNumber;
+				return true;
+			})) break;
+			if (units >= 2ull && !hasNumber)
+				length = i + 1ull;
+		}
+		return length;
+	}
+
+	/**
+	 * @brief		Reads a compound value, if the next tokens form one.
+	 * @param src	A token source that can look ahead by more than one token. *(see token_source in util.h)*
+	 * @returns		The total & the number of tokens that it spans, or std::nullopt. Nothing is taken from the source.
+	 */
+	template<typename TSource>
+	inline std::optional<Sum> parse(TSource& src)
+	{
+		if (src.empty())
+			return std::nullopt;
+		Parser parser;
+		std::optional<Sum> result;
+		// the longest sequence of tokens that forms a complete compound value is used, i.e. "5 ft 3 in" rather than "5 ft"
+		for (size_t i{ 0ull }, length{ getShapeLength(src) }; i < length; ++i) {
+			if (!parser.add(src.peek(i).value()))
+				break;
+			if (parser.isComplete())
+				result = Sum{ parser.getUnit(), parser.getValue(), i + 1ull };
+		}
+		return result;
+	}
+
+	/**
+	 * @brief			Formats the total of a compound value as a number that parses back to exactly the same value.
+	 * @param value		The total, from Sum.
+	 * @returns			std::string
+	 */
+	inline std::string toString(const conv::number_t value)
+	{
+		char buffer[64];
+		const auto& [end, ec] { std::to_chars(buffer, buffer + sizeof(buffer), value) };
+		if (ec != std::errc{})
+			throw make_exception("Failed to format compound value ", value, '!');
+		return{ buffer, end };
+	}
+
+	/// @brief	Checks if the given string is a compound output unit, i.e. "ft+in".
+	inline bool isCompoundUnit(std::string_view const& s) noexcept
+	{
+		return !s.empty() && s.find('+') != std::string_view::npos && s.find(',') == std::string_view::npos && !str::stdpred::isdigit(s.front());
+	}
+
+	/**
+	 * @class	CompoundUnit
+	 * @brief	An output unit made of several units, i.e. "ft+in". Values are split into each unit with an integer divmod chain.
+	 */
+	class CompoundUnit {
+		std::vector<conv::Unit> units;
+		/// @brief	ratios[i] is the number of units[i] in one units[i - 1]. ratios[0] isn't used.
+		std::vector<uint64_t> ratios;
+
+	public:
+		/**
+		 * @brief	Parses a compound output unit.
+		 * @param s	A '+'-separated list of units in strictly decreasing order, i.e. "ft+in".
+		 */
+		CompoundUnit(std::string_view const& s)
+		{
+			for (const auto& name : str::split_all(std::string{ s }, "+")) {
+				const auto& trimmed{ str::trim(name, " \t\v\r\n"s) };
+				if (trimmed.empty())
+					throw make_exception("Compound unit '", s, "' contains an empty unit!");
+				auto& unit{ units.emplace_back(conv::getUnit(trimmed)) };
+				if (unit.GetDimension() != 1u)
+					throw make_exception("Compound unit '", s, "' can only contain length units!");
+				if (units.size() == 1ull)
+					ratios.emplace_back(1ull);
+				else if (const uint64_t ratio{ getWholeRatio(units[units.size() - 2ull], unit) }; ratio != 0ull)
+					ratios.emplace_back(ratio);
+				else throw make_exception("Compound unit '", s, "' requires each unit to be a whole multiple of the next one!");
+			}
+			if (units.size() < 2ull)
+				throw make_exception("Compound unit '", s, "' must contain at least two units!");
+		}
+
+		/// @brief	Gets the units of this compound unit, from largest to smallest.
+		std::span<const conv::Unit> getUnits() const noexcept { return units; }
+		/// @brief	Gets the smallest unit, which conversions are made to before the value is split.
+		conv::Unit const& smallest() const noexcept { return units.back(); }
+
+		/**
+		 * @brief		Splits a value into each unit.
+		 * @param value	A value in the smallest unit. Fractions that are within 1e-9 of a whole number are rounded to it first, so-
+		 *\n			 -values like 5 ft 11.9999999999 in are split as 6 ft 0 in.
+		 * @param out	Receives the value of each unit, from largest to smallest. Its size must match the number of units.
+		 *\n			Every component of a negative value is negative, so the components still add up to the value.
+		 * @param round	Gets the value that the smallest component is displayed as *(see round_fp() in global.h)*. When that is a whole-
+		 *\n			 -one of the next unit, it is carried into that unit; otherwise 71.9999996 in would be displayed as "5 ft 12 in".
+		 */
+		template<std::invocable<conv::number_t> TRound>
+		void split(const conv::number_t value, std::span<conv::number_t> out, TRound&& round) const
+		{
+			constexpr conv::number_t SNAP{ 1e-9L };
+			const conv::number_t magnitude{ std::fabs(value) };
+			if (!std::isfinite(value) || magnitude >= 0x1p64L)
+				throw make_exception("Value ", value, " is too large to be split into a compound unit!");
+
+			uint64_t whole{ static_cast<uint64_t>(magnitude) };
+			conv::number_t fraction{ magnitude - static_cast<conv::number_t>(whole) };
+			if (1.0L - fraction < SNAP) {
+				++whole;
+				fraction = 0.0L;
+			}
+			else if (fraction < SNAP)
+				fraction = 0.0L;
+			// only the largest possible smallest component can be rounded up to a whole one of the next unit
+			if (const uint64_t last{ ratios.back() }; fraction != 0.0L && whole % last == last - 1ull && round(static_cast<conv::number_t>(last - 1ull) + fraction) >= static_cast<conv::number_t>(last)) {
+				++whole;
+				fraction = 0.0L;
+			}
+
+			for (size_t i{ units.size() - 1ull }; i > 0ull; --i) {
+				out[i] = static_cast<conv::number_t>(whole % ratios[i]);
+				whole /= ratios[i];
+			}
+			out[0] = static_cast<conv::number_t>(whole);
+			out.back() += fraction;
+			if (std::signbit(value)) {
+				for (auto& component : out)
+					if (component != 0.0L)
+						component = -component;
+			}
+		}
+		/// @brief	Splits a value into each unit, without rounding the smallest component for display.
+		void split(const conv::number_t value, std::span<conv::number_t> out) const
+		{
+			split(value, out, [](const conv::number_t v) { return v; });
+		}
+	};
+
+	/**
+	 * @class	CompoundUnitCache
+	 * @brief	Parses each compound output unit once. Parsed units are shared, so they outlive the cache.
+	 */
+	class CompoundUnitCache {
+		std::map<std::string, std::shared_ptr<const CompoundUnit>, std::less<>> units;
+
+	public:
+		/// @brief	Gets the parsed compound unit for the given string, parsing it if necessary.
+		std::shared_ptr<const CompoundUnit> get(std::string_view const& s)
+		{
+			if (const auto& it{ units.find(s) }; it != units.end())
+				return it->second;
+			return units.emplace(std::string{ s }, std::make_shared<const CompoundUnit>(s)).first->second;
+		}
+	};
+}
@@ -0,0 +1,594 @@
+#pragma once
+/**
+ * @file	CompressedStream.hpp
+ * @author	radj307
+ * @brief	Stream buffers that transparently decompress input & compress output, so compressed logs can be converted without temporary files.
+ * @details	Input compression is detected from the magic bytes at the beginning of the stream:
+ *\n		  1F 8B          gzip *(requires zlib; concatenated members are supported)*
+ *\n		  28 B5 2F FD    zstd *(requires libzstd)*
+ *\n		Anything else is passed through unchanged. Input is read & decompressed in fixed-size blocks on a separate thread, which hands them-
+ *\n		 -to the parsing thread through a bounded queue; memory usage doesn't depend on the size of the input.
+ *\n		Support for each format is enabled by the ENABLE_ZLIB & ENABLE_ZSTD definitions, which are set by CMake when the libraries are found.
+ */
+#include "IoUring.hpp"
+
+#include <sysarch.h>
+#include <make_exception.hpp>
+#include <str.hpp>
+
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#ifdef OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef ENABLE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef ENABLE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace ckconv::io {
+	/// @brief	The size of each block that is read, decompressed, or compressed at a time.
+	inline constexpr size_t BLOCK_SIZE{ 1ull << 16 };
+	/// @brief	The maximum number of decompressed blocks that can be waiting to be parsed.
+	inline constexpr size_t QUEUE_CAPACITY{ 4 };
+
+	/// @brief	Supported compression formats.
+	enum class Compression : unsigned char {
+		NONE,
+		GZIP,
+		ZSTD,
+	};
+
+	/// @brief	The number of bytes required to detect any supported compression format.
+	inline constexpr size_t MAGIC_SIZE{ 4 };
+
+	/**
+	 * @brief		Detects the compression format of a stream from its first bytes.
+	 * @param head	The first bytes of the stream. At least MAGIC_SIZE bytes are required to detect every format.
+	 * @returns		Compression
+	 */
+	inline constexpr Compression detectCompression(std::string_view const& head) noexcept
+	{
+		if (head.size() >= 2 && head[0] == '\x1F' && head[1] == '\x8B')
+			return Compression::GZIP;
+		if (head.size() >= 4 && head[0] == '\x28' && head[1] == '\xB5' && head[2] == '\x2F' && head[3] == '\xFD')
+			return Compression::ZSTD;
+		return Compression::NONE;
+	}
+
+	/**
+	 * @brief		Parses the name of a compression format.
+	 * @param s		Input string. *(none, gzip, or zstd)*
+	 * @returns		Compression
+	 */
+	inline Compression parseCompression(std::string const& s)
+	{
+		const auto& name{ str::tolower(s) };
+		if (name == "none")
+			return Compression::NONE;
+		if (name == "gzip" || name == "gz")
+			return Compression::GZIP;
+		if (name == "zstd" || name == "zst")
+			return Compression::ZSTD;
+		throw make_exception("Invalid compression format '", s, "'; expected 'none', 'gzip', or 'zstd'!");
+	}
+
+	/// @brief	Throws an exception if support for the given compression format wasn't compiled in.
+	inline void requireSupport(const Compression compression)
+	{
+	#ifndef ENABLE_ZLIB
+		if (compression == Compression::GZIP)
+			throw make_exception("gzip compression isn't supported by this build of ckconv! (zlib was not found)");
+	#endif
+	#ifndef ENABLE_ZSTD
+		if (compression == Compression::ZSTD)
+			throw make_exception("zstd compression isn't supported by this build of ckconv! (libzstd was not found)");
+	#endif
+		(void)compression;
+	}
+
+	/**
+	 * @class	BlockQueue
+	 * @brief	Bounded single-producer, single-consumer queue of data blocks. Errors from the producer are rethrown by the consumer.
+	 */
+	class BlockQueue {
+		std::mutex mutex;
+		std::condition_variable notEmpty, notFull;
+		std::deque<std::string> blocks;
+		std::exception_ptr error;
+		bool closed{ false };
+		bool cancelled{ false };
+
+	public:
+		/**
+		 * @brief		Waits for space in the queue, then adds a block.
+		 * @returns		false when the consumer has cancelled the queue; otherwise true.
+		 */
+		bool push(std::string&& block)
+		{
+			std::unique_lock<std::mutex> lock{ mutex };
+			notFull.wait(lock, [this] { return blocks.size() < QUEUE_CAPACITY || cancelled; });
+			if (cancelled)
+				return false;
+			blocks.emplace_back(std::move(block));
+			notEmpty.notify_one();
+			return true;
+		}
+		/**
+		 * @brief		Waits for the next block.
+		 * @param block	Receives the next block.
+		 * @returns		false when the producer has closed the queue & there are no more blocks; otherwise true.
+		 */
+		bool pop(std::string& block)
+		{
+			std::unique_lock<std::mutex> lock{ mutex };
+			notEmpty.wait(lock, [this] { return !blocks.empty() || closed; });
+			if (blocks.empty()) {
+				if (error)
+					std::rethrow_exception(std::exchange(error, nullptr));
+				return false;
+			}
+			block = std::move(blocks.front());
+			blocks.pop_front();
+			notFull.notify_one();
+			return true;
+		}
+		/// @brief	Called by the producer when there are no more blocks, or when an error occurred.
+		void close(std::exception_ptr ex = nullptr)
+		{
+			std::scoped_lock<std::mutex> lock{ mutex };
+			error = ex;
+			closed = true;
+			notEmpty.notify_all();
+		}
+		/// @brief	Called by the consumer to make the producer stop early.
+		void cancel()
+		{
+			std::scoped_lock<std::mutex> lock{ mutex };
+			cancelled = true;
+			notFull.notify_all();
+		}
+		bool isClosed()
+		{
+			std::scoped_lock<std::mutex> lock{ mutex };
+			return closed;
+		}
+	};
+
+	/// @brief	Reads up to size bytes from a file descriptor. Returns the number of bytes read, or 0 at the end of the file.
+	inline size_t readDescriptor(const int fd, char* const buffer, const size_t size)
+	{
+	#ifdef OS_WIN
+		const int count{ _read(fd, buffer, static_cast<unsigned>(size)) };
+	#else
+		ssize_t count;
+		do {
+			count = ::read(fd, buffer, size);
+		} while (count < 0 && errno == EINTR);
+	#endif
+		if (count < 0)
+			throw make_exception("Failed to read input! (errno ", errno, ')');
+		return static_cast<size_t>(count);
+	}
+
+	/**
+	 * @class	DescriptorReader
+	 * @brief	Reads a file descriptor one block at a time with blocking reads. This is the portable counterpart of uring::FileReader.
+	 */
+	class DescriptorReader {
+		int fd;
+		std::string buffer;
+
+	public:
+		DescriptorReader(const int fd) : fd{ fd }, buffer(BLOCK_SIZE, '\0') {}
+
+		/// @brief	Gets the next block of input, which is valid until the next call; or an empty view at the end of the input.
+		std::string_view next()
+		{
+			return { buffer.data(), readDescriptor(fd, buffer.data(), buffer.size()) };
+		}
+	};
+
+	/**
+	 * @class	DecompressingStreamBuf
+	 * @brief	Input stream buffer that reads from a file descriptor on a background thread, decompressing it if necessary.
+	 *\n		Regular files are read through io_uring when it is available *(see IoUring.hpp)*, so the next block is already being read-
+	 *\n		 -while the current one is decompressed.
+	 */
+	class DecompressingStreamBuf : public std::streambuf {
+		std::shared_ptr<BlockQueue> queue;
+		std::thread producer;
+		std::string current;
+
+		/**
+		 * @brief			Reads, detects, & decompresses the input. Runs on the producer thread.
+		 * @param reader	The reader to get blocks of raw input from. *(DescriptorReader or uring::FileReader)*
+		 * @param queue		The queue that decompressed blocks are written to.
+		 */
+		template<typename TReader>
+		static void produce(TReader& reader, BlockQueue& queue)
+		{
+			std::string_view raw{ reader.next() };
+			// reads the next block of raw input; returns false at the end of the input
+			const auto& read{ [&]() {
+				raw = reader.next();
+				return !raw.empty();
+			} };
+
+			// read just enough to detect the format; a line of uncompressed input may be shorter than the magic number
+			std::string head;
+			if (!raw.empty() && raw.size() < MAGIC_SIZE && raw.find('\n') == std::string_view::npos) {
+				head.assign(raw);
+				for (std::string_view more; head.size() < MAGIC_SIZE && head.find('\n') == std::string::npos && !(more = reader.next()).empty(); )
+					head.append(more);
+				raw = head;
+			}
+			if (raw.empty())
+				return;
+
+			const Compression compression{ detectCompression(raw) };
+			requireSupport(compression);
+
+			switch (compression) {
+			case Compression::NONE:
+				do {
+					if (!queue.push(std::string{ raw }))
+						return;
+				} while (read());
+				break;
+		#ifdef ENABLE_ZLIB
+			case Compression::GZIP: {
+				z_stream zs{};
+				// 15 + 32 enables gzip & zlib header detection with the maximum window size
+				if (inflateInit2(&zs, 15 + 32) != Z_OK)
+					throw make_exception("Failed to initialize zlib!");
+				const std::unique_ptr<z_stream, int(*)(z_streamp)> guard{ &zs, inflateEnd };
+				bool inMember{ true };
+				do {
+					zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(raw.data()));
+					zs.avail_in = static_cast<uInt>(raw.size());
+					while (zs.avail_in != 0) {
+						if (!inMember) {
+							// another gzip member follows the previous one
+							inflateReset(&zs);
+							inMember = true;
+						}
+						std::string out(BLOCK_SIZE, '\0');
+						zs.next_out = reinterpret_cast<Bytef*>(out.data());
+						zs.avail_out = static_cast<uInt>(out.size());
+						const int result{ inflate(&zs, Z_NO_FLUSH) };
+						if (result == Z_STREAM_END)
+							inMember = false;
+						else if (result != Z_OK && result != Z_BUF_ERROR)
+							throw make_exception("Failed to decompress gzip input: ", (zs.msg != nullptr ? zs.msg : "unknown error"));
+						out.resize(out.size() - zs.avail_out);
+						if (!out.empty() && !queue.push(std::move(out)))
+							return;
+					}
+				} while (read());
+				if (inMember)
+					throw make_exception("The gzip input is truncated!");
+				break;
+			}
+		#endif
+		#ifdef ENABLE_ZSTD
+			case Compression::ZSTD: {
+				const std::unique_ptr<ZSTD_DStream, size_t(*)(ZSTD_DStream*)> zs{ ZSTD_createDStream(), ZSTD_freeDStream };
+				if (zs == nullptr || ZSTD_isError(ZSTD_initDStream(zs.get())))
+					throw make_exception("Failed to initialize zstd!");
+				// the last value returned by ZSTD_decompressStream is 0 at the end of each frame
+				size_t remaining{ 0 };
+				do {
+					ZSTD_inBuffer in{ raw.data(), raw.size(), 0 };
+					while (in.pos < in.size) {
+						std::string out(BLOCK_SIZE, '\0');
+						ZSTD_outBuffer outBuf{ out.data(), out.size(), 0 };
+						remaining = ZSTD_decompressStream(zs.get(), &outBuf, &in);
+						if (ZSTD_isError(remaining))
+							throw make_exception("Failed to decompress zstd input: ", ZSTD_getErrorName(remaining));
+						out.resize(outBuf.pos);
+						if (!out.empty() && !queue.push(std::move(out)))
+							return;
+					}
+				} while (read());
+				if (remaining != 0)
+					throw make_exception("The zstd input is truncated!");
+				break;
+			}
+		#endif
+			default:break;
+			}
+		}
+
+	protected:
+		int_type underflow() override
+		{
+			if (gptr() < egptr())
+				return traits_type::to_int_type(*gptr());
+			if (!queue->pop(current))
+				return traits_type::eof();
+			setg(current.data(), current.data(), current.data() + current.size());
+			return traits_type::to_int_type(*gptr());
+		}
+
+	public:
+		/**
+		 * @brief			Starts reading the given file descriptor on a background thread.
+		 * @param fd		The file descriptor to read from.
+		 * @param ownsFd	When true, the file descriptor is closed once the input has been read.
+		 */
+		DecompressingStreamBuf(const int fd, const bool ownsFd) : queue{ std::make_shared<BlockQueue>() }
+		{
+			producer = std::thread([fd, ownsFd, queue = queue]() {
+				std::exception_ptr error{ nullptr };
+				try {
+				#ifdef ENABLE_IO_URING
+					if (const auto& fileReader{ uring::FileReader::open(fd, BLOCK_SIZE) }; fileReader != nullptr)
+						produce(*fileReader, *queue);
+					else
+				#endif
+					{
+						DescriptorReader reader{ fd };
+						produce(reader, *queue);
+					}
+				} catch (...) {
+					error = std::current_exception();
+				}
+				if (ownsFd) {
+				#ifdef OS_WIN
+					_close(fd);
+				#else
+					::close(fd);
+				#endif
+				}
+				queue->close(error);
+			});
+		}
+		DecompressingStreamBuf(DecompressingStreamBuf const&) = delete;
+		DecompressingStreamBuf& operator=(DecompressingStreamBuf const&) = delete;
+		~DecompressingStreamBuf()
+		{
+			queue->cancel();
+			// the producer may be blocked reading an interactive STDIN; it only holds shared state, so it can be left to finish on its own
+			if (queue->isClosed())
+				producer.join();
+			else producer.detach();
+		}
+	};
+
+	/**
+	 * @class	InputStream
+	 * @brief	Input stream that reads STDIN or a file through a DecompressingStreamBuf. Read errors are thrown as exceptions.
+	 */
+	class InputStream : public std::istream {
+		DecompressingStreamBuf buffer;
+
+		static int openFile(std::string const& path)
+		{
+		#ifdef OS_WIN
+			const int fd{ _open(path.c_str(), _O_RDONLY | _O_BINARY) };
+		#else
+			const int fd{ ::open(path.c_str(), O_RDONLY) };
+		#endif
+			if (fd < 0)
+				throw make_exception("Failed to open input file '", path, "'!");
+			return fd;
+		}
+		static int getSTDIN()
+		{
+		#ifdef OS_WIN
+			// compressed input must not have its line endings translated
+			_setmode(_fileno(stdin), _O_BINARY);
+			return _fileno(stdin);
+		#else
+			return STDIN_FILENO;
+		#endif
+		}
+
+	public:
+		/// @brief	Reads STDIN.
+		InputStream() : std::istream{ nullptr }, buffer{ getSTDIN(), false }
+		{
+			rdbuf(&buffer);
+			exceptions(std::ios_base::badbit);
+		}
+		/// @brief	Reads the file at the given path.
+		InputStream(std::string const& path) : std::istream{ nullptr }, buffer{ openFile(path), true }
+		{
+			rdbuf(&buffer);
+			exceptions(std::ios_base::badbit);
+		}
+	};
+
+	/**
+	 * @class	CompressingStreamBuf
+	 * @brief	Output stream buffer that compresses everything written to it before passing it to another stream buffer.
+	 *\n		Flushing the stream flushes the compressor too, so each flushed block can be decompressed immediately by the reader.
+	 */
+	class CompressingStreamBuf : public std::streambuf {
+		std::streambuf* sink;
+		Compression compression;
+		std::string in, out;
+		bool finished{ false };
+	#ifdef ENABLE_ZLIB
+		z_stream zs{};
+	#endif
+	#ifdef ENABLE_ZSTD
+		ZSTD_CStream* zcs{ nullptr };
+	#endif
+
+		/// @brief	Modes for compress(), which correspond to the flush modes of zlib & zstd.
+		enum class Mode : unsigned char {
+			CONTINUE,
+			FLUSH,
+			END,
+		};
+
+		void writeOut(const size_t size)
+		{
+			if (size != 0 && sink->sputn(out.data(), static_cast<std::streamsize>(size)) != static_cast<std::streamsize>(size))
+				throw make_exception("Failed to write compressed output!");
+		}
+
+		/// @brief	Compresses the pending input & writes the result to the sink.
+		void compress(const Mode mode)
+		{
+			const size_t size{ static_cast<size_t>(pptr() - pbase()) };
+			switch (compression) {
+		#ifdef ENABLE_ZLIB
+			case Compression::GZIP: {
+				zs.next_in = reinterpret_cast<Bytef*>(pbase());
+				zs.avail_in = static_cast<uInt>(size);
+				const int flush{ mode == Mode::END ? Z_FINISH : (mode == Mode::FLUSH ? Z_SYNC_FLUSH : Z_NO_FLUSH) };
+				int result;
+				do {
+					zs.next_out = reinterpret_cast<Bytef*>(out.data());
+					zs.avail_out = static_cast<uInt>(out.size());
+					result = deflate(&zs, flush);
+					if (result == Z_STREAM_ERROR)
+						throw make_exception("Failed to compress output!");
+					writeOut(out.size() - zs.avail_out);
+				} while (zs.avail_out == 0 || (mode == Mode::END && result != Z_STREAM_END));
+				break;
+			}
+		#endif
+		#ifdef ENABLE_ZSTD
+			case Compression::ZSTD: {
+				ZSTD_inBuffer inBuf{ pbase(), size, 0 };
+				const ZSTD_EndDirective directive{ mode == Mode::END ? ZSTD_e_end : (mode == Mode::FLUSH ? ZSTD_e_flush : ZSTD_e_continue) };
+				size_t remaining;
+				do {
+					ZSTD_outBuffer outBuf{ out.data(), out.size(), 0 };
+					remaining = ZSTD_compressStream2(zcs, &outBuf, &inBuf, directive);
+					if (ZSTD_isError(remaining))
+						throw make_exception("Failed to compress output: ", ZSTD_getErrorName(remaining));
+					writeOut(outBuf.pos);
+				} while (inBuf.pos < inBuf.size || (directive != ZSTD_e_continue && remaining != 0));
+				break;
+			}
+		#endif
+			default:
+				if (sink->sputn(pbase(), static_cast<std::streamsize>(size)) != static_cast<std::streamsize>(size))
+					throw make_exception("Failed to write output!");
+				break;
+			}
+			// one byte is reserved so overflow() can always store its character
+			setp(in.data(), in.data() + in.size() - 1);
+		}
+
+	protected:
+		int_type overflow(int_type c) override
+		{
+			if (!traits_type::eq_int_type(c, traits_type::eof())) {
+				*pptr() = traits_type::to_char_type(c);
+				pbump(1);
+			}
+			compress(Mode::CONTINUE);
+			return traits_type::not_eof(c);
+		}
+		int sync() override
+		{
+			if (finished)
+				return 0;
+			compress(Mode::FLUSH);
+			return sink->pubsync();
+		}
+
+	public:
+		/**
+		 * @brief				Creates a new compressing stream buffer.
+		 * @param sink			The stream buffer that compressed data is written to.
+		 * @param compression	The compression format to use.
+		 */
+		CompressingStreamBuf(std::streambuf* sink, const Compression compression) : sink{ sink }, compression{ compression }, in(BLOCK_SIZE, '\0'), out(BLOCK_SIZE, '\0')
+		{
+			requireSupport(compression);
+			switch (compression) {
+		#ifdef ENABLE_ZLIB
+			case Compression::GZIP:
+				// 15 + 16 writes a gzip header & trailer instead of a zlib one
+				if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+					throw make_exception("Failed to initialize zlib!");
+				break;
+		#endif
+		#ifdef ENABLE_ZSTD
+			case Compression::ZSTD:
+				if (zcs = ZSTD_createCStream(); zcs == nullptr)
+					throw make_exception("Failed to initialize zstd!");
+				break;
+		#endif
+			default:break;
+			}
+			setp(in.data(), in.data() + in.size() - 1);
+		}
+		CompressingStreamBuf(CompressingStreamBuf const&) = delete;
+		CompressingStreamBuf& operator=(CompressingStreamBuf const&) = delete;
+		~CompressingStreamBuf()
+		{
+			try {
+				finish();
+			} catch (...) {}
+		#ifdef ENABLE_ZLIB
+			if (compression == Compression::GZIP)
+				deflateEnd(&zs);
+		#endif
+		#ifdef ENABLE_ZSTD
+			if (zcs != nullptr)
+				ZSTD_freeCStream(zcs);
+		#endif
+		}
+
+		/// @brief	Compresses any remaining data & writes the end of the compressed stream. Nothing can be written afterwards.
+		void finish()
+		{
+			if (finished)
+				return;
+			finished = true;
+			compress(Mode::END);
+			sink->pubsync();
+		}
+	};
+
+	/**
+	 * @class	OutputCompressor
+	 * @brief	Replaces the stream buffer of an output stream with a CompressingStreamBuf, & restores it when destroyed.
+	 */
+	class OutputCompressor {
+		std::ostream& os;
+		std::streambuf* original;
+		CompressingStreamBuf buffer;
+
+	public:
+		OutputCompressor(std::ostream& os, const Compression compression) : os{ os }, original{ os.rdbuf() }, buffer{ original, compression }
+		{
+			os.flush();
+			os.rdbuf(&buffer);
+		}
+		OutputCompressor(OutputCompressor const&) = delete;
+		OutputCompressor& operator=(OutputCompressor const&) = delete;
+		~OutputCompressor()
+		{
+			os.flush();
+			buffer.finish();
+			os.rdbuf(original);
+		}
+	};
+}
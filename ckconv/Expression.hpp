@@ -0,0 +1,533 @@
+#pragma once
+/**
+ * @file	Expression.hpp
+ * @author	radj307
+ * @brief	Arithmetic expressions over mixed units, i.e. "5ft + 3in + 12u to m" or "(wall_len * 2) u to m".
+ * @details	Expressions are compiled to a short list of stack instructions. Units are resolved during compilation, and the factor that-
+ *\n		 -converts each operand to the output unit is folded into the instruction that loads it, so evaluating an expression is only-
+ *\n		 -a handful of multiplications & additions.
+ *\n		Number literals aren't part of a compiled program. Instead, each expression is split into its "shape" *(the expression with-
+ *\n		 -every number replaced by a placeholder)* & its numbers, and programs are cached by shape. Evaluating the same expression with-
+ *\n		 -different numbers, i.e. "5ft + 3in to m" then "6ft + 2in to m", only re-reads the numbers.
+ *\n		Grammar:
+ *\n		  line     := NAME '=' sum | sum 'to' unit (',' unit)*
+ *\n		  sum      := product (('+' | '-') product)*
+ *\n		  product  := unary (('*' | '/') unary)*
+ *\n		  unary    := '-' unary | '+' unary | postfix
+ *\n		  postfix  := primary [unit]
+ *\n		  primary  := NUMBER | NAME | '(' sum ')'
+ *\n		A NAME in the primary position is a variable, which is defined by an earlier "NAME = sum" line. A unit can only be applied to-
+ *\n		 -a dimensionless value; multiplying & dividing values with units adds & subtracts their dimensions *(ft * ft = ft^2)*.
+ */
+#include "conv.hpp"
+#include "global.h"
+#include "RecordWriter.hpp"
+
+#include <make_exception.hpp>
+#include <str.hpp>
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ckconv::expr {
+	/// @brief	The largest number of intermediate values that an expression may need at once.
+	inline constexpr size_t MAX_STACK_DEPTH{ 64 };
+
+	/// @brief	Instruction codes.
+	enum class OpCode : uint8_t {
+		/// @brief	Pushes a number from the expression, multiplied by the instruction's factor.
+		LOAD_NUMBER,
+		/// @brief	Pushes the value of a variable, multiplied by the instruction's factor.
+		LOAD_VARIABLE,
+		/// @brief	Multiplies the top value by the instruction's factor.
+		SCALE,
+		ADD,
+		SUBTRACT,
+		MULTIPLY,
+		DIVIDE,
+	};
+
+	/**
+	 * @struct	Instruction
+	 * @brief	One stack instruction.
+	 */
+	struct Instruction {
+		OpCode op;
+		/// @brief	The index of the number or variable to load.
+		uint32_t index{ 0 };
+		conv::number_t factor{ 1.0L };
+	};
+
+	/**
+	 * @struct	Variable
+	 * @brief	The value of a variable, in meters raised to its dimension.
+	 */
+	struct Variable {
+		conv::number_t value;
+		/// @brief	The dimension exponent. *(0 = dimensionless, 1 = length, 2 = area, 3 = volume)*
+		unsigned dimension;
+	};
+	using variable_map = std::unordered_map<std::string, Variable>;
+
+	/**
+	 * @struct	Token
+	 * @brief	One token of an expression.
+	 */
+	struct Token {
+		enum class Kind : uint8_t {
+			NUMBER,
+			NAME,
+			SYMBOL,
+		};
+		Kind kind;
+		/// @brief	The text of the token, which points into the expression.
+		std::string_view text;
+		/// @brief	The index of the number in the expression's numbers, for NUMBER tokens.
+		uint32_t index{ 0 };
+
+		bool is(const char c) const noexcept { return kind == Kind::SYMBOL && text.front() == c; }
+		bool isName(std::string_view const& name) const noexcept { return kind == Kind::NAME && text == name; }
+	};
+
+	/// @brief	Checks if the given character can start a name. UTF-8 bytes are allowed, for units like "µm" & "m²".
+	constexpr bool isNameStart(const char c) noexcept
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '\'' || c == '"' || static_cast<unsigned char>(c) >= 0x80;
+	}
+	/// @brief	Checks if the given character can be part of a name.
+	constexpr bool isNameChar(const char c) noexcept
+	{
+		return isNameStart(c) || (c >= '0' && c <= '9') || c == '^';
+	}
+	constexpr bool isDigit(const char c) noexcept { return c >= '0' && c <= '9'; }
+
+	/**
+	 * @brief			Splits an expression into tokens, its shape, & its numbers.
+	 * @param s			The expression. The tokens point into this string.
+	 * @param tokens	Receives the tokens.
+	 * @param shape		Receives the expression with each number replaced by '#', which is used to find a compiled program.
+	 * @param numbers	Receives the value of each number.
+	 */
+	inline void tokenize(std::string_view const& s, std::vector<Token>& tokens, std::string& shape, std::vector<conv::number_t>& numbers)
+	{
+		tokens.clear();
+		shape.clear();
+		numbers.clear();
+
+		for (size_t i{ 0ull }; i < s.size(); ) {
+			const char c{ s[i] };
+			if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+				++i;
+				continue;
+			}
+
+			const size_t begin{ i };
+			if (isDigit(c) || (c == '.' && i + 1 < s.size() && isDigit(s[i + 1]))) {
+				while (i < s.size() && (isDigit(s[i]) || s[i] == '.'))
+					++i;
+				// exponents are only part of the number when they're followed by digits, so "5em" is 5 of the unit "em"
+				if (i < s.size() && (s[i] == 'e' || s[i] == 'E')) {
+					const size_t digit{ i + 1 < s.size() && (s[i + 1] == '+' || s[i + 1] == '-') ? i + 2 : i + 1 };
+					if (digit < s.size() && isDigit(s[digit])) {
+						i = digit;
+						while (i < s.size() && isDigit(s[i]))
+							++i;
+					}
+				}
+				conv::number_t value{};
+				if (const auto& [end, ec] { std::from_chars(s.data() + begin, s.data() + i, value) }; ec != std::errc{} || end != s.data() + i)
+					throw make_exception("Invalid number '", s.substr(begin, i - begin), "'!");
+				tokens.emplace_back(Token{ Token::Kind::NUMBER, s.substr(begin, i - begin), static_cast<uint32_t>(numbers.size()) });
+				numbers.emplace_back(value);
+				shape += '#';
+			}
+			else if (isNameStart(c)) {
+				while (i < s.size() && isNameChar(s[i]))
+					++i;
+				tokens.emplace_back(Token{ Token::Kind::NAME, s.substr(begin, i - begin) });
+				// names are separated so that adjacent names can't form a different shape, i.e. "sq ft" & "sqft"
+				shape += ' ';
+				shape += tokens.back().text;
+				shape += ' ';
+			}
+			else if (std::string_view{ "+-*/()=," }.find(c) != std::string_view::npos) {
+				tokens.emplace_back(Token{ Token::Kind::SYMBOL, s.substr(i++, 1) });
+				shape += c;
+			}
+			else throw make_exception("Unexpected character '", c, "' in expression '", s, "'!");
+		}
+	}
+
+	/**
+	 * @class	Program
+	 * @brief	A compiled expression, which can be evaluated with any numbers that have the same shape.
+	 */
+	class Program {
+		friend class Compiler;
+
+		std::vector<Instruction> code;
+		/// @brief	The variables that are loaded by the program, & the dimension that each was compiled with.
+		std::vector<std::pair<std::string, unsigned>> variables;
+		/// @brief	The dimension of the result.
+		unsigned dimension{ 0 };
+
+	public:
+		/// @brief	The variable that this program defines, or an empty string if it converts to output units instead.
+		std::string definition;
+		/// @brief	The output units, & the factor that converts the result to each of them.
+		std::vector<std::pair<conv::Unit, conv::number_t>> outputs;
+
+		unsigned getDimension() const noexcept { return dimension; }
+
+		/// @brief	Checks if every variable used by this program is defined with the dimension that it was compiled with.
+		bool isValidFor(variable_map const& vars) const
+		{
+			for (const auto& [name, dim] : variables)
+				if (const auto& it{ vars.find(name) }; it == vars.end() || it->second.dimension != dim)
+					return false;
+			return true;
+		}
+
+		/**
+		 * @brief			Evaluates the program.
+		 * @param numbers	The numbers from an expression with the same shape as the one that this program was compiled from.
+		 * @param vars		Variables. These must be valid for this program.
+		 * @returns			The result, in the first output unit *(or meters raised to its dimension, for definitions)*.
+		 */
+		conv::number_t evaluate(std::span<const conv::number_t> numbers, variable_map const& vars) const
+		{
+			std::array<conv::number_t, MAX_STACK_DEPTH> stack;
+			size_t top{ 0ull };
+			for (const auto& in : code) {
+				switch (in.op) {
+				case OpCode::LOAD_NUMBER:
+					stack[top++] = numbers[in.index] * in.factor;
+					break;
+				case OpCode::LOAD_VARIABLE:
+					stack[top++] = vars.at(variables[in.index].first).value * in.factor;
+					break;
+				case OpCode::SCALE:
+					stack[top - 1] *= in.factor;
+					break;
+				case OpCode::ADD:
+					--top;
+					stack[top - 1] += stack[top];
+					break;
+				case OpCode::SUBTRACT:
+					--top;
+					stack[top - 1] -= stack[top];
+					break;
+				case OpCode::MULTIPLY:
+					--top;
+					stack[top - 1] *= stack[top];
+					break;
+				case OpCode::DIVIDE:
+					--top;
+					stack[top - 1] /= stack[top];
+					break;
+				}
+			}
+			return stack[0];
+		}
+	};
+
+	/**
+	 * @class	Compiler
+	 * @brief	Recursive-descent compiler for the grammar described in Expression.hpp.
+	 */
+	class Compiler {
+		std::span<const Token> tokens;
+		variable_map const& vars;
+		size_t pos{ 0ull };
+		/// @brief	The length unit that every operand is converted to. Its dimension is always 1.
+		conv::Unit base;
+		Program program;
+		size_t depth{ 0ull };
+
+		/// @brief	The result of compiling part of an expression.
+		struct Value {
+			/// @brief	The index of the first instruction of this value.
+			size_t start;
+			unsigned dimension;
+		};
+
+		bool atEnd() const noexcept { return pos >= tokens.size(); }
+		Token const& peek() const { return tokens[pos]; }
+		[[noreturn]] void fail(std::string_view const& expected) const
+		{
+			if (atEnd())
+				throw make_exception("Expected ", expected, " at the end of the expression!");
+			throw make_exception("Expected ", expected, " instead of '", peek().text, "'!");
+		}
+
+		void push(Instruction const& in)
+		{
+			if (in.op == OpCode::LOAD_NUMBER || in.op == OpCode::LOAD_VARIABLE) {
+				if (++depth > MAX_STACK_DEPTH)
+					throw make_exception("Expression is too complex!");
+			}
+			else if (in.op != OpCode::SCALE)
+				--depth;
+			program.code.emplace_back(in);
+		}
+		/// @brief	Multiplies a value by a constant, which is folded into the previous instruction when possible.
+		void scale(Value const& value, const conv::number_t factor)
+		{
+			auto& last{ program.code.back() };
+			if (last.op == OpCode::SCALE || program.code.size() - value.start == 1ull)
+				last.factor *= factor;
+			else push({ OpCode::SCALE, 0, factor });
+		}
+
+		/// @brief	Reads a unit name, which may be split into two names *(i.e. "sq ft")*.
+		std::string unitName()
+		{
+			if (atEnd() || peek().kind != Token::Kind::NAME)
+				fail("a unit");
+			std::string name{ tokens[pos++].text };
+			if (str::equalsAny<true>(name, "sq", "square", "cu", "cubic") && !atEnd() && peek().kind == Token::Kind::NAME && !peek().isName("to")) {
+				name += ' ';
+				name += tokens[pos++].text;
+			}
+			return name;
+		}
+		conv::Unit unit() { return conv::getUnit(unitName()); }
+		/// @brief	Gets the factor that converts the given unit to the base unit raised to the same dimension.
+		conv::number_t factorOf(conv::Unit const& unit) const
+		{
+			return conv::getConversionFactor(unit, base.WithDimension(unit.GetDimension()));
+		}
+
+		Value primary()
+		{
+			const Value value{ program.code.size(), 0 };
+			if (atEnd())
+				fail("a number, variable, or '('");
+			const auto& token{ tokens[pos++] };
+			if (token.kind == Token::Kind::NUMBER) {
+				push({ OpCode::LOAD_NUMBER, token.index, 1.0L });
+				return value;
+			}
+			if (token.kind == Token::Kind::NAME) {
+				const std::string name{ token.text };
+				const auto& it{ vars.find(name) };
+				if (it == vars.end())
+					throw make_exception("Undefined variable '", name, "'! Units must follow a number or parentheses.");
+				const unsigned dim{ it->second.dimension };
+				program.variables.emplace_back(name, dim);
+				push({ OpCode::LOAD_VARIABLE, static_cast<uint32_t>(program.variables.size() - 1), dim == 0 ? 1.0L : conv::getConversionFactor(conv::Metric.METER->WithDimension(dim), base.WithDimension(dim)) });
+				return { value.start, dim };
+			}
+			if (token.is('(')) {
+				const auto& inner{ sum() };
+				if (atEnd() || !peek().is(')'))
+					fail("')'");
+				++pos;
+				return { value.start, inner.dimension };
+			}
+			--pos;
+			fail("a number, variable, or '('");
+		}
+		Value postfix()
+		{
+			auto value{ primary() };
+			if (!atEnd() && peek().kind == Token::Kind::NAME && !peek().isName("to")) {
+				if (value.dimension != 0)
+					throw make_exception("Unit '", peek().text, "' can't be applied to a value that already has a unit!");
+				const auto& u{ unit() };
+				scale(value, factorOf(u));
+				value.dimension = u.GetDimension();
+			}
+			return value;
+		}
+		Value unary()
+		{
+			if (!atEnd() && (peek().is('-') || peek().is('+'))) {
+				const bool negate{ tokens[pos++].is('-') };
+				const auto& value{ unary() };
+				if (negate)
+					scale(value, -1.0L);
+				return value;
+			}
+			return postfix();
+		}
+		Value product()
+		{
+			auto value{ unary() };
+			while (!atEnd() && (peek().is('*') || peek().is('/'))) {
+				const bool multiply{ tokens[pos++].is('*') };
+				const auto& rhs{ unary() };
+				if (multiply) {
+					if (value.dimension + rhs.dimension > conv::MAX_DIMENSION)
+						throw make_exception("Expression has a dimension greater than ", conv::MAX_DIMENSION, '!');
+					value.dimension += rhs.dimension;
+				}
+				else {
+					if (rhs.dimension > value.dimension)
+						throw make_exception("Expression has a negative dimension!");
+					value.dimension -= rhs.dimension;
+				}
+				push({ multiply ? OpCode::MULTIPLY : OpCode::DIVIDE });
+			}
+			return value;
+		}
+		Value sum()
+		{
+			auto value{ product() };
+			while (!atEnd() && (peek().is('+') || peek().is('-'))) {
+				const bool add{ tokens[pos++].is('+') };
+				const auto& rhs{ product() };
+				if (rhs.dimension != value.dimension)
+					throw make_exception("Can't ", add ? "add" : "subtract", " values with different dimensions! (", value.dimension, " != ", rhs.dimension, ')');
+				push({ add ? OpCode::ADD : OpCode::SUBTRACT });
+			}
+			return value;
+		}
+
+	public:
+		Compiler(std::span<const Token> tokens, variable_map const& vars) : tokens{ tokens }, vars{ vars }, base{ *conv::Metric.METER } {}
+
+		/// @brief	Compiles the tokens.
+		Program compile() &&
+		{
+			// NAME '=' sum
+			if (tokens.size() > 2ull && tokens[0].kind == Token::Kind::NAME && tokens[1].is('=')) {
+				program.definition = tokens[0].text;
+				pos = 2ull;
+				program.dimension = sum().dimension;
+				if (!atEnd())
+					fail("the end of the expression");
+				return std::move(program);
+			}
+
+			// sum 'to' unit (',' unit)* ; the output units are needed first, since they determine the base unit
+			size_t to{ 0ull };
+			for (size_t i{ 0ull }, level{ 0ull }; i < tokens.size() && to == 0ull; ++i) {
+				if (tokens[i].is('('))
+					++level;
+				else if (tokens[i].is(')') && level != 0ull)
+					--level;
+				else if (level == 0ull && tokens[i].isName("to"))
+					to = i;
+			}
+			if (to == 0ull)
+				throw make_exception("Expected 'to <UNIT>' at the end of the expression!");
+
+			pos = to + 1ull;
+			const auto& firstName{ unitName() };
+			const auto& first{ conv::getUnit(firstName) };
+			// areas & volumes can't be reduced to a length unit, so it's resolved from the name instead
+			base = first.GetDimension() == 1 ? first : conv::getUnit(std::string{ conv::parseDimension(firstName).unit });
+			program.outputs.emplace_back(first, 1.0L);
+			while (!atEnd() && peek().is(',')) {
+				++pos;
+				const auto& out{ unit() };
+				program.outputs.emplace_back(out, conv::getConversionFactor(first, out));
+			}
+			if (!atEnd())
+				fail("the end of the expression");
+
+			tokens = tokens.first(to);
+			pos = 0ull;
+			program.dimension = sum().dimension;
+			if (!atEnd())
+				fail("'to'");
+			if (program.dimension != first.GetDimension())
+				throw make_exception("Can't convert an expression with dimension ", program.dimension, " to a unit with dimension ", first.GetDimension(), '!');
+			return std::move(program);
+		}
+	};
+
+	/**
+	 * @class	Evaluator
+	 * @brief	Evaluates expressions one line at a time, caching compiled programs by shape & keeping the values of variables.
+	 */
+	class Evaluator {
+		std::unordered_map<std::string, Program> programs;
+		variable_map vars;
+		// reused between lines
+		std::vector<Token> tokens;
+		std::string shape;
+		std::vector<conv::number_t> numbers;
+		// color sequences
+		std::string inputColor, resultColor, unitColor, reset;
+
+		template<typename T>
+		static std::string render(T&& value)
+		{
+			std::stringstream ss;
+			ss << std::forward<T>(value);
+			return ss.str();
+		}
+
+	public:
+		/// @brief	Creates an evaluator. This must be created after the output options are set.
+		Evaluator() :
+			inputColor{ render(global.csync(global.InputColor)) },
+			resultColor{ render(global.csync(global.ResultColor)) },
+			unitColor{ render(global.csync(global.UnitColor)) },
+			reset{ render(global.csync()) }
+		{}
+
+		/**
+		 * @brief			Evaluates one expression, & appends its result to the output buffer using the current output options.
+		 *\n				Definitions don't produce any output.
+		 * @param line		The expression.
+		 * @param buffer	Output buffer.
+		 * @param writer	Writes results when a structured output format is used.
+		 */
+		void evaluate(std::string_view const& line, std::string& buffer, RecordWriter const& writer)
+		{
+			tokenize(line, tokens, shape, numbers);
+			if (tokens.empty())
+				return;
+
+			auto it{ programs.find(shape) };
+			if (it == programs.end())
+				it = programs.emplace(shape, Compiler{ tokens, vars }.compile()).first;
+			// a variable was redefined with a different dimension since the program was compiled
+			else if (!it->second.isValidFor(vars))
+				it->second = Compiler{ tokens, vars }.compile();
+
+			const auto& program{ it->second };
+			const auto& result{ program.evaluate(numbers, vars) };
+			if (!program.definition.empty()) {
+				vars.insert_or_assign(program.definition, Variable{ result, program.getDimension() });
+				return;
+			}
+
+			for (const auto& [unit, factor] : program.outputs) {
+				const auto& value{ result * factor };
+				if (global.outputFormat != OutputFormat::HUMAN)
+					writer.writeResult(buffer, line, {}, value, format_unit(unit, true));
+				else {
+					if (!global.quiet) {
+						buffer += inputColor;
+						buffer += line;
+						buffer += reset;
+						buffer += " = ";
+					}
+					buffer += resultColor;
+					append_fp(buffer, value);
+					buffer += reset;
+					if (!global.quiet) {
+						buffer += ' ';
+						buffer += unitColor;
+						buffer += format_unit(unit, value != 1.0L);
+						buffer += reset;
+					}
+					buffer += '\n';
+				}
+			}
+		}
+	};
+}
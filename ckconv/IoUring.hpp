@@ -0,0 +1,561 @@
+#pragma once
+/**
+ * @file	IoUring.hpp
+ * @author	radj307
+ * @brief	Asynchronous file input & output using Linux io_uring, for converting large files without waiting on storage.
+ * @details	Reads & writes are submitted to a ring that is shared with the kernel *(see io_uring(7))*, using buffers that are registered-
+ *\n		 -with the kernel once instead of being mapped for every request:
+ *\n		  FileReader	Keeps the next block of a regular file in flight while the previous block is decompressed & parsed.
+ *\n		  FileWriter	Output stream buffer that hands full blocks to the kernel & keeps filling the next one; submissions are batched.
+ *\n		  AsyncOutput	Writes an output stream through a FileWriter when its file descriptor is a regular file.
+ *\n		Only regular files are supported, since blocks are read & written at explicit offsets. Nothing here is used when io_uring isn't-
+ *\n		 -available *(old kernels, seccomp filters, or kernel.io_uring_disabled)*; the portable path in CompressedStream.hpp is used instead.
+ *\n		This is enabled by the ENABLE_IO_URING definition, which is set by CMake on Linux when <linux/io_uring.h> is found.
+ */
+#include <make_exception.hpp>
+
+#ifdef ENABLE_IO_URING
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <streambuf>
+#include <string_view>
+#include <utility>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+// <linux/fs.h> defines a BLOCK_SIZE macro that conflicts with io::BLOCK_SIZE
+#undef BLOCK_SIZE
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace ckconv::io::uring {
+	/// @brief	When false, io_uring is never used. This is set by --no-io-uring before any files are opened.
+	inline bool enabled{ true };
+
+	/// @brief	Returns true when the given file descriptor can be used with io_uring, which requires a regular file that isn't opened for appending.
+	inline bool isSupported(const int fd) noexcept
+	{
+		struct stat st;
+		if (!enabled || fstat(fd, &st) == -1 || !S_ISREG(st.st_mode))
+			return false;
+		const int flags{ fcntl(fd, F_GETFL) };
+		// writes to a file opened with O_APPEND ignore their offset
+		return flags != -1 && (flags & O_APPEND) == 0;
+	}
+
+	/**
+	 * @class	Ring
+	 * @brief	A minimal io_uring instance with registered buffers. Submission & completion queue entries are accessed directly through the-
+	 *\n		 -memory that is shared with the kernel, so the only system call per batch is io_uring_enter.
+	 */
+	class Ring {
+		int fd{ -1 };
+		void* sqMemory{ MAP_FAILED };
+		void* cqMemory{ MAP_FAILED };
+		size_t sqSize{ 0 }, cqSize{ 0 };
+		io_uring_sqe* sqes{ static_cast<io_uring_sqe*>(MAP_FAILED) };
+		size_t sqesSize{ 0 };
+
+		unsigned* sqTail{ nullptr };
+		unsigned* sqArray{ nullptr };
+		unsigned sqMask{ 0 }, sqEntries{ 0 };
+		unsigned* cqHead{ nullptr };
+		unsigned* cqTail{ nullptr };
+		io_uring_cqe* cqes{ nullptr };
+		unsigned cqMask{ 0 };
+
+		/// @brief	The number of entries that have been prepared but not yet submitted.
+		unsigned unsubmitted{ 0 };
+		/// @brief	The number of requests that have been submitted but not yet completed.
+		unsigned inFlight{ 0 };
+
+		void close() noexcept
+		{
+			if (sqes != MAP_FAILED)
+				munmap(sqes, sqesSize);
+			if (cqMemory != MAP_FAILED && cqMemory != sqMemory)
+				munmap(cqMemory, cqSize);
+			if (sqMemory != MAP_FAILED)
+				munmap(sqMemory, sqSize);
+			if (fd != -1)
+				::close(fd);
+		}
+
+		/// @brief	Submits every prepared entry, & waits until at least minComplete requests have completed.
+		void enter(unsigned minComplete)
+		{
+			do {
+				const long count{ syscall(__NR_io_uring_enter, fd, unsubmitted, minComplete, (minComplete != 0 ? IORING_ENTER_GETEVENTS : 0u), nullptr, 0) };
+				if (count == -1) {
+					if (errno == EINTR)
+						continue;
+					throw make_exception("Failed to submit I/O requests! (errno ", errno, ')');
+				}
+				unsubmitted -= static_cast<unsigned>(count);
+				inFlight += static_cast<unsigned>(count);
+				// the kernel only waits once everything has been submitted
+				if (unsubmitted == 0)
+					break;
+			} while (true);
+		}
+
+	public:
+		/**
+		 * @brief			Creates a ring & registers the given buffers with it.
+		 * @param entries	The maximum number of requests that can be in flight at once.
+		 * @param buffers	The buffers that requests can use, by index.
+		 *\n				This throws when io_uring isn't available; use open() to fall back instead.
+		 */
+		Ring(const unsigned entries, std::span<const iovec> buffers)
+		{
+			io_uring_params params{};
+			fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+			if (fd == -1)
+				throw make_exception("Failed to create an io_uring instance! (errno ", errno, ')');
+
+			sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+			cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+			// newer kernels map both rings with a single mapping
+			if (params.features & IORING_FEAT_SINGLE_MMAP)
+				sqSize = cqSize = std::max(sqSize, cqSize);
+			sqMemory = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+			if (sqMemory == MAP_FAILED) {
+				close();
+				throw make_exception("Failed to map the io_uring submission queue!");
+			}
+			cqMemory = (params.features & IORING_FEAT_SINGLE_MMAP) ? sqMemory : mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+			sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+			if (cqMemory != MAP_FAILED)
+				sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+			if (cqMemory == MAP_FAILED || sqes == MAP_FAILED) {
+				close();
+				throw make_exception("Failed to map the io_uring completion queue!");
+			}
+
+			auto* const sq{ static_cast<char*>(sqMemory) };
+			sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+			sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+			sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+			sqEntries = params.sq_entries;
+			auto* const cq{ static_cast<char*>(cqMemory) };
+			cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+			cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+			cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+			cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+
+			// registration fails when the buffers exceed RLIMIT_MEMLOCK on older kernels
+			if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, buffers.data(), static_cast<unsigned>(buffers.size())) == -1) {
+				const int error{ errno };
+				close();
+				throw make_exception("Failed to register I/O buffers! (errno ", error, ')');
+			}
+		}
+		Ring(Ring const&) = delete;
+		Ring& operator=(Ring const&) = delete;
+		~Ring() { close(); }
+
+		/**
+		 * @brief			Creates a ring if io_uring is available.
+		 * @param entries	The maximum number of requests that can be in flight at once.
+		 * @param buffers	The buffers that requests can use, by index.
+		 * @returns			The ring, or nullptr when io_uring isn't available.
+		 */
+		static std::unique_ptr<Ring> open(const unsigned entries, std::span<const iovec> buffers)
+		{
+			if (!enabled)
+				return nullptr;
+			try {
+				return std::make_unique<Ring>(entries, buffers);
+			} catch (const std::exception&) {
+				return nullptr;
+			}
+		}
+
+		/**
+		 * @brief				Prepares a read or write request using a registered buffer. It isn't submitted until submit() or wait() is called.
+		 * @param opcode		IORING_OP_READ_FIXED or IORING_OP_WRITE_FIXED.
+		 * @param fileFd		The file to read from or write to.
+		 * @param bufferIndex	The index of the registered buffer, which is also returned in the completion.
+		 * @param data			The part of the registered buffer to use.
+		 * @param length		The number of bytes to read or write.
+		 * @param offset		The offset in the file.
+		 */
+		void prepare(const uint8_t opcode, const int fileFd, const unsigned bufferIndex, char* const data, const size_t length, const off_t offset)
+		{
+			if (inFlight + unsubmitted == sqEntries)
+				throw make_exception("The io_uring submission queue is full!");
+			const unsigned tail{ *sqTail };
+			const unsigned index{ tail & sqMask };
+			io_uring_sqe& sqe{ sqes[index] };
+			sqe = io_uring_sqe{};
+			sqe.opcode = opcode;
+			sqe.fd = fileFd;
+			sqe.addr = reinterpret_cast<uint64_t>(data);
+			sqe.len = static_cast<uint32_t>(length);
+			sqe.off = static_cast<uint64_t>(offset);
+			sqe.buf_index = static_cast<uint16_t>(bufferIndex);
+			sqe.user_data = bufferIndex;
+			sqArray[index] = index;
+			// the kernel may read the entry as soon as it sees the new tail
+			std::atomic_ref<unsigned>{ *sqTail }.store(tail + 1, std::memory_order_release);
+			++unsubmitted;
+		}
+
+		/// @brief	Returns the number of prepared requests that haven't been submitted yet.
+		unsigned pending() const noexcept { return unsubmitted; }
+
+		/// @brief	Submits every prepared request without waiting for any of them.
+		void submit()
+		{
+			if (unsubmitted != 0)
+				enter(0);
+		}
+
+		/**
+		 * @brief				Waits for the next completed request, submitting any prepared requests first.
+		 * @returns				The buffer index of the request & its result, which is a byte count or a negated errno value.
+		 */
+		std::pair<unsigned, int> wait()
+		{
+			while (true) {
+				const unsigned head{ *cqHead };
+				if (head != std::atomic_ref<unsigned>{ *cqTail }.load(std::memory_order_acquire)) {
+					const io_uring_cqe& cqe{ cqes[head & cqMask] };
+					const std::pair<unsigned, int> result{ static_cast<unsigned>(cqe.user_data), cqe.res };
+					std::atomic_ref<unsigned>{ *cqHead }.store(head + 1, std::memory_order_release);
+					--inFlight;
+					return result;
+				}
+				if (inFlight + unsubmitted == 0)
+					throw make_exception("There are no I/O requests to wait for!");
+				enter(1);
+			}
+		}
+
+		/// @brief	Returns the number of requests that have been submitted but not completed.
+		unsigned outstanding() const noexcept { return inFlight + unsubmitted; }
+	};
+
+	/**
+	 * @class	FileReader
+	 * @brief	Reads a regular file one block at a time, with the next block already in flight while the current block is used.
+	 */
+	class FileReader {
+		/// @brief	A registered buffer & the block of the file that was read into it.
+		struct Slot {
+			std::unique_ptr<char[]> data;
+			off_t offset{ 0 };
+			size_t length{ 0 };
+			bool pending{ false };
+		};
+
+		int fd;
+		size_t blockSize;
+		std::array<Slot, 2> slots;
+		std::unique_ptr<Ring> ring;
+		/// @brief	The offset of the next block that will be requested.
+		off_t nextOffset;
+		/// @brief	The offset of the end of the last block that was returned.
+		off_t endOffset;
+		/// @brief	The index of the slot that next() returns.
+		unsigned current{ 0 };
+		bool handedOut{ false };
+		bool eof{ false };
+
+		void request(const unsigned index)
+		{
+			Slot& slot{ slots[index] };
+			slot.offset = nextOffset;
+			slot.length = 0;
+			slot.pending = true;
+			nextOffset += static_cast<off_t>(blockSize);
+			ring->prepare(IORING_OP_READ_FIXED, fd, index, slot.data.get(), blockSize, slot.offset);
+		}
+
+		/// @brief	Waits until the given slot has been read.
+		void wait(Slot& slot)
+		{
+			while (slot.pending) {
+				const auto [index, result] { ring->wait() };
+				Slot& completed{ slots[index] };
+				completed.pending = false;
+				// the kernel may return EAGAIN or EINTR instead of retrying; the block is read synchronously in that case
+				if (result < 0 && result != -EAGAIN && result != -EINTR)
+					throw make_exception("Failed to read input! (errno ", -result, ')');
+				completed.length = result < 0 ? 0 : static_cast<size_t>(result);
+			}
+			// blocks are read at fixed offsets, so a short read must be completed before the next block is used
+			for (ssize_t count; slot.length < blockSize; slot.length += static_cast<size_t>(count)) {
+				count = pread(fd, slot.data.get() + slot.length, blockSize - slot.length, slot.offset + static_cast<off_t>(slot.length));
+				if (count == -1) {
+					if (errno == EINTR) {
+						count = 0;
+						continue;
+					}
+					throw make_exception("Failed to read input! (errno ", errno, ')');
+				}
+				if (count == 0)
+					break;
+			}
+		}
+
+	public:
+		FileReader(const int fd, const size_t blockSize, std::unique_ptr<Ring>&& ring, std::array<Slot, 2>&& slots) : fd{ fd }, blockSize{ blockSize }, slots{ std::move(slots) }, ring{ std::move(ring) }, nextOffset{ std::max<off_t>(lseek(fd, 0, SEEK_CUR), 0) }, endOffset{ nextOffset }
+		{
+			// both blocks are submitted with a single system call
+			request(0);
+			request(1);
+			this->ring->submit();
+		}
+		FileReader(FileReader const&) = delete;
+		FileReader& operator=(FileReader const&) = delete;
+		~FileReader()
+		{
+			// the buffers must outlive any reads that are still in flight
+			try {
+				while (ring->outstanding() != 0)
+					ring->wait();
+			} catch (...) {}
+			// leave the file position after the data that was actually used, as read() would have
+			lseek(fd, endOffset, SEEK_SET);
+		}
+
+		/**
+		 * @brief			Creates a reader for the given file if it is a regular file & io_uring is available.
+		 * @param fd		The file descriptor to read.
+		 * @param blockSize	The size of each block.
+		 * @returns			The reader, or nullptr when the portable path should be used instead.
+		 */
+		static std::unique_ptr<FileReader> open(const int fd, const size_t blockSize)
+		{
+			if (!isSupported(fd))
+				return nullptr;
+			std::array<Slot, 2> slots;
+			std::array<iovec, 2> buffers;
+			for (size_t i{ 0 }; i < slots.size(); ++i) {
+				slots[i].data = std::make_unique_for_overwrite<char[]>(blockSize);
+				buffers[i] = { slots[i].data.get(), blockSize };
+			}
+			auto ring{ Ring::open(static_cast<unsigned>(slots.size()), buffers) };
+			if (ring == nullptr)
+				return nullptr;
+			return std::make_unique<FileReader>(fd, blockSize, std::move(ring), std::move(slots));
+		}
+
+		/**
+		 * @brief		Gets the next block of the file.
+		 * @returns		The block, which is valid until the next call; or an empty view at the end of the file.
+		 */
+		std::string_view next()
+		{
+			if (eof && !slots[current].pending)
+				return {};
+			// the caller is finished with the block returned by the previous call, so its buffer is reused for the block after this one
+			if (handedOut && !eof) {
+				request(current ^ 1u);
+				ring->submit();
+			}
+			Slot& slot{ slots[current] };
+			wait(slot);
+			if (slot.length < blockSize)
+				eof = true;
+			handedOut = true;
+			if (slot.length != 0)
+				endOffset = slot.offset + static_cast<off_t>(slot.length);
+			current ^= 1u;
+			return { slot.data.get(), slot.length };
+		}
+	};
+
+	/// @brief	The number of registered buffers used by a FileWriter.
+	inline constexpr unsigned WRITE_BUFFER_COUNT{ 4 };
+	/// @brief	The number of full buffers that are submitted together.
+	inline constexpr unsigned WRITE_BATCH_SIZE{ 2 };
+
+	/**
+	 * @class	FileWriter
+	 * @brief	Output stream buffer that writes to a regular file through io_uring. Each full buffer is written asynchronously while the next-
+	 *\n		 -buffer is filled; writes are only waited on when every buffer is in flight, or when the stream is flushed.
+	 *\n		The file position is advanced past each buffer when it is queued, so anything else that writes to the same open file *(i.e.-
+	 *\n		 -STDERR, when both are redirected with "> out.txt 2>&1")* writes after it rather than over it.
+	 */
+	class FileWriter : public std::streambuf {
+		struct Slot {
+			std::unique_ptr<char[]> data;
+			off_t offset{ 0 };
+			size_t length{ 0 };
+			bool pending{ false };
+		};
+
+		int fd;
+		size_t blockSize;
+		std::array<Slot, WRITE_BUFFER_COUNT> slots;
+		std::unique_ptr<Ring> ring;
+		/// @brief	The index of the slot that is being filled.
+		unsigned current{ 0 };
+
+		void complete(const unsigned index, const int result)
+		{
+			Slot& slot{ slots[index] };
+			slot.pending = false;
+			if (result < 0 && result != -EAGAIN && result != -EINTR)
+				throw make_exception("Failed to write output! (errno ", -result, ')');
+			// finish a short write synchronously, since the next buffer may already have been written after it
+			for (size_t pos{ result < 0 ? 0 : static_cast<size_t>(result) }; pos < slot.length; ) {
+				const ssize_t count{ pwrite(fd, slot.data.get() + pos, slot.length - pos, slot.offset + static_cast<off_t>(pos)) };
+				if (count == -1) {
+					if (errno == EINTR)
+						continue;
+					throw make_exception("Failed to write output! (errno ", errno, ')');
+				}
+				pos += static_cast<size_t>(count);
+			}
+		}
+
+		/// @brief	Queues the current buffer to be written, & moves on to the next buffer once it is free.
+		void queue()
+		{
+			Slot& slot{ slots[current] };
+			slot.length = static_cast<size_t>(pptr() - pbase());
+			if (slot.length != 0) {
+				// reserve the range that the buffer is written to by moving the file position past it, since the position may have been-
+				//  -moved by other writes to the same open file since the last buffer was queued
+				const off_t end{ lseek(fd, static_cast<off_t>(slot.length), SEEK_CUR) };
+				if (end == -1)
+					throw make_exception("Failed to write output! (errno ", errno, ')');
+				slot.offset = end - static_cast<off_t>(slot.length);
+				slot.pending = true;
+				ring->prepare(IORING_OP_WRITE_FIXED, fd, current, slot.data.get(), slot.length, slot.offset);
+				if (ring->pending() >= WRITE_BATCH_SIZE)
+					ring->submit();
+
+				current = (current + 1) % WRITE_BUFFER_COUNT;
+				while (slots[current].pending) {
+					const auto [index, result] { ring->wait() };
+					complete(index, result);
+				}
+			}
+			// one byte is reserved so overflow() can always store its character
+			setp(slots[current].data.get(), slots[current].data.get() + blockSize - 1);
+		}
+
+		/// @brief	Waits for every write to complete. The file position is already at the end of the written data.
+		void drain()
+		{
+			while (ring->outstanding() != 0) {
+				const auto [index, result] { ring->wait() };
+				complete(index, result);
+			}
+		}
+
+	protected:
+		int_type overflow(int_type c) override
+		{
+			if (!traits_type::eq_int_type(c, traits_type::eof())) {
+				*pptr() = traits_type::to_char_type(c);
+				pbump(1);
+			}
+			queue();
+			return traits_type::not_eof(c);
+		}
+		int sync() override
+		{
+			queue();
+			drain();
+			return 0;
+		}
+
+	public:
+		FileWriter(const int fd, const size_t blockSize, std::unique_ptr<Ring>&& ring, std::array<Slot, WRITE_BUFFER_COUNT>&& slots) : fd{ fd }, blockSize{ blockSize }, slots{ std::move(slots) }, ring{ std::move(ring) }
+		{
+			setp(this->slots[current].data.get(), this->slots[current].data.get() + blockSize - 1);
+		}
+		FileWriter(FileWriter const&) = delete;
+		FileWriter& operator=(FileWriter const&) = delete;
+		~FileWriter()
+		{
+			try {
+				sync();
+			} catch (...) {
+				// the buffers must outlive any writes that are still in flight
+				try {
+					while (ring->outstanding() != 0)
+						ring->wait();
+				} catch (...) {}
+			}
+		}
+
+		/**
+		 * @brief			Creates a writer for the given file if it is a regular file & io_uring is available.
+		 * @param fd		The file descriptor to write. Writing starts at its current position.
+		 * @param blockSize	The size of each buffer.
+		 * @returns			The writer, or nullptr when the portable path should be used instead.
+		 */
+		static std::unique_ptr<FileWriter> open(const int fd, const size_t blockSize)
+		{
+			// the file position is used to reserve the range of each buffer, so the file must be seekable
+			if (!isSupported(fd) || lseek(fd, 0, SEEK_CUR) == -1)
+				return nullptr;
+			std::array<Slot, WRITE_BUFFER_COUNT> slots;
+			std::array<iovec, WRITE_BUFFER_COUNT> buffers;
+			for (size_t i{ 0 }; i < slots.size(); ++i) {
+				slots[i].data = std::make_unique_for_overwrite<char[]>(blockSize);
+				buffers[i] = { slots[i].data.get(), blockSize };
+			}
+			auto ring{ Ring::open(WRITE_BUFFER_COUNT, buffers) };
+			if (ring == nullptr)
+				return nullptr;
+			return std::make_unique<FileWriter>(fd, blockSize, std::move(ring), std::move(slots));
+		}
+	};
+
+	/**
+	 * @class	AsyncOutput
+	 * @brief	Replaces the stream buffer of an output stream with a FileWriter when the given file descriptor supports it, & restores it when destroyed.
+	 */
+	class AsyncOutput {
+		std::ostream& os;
+		std::streambuf* original{ nullptr };
+		std::unique_ptr<FileWriter> writer;
+
+	public:
+		/**
+		 * @param os		The output stream, which must write to fd.
+		 * @param fd		The file descriptor of the output stream.
+		 * @param blockSize	The size of each buffer.
+		 */
+		AsyncOutput(std::ostream& os, const int fd, const size_t blockSize) : os{ os }
+		{
+			os.flush();
+			if (writer = FileWriter::open(fd, blockSize); writer == nullptr)
+				return;
+			// disabling synchronization with stdio replaces the buffers of the standard streams, so it can't be done after this
+			std::ios_base::sync_with_stdio(false);
+			original = os.rdbuf(writer.get());
+		}
+		AsyncOutput(AsyncOutput const&) = delete;
+		AsyncOutput& operator=(AsyncOutput const&) = delete;
+		~AsyncOutput()
+		{
+			if (writer == nullptr)
+				return;
+			os.flush();
+			os.rdbuf(original);
+		}
+
+		/// @brief	Returns true when the output stream is being written through io_uring.
+		bool isActive() const noexcept { return writer != nullptr; }
+	};
+}
+#endif // ENABLE_IO_URING
@@ -0,0 +1,161 @@
+#pragma once
+/**
+ * @file	OutputTemplate.hpp
+ * @author	radj307
+ * @brief	Pre-rendered output lines for a pair of units, so each converted line only needs to format its two numbers.
+ */
+#include "conv.hpp"
+#include "global.h"
+
+#include <algorithm>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ckconv {
+	/**
+	 * @class	OutputTemplate
+	 * @brief	The constant parts of an output line for one (input unit, output unit) pair, including color sequences & unit names.
+	 *\n		The output is identical to the converted struct, but templates must be created after the output options are set.
+	 *\n		Compound output units *(see Compound.hpp)* have one output value per unit, i.e. "1.6002 m = 5 ft 3 in".
+	 */
+	class OutputTemplate {
+		/// @brief	The units that this template was created for.
+		conv::Unit inKey;
+		std::vector<conv::Unit> outKeys;
+		std::string inUnit, outUnit;
+		/// @brief	Bytes before the input value.
+		std::string prefix;
+		/// @brief	Bytes between the input value & the alignment padding.
+		std::string middle;
+		/// @brief	Bytes between the alignment padding & the output value.
+		std::string separator;
+		/// @brief	Bytes after each output value. The last suffix includes the newline.
+		std::vector<std::string> suffixes;
+		/// @brief	The column that the equals sign is aligned to, or 0.
+		size_t margin;
+
+		template<typename... Ts>
+		static std::string render(Ts&&... args)
+		{
+			std::stringstream ss;
+			(ss << ... << std::forward<Ts>(args));
+			return ss.str();
+		}
+
+		/// @brief	Appends the input value & everything before the first output value.
+		void renderInput(std::string& buffer, const long double inValue) const
+		{
+			if (!global.quiet) {
+				buffer += prefix;
+				const size_t begin{ buffer.size() };
+				append_fp(buffer, inValue);
+				// the padding depends on the width of the input value
+				const size_t used{ (buffer.size() - begin) + 1ull + inUnit.size() };
+				buffer += middle;
+				if (margin > used)
+					buffer.append(margin - used, ' ');
+			}
+			buffer += separator;
+		}
+
+	public:
+		OutputTemplate(conv::Unit const& in, conv::Unit const& out) : OutputTemplate(in, std::span<const conv::Unit>{ &out, 1ull }) {}
+		/**
+		 * @param in	The input unit.
+		 * @param outs	The output unit, or each unit of a compound output unit from largest to smallest.
+		 */
+		OutputTemplate(conv::Unit const& in, std::span<const conv::Unit> outs) :
+			inKey{ in },
+			outKeys{ outs.begin(), outs.end() },
+			inUnit{ format_unit(in, true) },
+			outUnit{ format_unit(outs, true) },
+			margin{ global.indent.has_value() ? global.indent.value() - 1ull : 0ull }
+		{
+			if (!global.quiet) {
+				prefix = render(global.csync(global.InputColor));
+				middle = render(global.csync(), ' ', global.csync(global.UnitColor), inUnit, global.csync());
+				separator = render(" = ", global.csync(global.ResultColor));
+				for (size_t i{ 0ull }; i < outs.size(); ++i) {
+					const bool last{ i + 1ull == outs.size() };
+					// "ft" & "in" are clearer than the quote symbols between the values of a compound unit
+					const bool useExtraName{ outs.size() > 1ull && !global.useFullNames && (outs[i].GetSymbol() == "'" || outs[i].GetSymbol() == "\"") && outs[i].HasExtraNames() };
+					suffixes.emplace_back(render(global.csync(), ' ', global.csync(global.UnitColor), (useExtraName ? outs[i].GetExtraNames().front() : format_unit(outs[i], true)), global.csync(), (last ? '\n' : ' ')));
+					if (!last)
+						suffixes.back() += render(global.csync(global.ResultColor));
+				}
+			}
+			else {
+				separator = render(global.csync(global.ResultColor));
+				for (size_t i{ 1ull }; i < outs.size(); ++i)
+					suffixes.emplace_back(1ull, ' ');
+				suffixes.emplace_back(render(global.csync(), '\n'));
+			}
+		}
+
+		/// @brief	Checks if this template was created for the given units. This doesn't allocate, since it's checked for every line.
+		bool matches(conv::Unit const& in, std::span<const conv::Unit> outs) const noexcept
+		{
+			return inKey.IsSameUnit(in) && std::equal(outKeys.begin(), outKeys.end(), outs.begin(), outs.end(), [](conv::Unit const& l, conv::Unit const& r) { return l.IsSameUnit(r); });
+		}
+
+		/**
+		 * @brief			Appends a complete output line to the given buffer.
+		 * @param buffer	Output buffer.
+		 * @param inValue	The input value.
+		 * @param outValue	The converted value.
+		 */
+		void render(std::string& buffer, const long double inValue, const long double outValue) const
+		{
+			renderInput(buffer, inValue);
+			append_fp(buffer, outValue);
+			buffer += suffixes.front();
+		}
+		/**
+		 * @brief			Appends a complete output line with a compound output value to the given buffer.
+		 * @param buffer	Output buffer.
+		 * @param inValue	The input value.
+		 * @param outValues	The value of each output unit, from CompoundUnit::split().
+		 */
+		void render(std::string& buffer, const long double inValue, std::span<const long double> outValues) const
+		{
+			renderInput(buffer, inValue);
+			for (size_t i{ 0ull }; i < outValues.size(); ++i) {
+				append_fp(buffer, outValues[i]);
+				buffer += suffixes[i];
+			}
+		}
+	};
+
+	/**
+	 * @class	OutputTemplateCache
+	 * @brief	Creates output templates on demand & reuses them for subsequent lines with the same units.
+	 */
+	class OutputTemplateCache {
+		std::vector<OutputTemplate> templates;
+		size_t last{ 0 };
+
+	public:
+		/// @brief	Gets the template for the given units, creating it if necessary.
+		OutputTemplate const& get(conv::Unit const& in, conv::Unit const& out)
+		{
+			const std::span<const conv::Unit> outs{ &out, 1ull };
+			// consecutive lines usually use the same units
+			if (last < templates.size() && templates[last].matches(in, outs))
+				return templates[last];
+			for (last = 0; last < templates.size(); ++last)
+				if (templates[last].matches(in, outs))
+					return templates[last];
+			return templates.emplace_back(in, out);
+		}
+		/// @brief	Gets the template for the given input unit & the units of a compound output unit, creating it if necessary.
+		OutputTemplate const& get(conv::Unit const& in, std::span<const conv::Unit> outs)
+		{
+			for (last = 0; last < templates.size(); ++last)
+				if (templates[last].matches(in, outs))
+					return templates[last];
+			return templates.emplace_back(in, outs);
+		}
+	};
+}
@@ -0,0 +1,372 @@
+#pragma once
+/**
+ * @file	Pipeline.hpp
+ * @author	radj307
+ * @brief	Lazy, composable stages of the conversion pipeline: tokens -> operations -> conversions -> formatted lines.
+ * @details	Each stage is a coroutine that takes any input range & returns a Generator, which is a single-pass view. Nothing is read or-
+ *\n		 -converted until the caller pulls the next element, so the stages can be chained with each other, with std::views, or with-
+ *\n		 -user-defined ranges, and iteration can stop at any point without processing the rest of the input.
+ *\n		  using namespace ckconv::pipeline;
+ *\n		  for (auto&& line : lines(tokens(std::cin)) | std::views::take(10))
+ *\n		    std::cout << line.text;
+ *\n		Errors in the input syntax are thrown by the stage that finds them. Conversion errors are yielded as values instead, so one bad-
+ *\n		 -conversion doesn't end the stream.
+ */
+#include "conv.hpp"
+#include "global.h"
+#include "util.h"
+#include "Compound.hpp"
+#include "OutputTemplate.hpp"
+#include "RecordWriter.hpp"
+
+#include <array>
+#include <exception>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if __has_include(<generator>)
+#include <generator>
+#endif
+#ifndef __cpp_lib_generator
+#include <coroutine>
+#include <iterator>
+#include <memory>
+#endif
+
+namespace ckconv::pipeline {
+#ifdef __cpp_lib_generator
+	template<typename T>
+	using Generator = std::generator<T>;
+#else
+	/**
+	 * @class	Generator
+	 * @brief	Minimal replacement for std::generator, for standard libraries that don't have it yet.
+	 *\n		Like std::generator, this is a move-only view whose iterator yields references to the values passed to co_yield.
+	 *\n		Yielded lvalues are copied, so the coroutine's local variables can't be modified by the caller.
+	 */
+	template<typename T>
+	class Generator : public std::ranges::view_interface<Generator<T>> {
+	public:
+		using value_type = std::remove_cvref_t<T>;
+		using reference = std::conditional_t<std::is_reference_v<T>, T, T&&>;
+
+		struct promise_type;
+		using handle_type = std::coroutine_handle<promise_type>;
+
+		struct promise_type {
+			std::add_pointer_t<reference> value{ nullptr };
+			std::exception_ptr error{ nullptr };
+
+			Generator get_return_object() noexcept { return Generator{ handle_type::from_promise(*this) }; }
+			std::suspend_always initial_suspend() const noexcept { return {}; }
+			std::suspend_always final_suspend() const noexcept { return {}; }
+			void return_void() const noexcept {}
+			void unhandled_exception() noexcept { error = std::current_exception(); }
+
+			std::suspend_always yield_value(std::remove_reference_t<reference>&& v) noexcept
+			{
+				value = std::addressof(v);
+				return {};
+			}
+			/// @brief	Copies a yielded lvalue into the coroutine frame, which keeps it alive until the coroutine is resumed.
+			auto yield_value(std::remove_reference_t<reference> const& v) requires std::is_rvalue_reference_v<reference> && std::copy_constructible<value_type>
+			{
+				struct awaiter {
+					value_type copy;
+					bool await_ready() const noexcept { return false; }
+					void await_suspend(handle_type h) noexcept { h.promise().value = std::addressof(copy); }
+					void await_resume() const noexcept {}
+				};
+				return awaiter{ v };
+			}
+		};
+
+		class iterator {
+			handle_type h{ nullptr };
+
+		public:
+			using value_type = Generator::value_type;
+			using difference_type = std::ptrdiff_t;
+
+			iterator() = default;
+			explicit iterator(handle_type h) noexcept : h{ h } {}
+
+			reference operator*() const { return static_cast<reference>(*h.promise().value); }
+			iterator& operator++()
+			{
+				h.resume();
+				rethrow(h);
+				return *this;
+			}
+			void operator++(int) { ++*this; }
+
+			friend bool operator==(iterator const& it, std::default_sentinel_t) noexcept { return it.h.done(); }
+		};
+
+	private:
+		handle_type h{ nullptr };
+
+		explicit Generator(handle_type h) noexcept : h{ h } {}
+
+		/// @brief	Rethrows an exception that escaped from the coroutine body.
+		static void rethrow(handle_type h)
+		{
+			if (auto& error{ h.promise().error }; error)
+				std::rethrow_exception(std::exchange(error, nullptr));
+		}
+
+	public:
+		Generator(Generator&& o) noexcept : h{ std::exchange(o.h, nullptr) } {}
+		Generator& operator=(Generator&& o) noexcept
+		{
+			if (this != &o) {
+				if (h) h.destroy();
+				h = std::exchange(o.h, nullptr);
+			}
+			return *this;
+		}
+		~Generator()
+		{
+			if (h) h.destroy();
+		}
+
+		/// @brief	Starts the coroutine & returns an iterator to the first value. This may only be called once.
+		iterator begin()
+		{
+			h.resume();
+			rethrow(h);
+			return iterator{ h };
+		}
+		std::default_sentinel_t end() const noexcept { return {}; }
+	};
+#endif
+
+	/**
+	 * @brief		Yields the whitespace-delimited tokens from an input stream, as they are read.
+	 * @param is	Input stream. This must outlive the generator.
+	 */
+	inline Generator<std::string> tokens(std::istream& is)
+	{
+		for (std::string s; is >> s; )
+			co_yield std::move(s);
+	}
+
+	/**
+	 * @brief	Yields views of the strings in each range, in order, without copying them.
+	 *\n		Each view is only valid until the iterator is incremented, which is all that expandUnits() requires.
+	 */
+	template<std::ranges::input_range TFirst, std::ranges::input_range... TRest>
+	Generator<std::string_view> concat(TFirst first, TRest... rest)
+	{
+		for (auto&& s : first) {
+			const std::string_view view{ s };
+			co_yield view;
+		}
+		if constexpr (sizeof...(TRest) != 0) {
+			for (auto&& view : concat(std::move(rest)...))
+				co_yield view;
+		}
+	}
+
+	/**
+	 * @brief	Replaces each response file token *(i.e. "@path")* with the tokens read from that file, which may be compressed.
+	 *\n		This should only be applied to command-line arguments; input data may legitimately contain tokens that start with '@'.
+	 *\n		Files are opened when their token is reached, & are streamed rather than read into memory.
+	 *\n		Like concat(), the yielded views are only valid until the iterator is incremented.
+	 */
+	template<std::ranges::input_range TRange>
+	Generator<std::string_view> expandResponseFiles(TRange tokens)
+	{
+		for (auto&& token : tokens) {
+			if (const std::string_view view{ token }; view.size() <= 1ull || view.front() != '@')
+				co_yield view;
+			else {
+				io::InputStream file{ std::string{ view.substr(1ull) } };
+				for (auto&& s : pipeline::tokens(file)) {
+					const std::string_view fileToken{ s };
+					co_yield fileToken;
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief					Lazy version of expandUnits(). Yields the tokens from the given range with numbers & units separated, i.e. "250m" -> "m", "250".
+	 * @param tokens			Raw input tokens.
+	 * @param compoundValues	When false, compound values like "5 ft 3 in" aren't summed. This should be false when the output unit is set by --to.
+	 */
+	template<std::ranges::input_range TRange>
+	Generator<std::string> expandUnits(TRange tokens, const bool compoundValues = true)
+	{
+		RangeTokenSource src{ tokens };
+		for (std::array<std::string, 2> out; !src.empty(); ) {
+			const size_t count{ expandNext(src, out, compoundValues) };
+			for (size_t i{ 0ull }; i < count; ++i)
+				co_yield std::move(out[i]);
+		}
+	}
+
+	/**
+	 * @brief				Lazy version of processInput(). Yields an operation for each group of 3 tokens from the given range.
+	 * @param tokens		Expanded tokens, from expandUnits().
+	 * @param outputUnits	When this isn't empty, tokens are grouped into pairs instead & this is used as the output unit(s) of every operation.
+	 */
+	template<std::ranges::input_range TRange>
+	Generator<operation> operations(TRange tokens, std::string outputUnits = {})
+	{
+		const size_t groupSize{ outputUnits.empty() ? 3ull : 2ull };
+		std::array<std::pmr::string, 3> group;
+		size_t count{ 0ull };
+		const auto make{ [&]() {
+			return makeOperation(std::move(group[0]), std::move(group[1]), groupSize == 2ull ? std::pmr::string{ outputUnits } : std::move(group[2]));
+		} };
+
+		// values are yielded from named variables rather than temporaries, since temporaries that live across a suspension point-
+		//  -are miscompiled by some versions of GCC
+		for (auto&& token : tokens) {
+			group[count++].assign(std::string_view{ token });
+			if (count == groupSize) {
+				count = 0ull;
+				operation op{ make() };
+				co_yield std::move(op);
+			}
+		}
+		// the last group may be incomplete
+		if (count != 0ull) {
+			for (size_t i{ count }; i < group.size(); ++i)
+				group[i].clear();
+			operation op{ make() };
+			co_yield std::move(op);
+		}
+	}
+
+	/**
+	 * @struct	Conversion
+	 * @brief	The result of converting one operation to one output unit, or the reason that it failed.
+	 */
+	struct Conversion {
+		/// @brief	The operation that this result came from.
+		operation source;
+		/// @brief	The input & output units. These are only set when the conversion succeeded.
+		std::optional<conv::Unit> inUnit, outUnit;
+		conv::number_t inValue{ 0.0L }, outValue{ 0.0L };
+		/// @brief	The error message, or an empty string when the conversion succeeded.
+		std::string error;
+		/// @brief	The compound output unit, if the output unit is one *(see Compound.hpp)*. outUnit is its smallest unit, & outValue is-
+		///			 -split into the value of each of its units in outComponents.
+		std::shared_ptr<const compound::CompoundUnit> compoundUnit{};
+		std::vector<conv::number_t> outComponents{};
+
+		bool ok() const noexcept { return error.empty(); }
+	};
+
+	/// @brief	Converts each operation from the given range. Operations with multiple output units yield one Conversion per output unit.
+	template<std::ranges::input_range TRange>
+	Generator<Conversion> convert(TRange operations)
+	{
+		compound::CompoundUnitCache compoundUnits;
+		for (auto&& op : operations) {
+			std::vector<Conversion> results;
+			try {
+				if (compound::isCompoundUnit(std::get<2>(op))) {
+					const auto inUnit{ conv::getUnit(std::string{ std::get<0>(op) }) };
+					const auto inValue{ str::stold(std::string{ std::get<1>(op) }) };
+					auto outUnit{ compoundUnits.get(std::get<2>(op)) };
+					auto& result{ results.emplace_back(Conversion{ op, inUnit, outUnit->smallest(), inValue, conv::convert(inUnit, inValue, outUnit->smallest()), {}, outUnit }) };
+					result.outComponents.resize(outUnit->getUnits().size());
+					outUnit->split(result.outValue, result.outComponents, round_fp);
+				}
+				else if (!isUnitList(std::get<2>(op))) {
+					const auto [inUnit, inValue, outUnit] { toConvertible(op) };
+					results.emplace_back(Conversion{ op, inUnit, outUnit, inValue, conv::convert(inUnit, inValue, outUnit), {} });
+				}
+				else {
+					const auto inUnit{ conv::getUnit(std::string{ std::get<0>(op) }) };
+					const auto inValue{ str::stold(std::string{ std::get<1>(op) }) };
+					const auto outs{ getUnitList(std::get<2>(op)) };
+					const auto outValues{ conv::convert_all(inUnit, inValue, outs) };
+					results.reserve(outs.size());
+					for (size_t i{ 0ull }; i < outs.size(); ++i)
+						results.emplace_back(Conversion{ op, inUnit, outs[i], inValue, outValues[i], {} });
+				}
+			} catch (const std::exception& ex) {
+				results.clear();
+				results.emplace_back(Conversion{ op, std::nullopt, std::nullopt, 0.0L, 0.0L, ex.what() });
+			}
+			// co_yield isn't allowed in a catch block, so results are yielded afterwards
+			for (auto& result : results)
+				co_yield std::move(result);
+		}
+	}
+
+	/**
+	 * @struct	Line
+	 * @brief	One formatted line of output, including the newline.
+	 */
+	struct Line {
+		std::string text;
+		/// @brief	True when the text is an error message that belongs on STDERR. Structured formats write errors as records, so this is always false for them.
+		bool isError{ false };
+	};
+
+	/**
+	 * @brief				Formats each conversion from the given range using the current output options *(see global.h)*, including --format.
+	 * @param conversions	Conversions, from convert().
+	 * @param header		When true, structured formats yield a header line first *(except for JSON Lines, which doesn't have one)*.
+	 */
+	template<std::ranges::input_range TRange>
+	Generator<Line> format(TRange conversions, const bool header = true)
+	{
+		OutputTemplateCache templates;
+		const RecordWriter writer{ global.outputFormat };
+		const bool structured{ global.outputFormat != OutputFormat::HUMAN };
+
+		if (Line headerLine; header && structured && !global.quiet) {
+			writer.writeHeader(headerLine.text);
+			if (!headerLine.text.empty())
+				co_yield std::move(headerLine);
+		}
+
+		for (auto&& c : conversions) {
+			Line line;
+			if (c.ok() && c.compoundUnit != nullptr) {
+				if (structured)
+					writer.writeResult(line.text, c.inValue, format_unit(c.inUnit.value(), true), std::span<const conv::number_t>{ c.outComponents }, format_unit(c.compoundUnit->getUnits(), true));
+				else templates.get(c.inUnit.value(), c.compoundUnit->getUnits()).render(line.text, c.inValue, std::span<const conv::number_t>{ c.outComponents });
+			}
+			else if (c.ok()) {
+				if (structured)
+					writer.writeResult(line.text, c.inValue, format_unit(c.inUnit.value(), true), c.outValue, format_unit(c.outUnit.value(), true));
+				else templates.get(c.inUnit.value(), c.outUnit.value()).render(line.text, c.inValue, c.outValue);
+			}
+			else if (structured)
+				writer.writeError(line.text, std::get<1>(c.source), std::get<0>(c.source), std::get<2>(c.source), c.error);
+			else {
+				line.text = c.error + '\n';
+				line.isError = true;
+			}
+			co_yield std::move(line);
+		}
+	}
+
+	/**
+	 * @brief				Chains every stage together, from raw input tokens to formatted lines.
+	 * @param tokens		Raw input tokens, i.e. from tokens() or the commandline.
+	 * @param outputUnits	The output unit(s) specified by --to, or an empty string.
+	 */
+	template<std::ranges::input_range TRange>
+	Generator<Line> lines(TRange tokens, std::string outputUnits = {})
+	{
+		const bool compoundValues{ outputUnits.empty() };
+		return format(convert(operations(expandUnits(std::move(tokens), compoundValues), std::move(outputUnits))));
+	}
+}
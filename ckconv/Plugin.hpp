@@ -0,0 +1,621 @@
+#pragma once
+/**
+ * @file	Plugin.hpp
+ * @author	radj307
+ * @brief	Extracts or rewrites the positions of placed references in Bethesda plugin files *(ESP/ESM/ESL)* that use the TES4 format.
+ * @details	A plugin is a sequence of records & groups. Each one starts with a header:
+ *\n		  char[4]	type		The record type *(i.e. "REFR")*, or "GRUP" for a group.
+ *\n		  uint32	size		The size of the record's data, or the size of the entire group including its header.
+ *\n		  uint32	flags		Record flags; 0x00040000 means the data is a uint32 decompressed size followed by a zlib stream.
+ *\n		  uint32	formID		The record's form ID. *(The group label, for groups)*
+ *\n		  ...					The rest is version control info; headers are 24 bytes long, or 20 bytes in Oblivion.
+ *\n		The data of a record is a sequence of fields, which each have a 4 character type & a uint16 size. An XXXX field holds the-
+ *\n		 -uint32 size of the next field, when it's too large for a uint16. The DATA field of a placed reference contains six floats:-
+ *\n		 -the X, Y, & Z position in Creation Kit units, then the X, Y, & Z rotation in radians. Only positions are converted.
+ *\n		The file is memory-mapped & walked without recursion, and positions are converted in batches so the conversion loop can be-
+ *\n		 -vectorized. Memory usage is bounded by the batch size, the largest record, & the depth of the groups.
+ */
+#include "conv.hpp"
+#include "global.h"
+#include "RecordWriter.hpp"
+#include "TableFile.hpp"
+
+#include <make_exception.hpp>
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef ENABLE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace ckconv::plugin {
+	static_assert(std::endian::native == std::endian::little, "Plugin files are only supported on little-endian platforms!");
+
+	/// @brief	Gets the numeric value of a 4 character record or field type, as it is stored in a plugin.
+	constexpr uint32_t makeType(std::string_view const& s) noexcept
+	{
+		return static_cast<uint32_t>(s[0]) | static_cast<uint32_t>(s[1]) << 8 | static_cast<uint32_t>(s[2]) << 16 | static_cast<uint32_t>(s[3]) << 24;
+	}
+
+	inline constexpr uint32_t TYPE_TES4{ makeType("TES4") };
+	inline constexpr uint32_t TYPE_HEDR{ makeType("HEDR") };
+	inline constexpr uint32_t TYPE_GRUP{ makeType("GRUP") };
+	inline constexpr uint32_t TYPE_DATA{ makeType("DATA") };
+	inline constexpr uint32_t TYPE_XXXX{ makeType("XXXX") };
+
+	/// @brief	The record flag that indicates the record's data is compressed with zlib.
+	inline constexpr uint32_t FLAG_COMPRESSED{ 0x00040000 };
+	/// @brief	The size of the DATA field of a placed reference; 3 position floats & 3 rotation floats.
+	inline constexpr size_t DATA_SIZE{ 24 };
+	/// @brief	The number of references that are converted at a time.
+	inline constexpr size_t BATCH_SIZE{ 4096 };
+	/// @brief	The number of bytes that are buffered before rewritten output is written to the output file.
+	inline constexpr size_t FLUSH_SIZE{ 1ull << 20 };
+
+	/// @brief	Returns true for record types that are placed references, which have a position in their DATA field.
+	constexpr bool isPlacedReference(const uint32_t type) noexcept
+	{
+		switch (type) {
+		case makeType("REFR"): // object
+		case makeType("ACHR"): // actor
+		case makeType("ACRE"): // creature *(Oblivion, Fallout 3, & New Vegas)*
+		case makeType("PGRE"): // grenade
+		case makeType("PMIS"): // missile
+		case makeType("PARW"): // arrow
+		case makeType("PBAR"): // barrier
+		case makeType("PBEA"): // beam
+		case makeType("PCON"): // cone
+		case makeType("PFLA"): // flame
+		case makeType("PHZD"): // hazard
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	inline uint32_t load32(const char* const p) noexcept
+	{
+		uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+	inline uint16_t load16(const char* const p) noexcept
+	{
+		uint16_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+	inline void store32(char* const p, const uint32_t value) noexcept
+	{
+		std::memcpy(p, &value, sizeof(value));
+	}
+
+	/// @brief	Appends a record type, replacing characters that aren't printable.
+	inline void appendType(std::string& buffer, const uint32_t type)
+	{
+		for (size_t i{ 0 }; i < 4; ++i) {
+			const char c{ static_cast<char>(type >> (i * 8)) };
+			buffer += (c >= 0x20 && c < 0x7F) ? c : '?';
+		}
+	}
+	/// @brief	Appends a form ID as 8 hexadecimal digits, the way the Creation Kit displays them.
+	inline void appendFormID(std::string& buffer, const uint32_t formID)
+	{
+		constexpr char HEX[]{ "0123456789ABCDEF" };
+		for (int shift{ 28 }; shift >= 0; shift -= 4)
+			buffer += HEX[(formID >> shift) & 0xF];
+	}
+	inline std::string formatFormID(const uint32_t formID)
+	{
+		std::string s;
+		appendFormID(s, formID);
+		return s;
+	}
+
+	/**
+	 * @brief			Converts a block of positions with a single factor.
+	 *\n				This is a simple loop over contiguous memory so the compiler can vectorize it. Positions are stored as floats, but-
+	 *\n				 -they're multiplied as doubles so the factor doesn't lose precision.
+	 * @param in		Input positions.
+	 * @param out		Output positions. May be the same as the input.
+	 * @param count		Number of floats. *(3 per position)*
+	 * @param factor	Conversion factor, from conv::getConversionFactor().
+	 */
+	template<typename TOut>
+	inline void convertPositions(const float* const in, TOut* const out, const size_t count, const double factor) noexcept
+	{
+		for (size_t i{ 0 }; i < count; ++i)
+			out[i] = static_cast<TOut>(static_cast<double>(in[i]) * factor);
+	}
+
+	/**
+	 * @brief			Finds the position in the fields of a placed reference.
+	 * @param fields	The record's data, after decompression.
+	 * @param formID	The record's form ID, which is used in error messages.
+	 * @returns			The offset of the X position in the fields, or std::string_view::npos when it doesn't have a DATA field.
+	 */
+	inline size_t findPosition(std::span<const char> fields, const uint32_t formID)
+	{
+		std::optional<uint32_t> largeSize;
+		for (size_t pos{ 0 }; fields.size() - pos >= 6; ) {
+			const uint32_t type{ load32(fields.data() + pos) };
+			size_t size{ load16(fields.data() + pos + 4) };
+			pos += 6;
+			if (largeSize.has_value()) {
+				size = largeSize.value();
+				largeSize.reset();
+			}
+			if (size > fields.size() - pos)
+				throw make_exception("Record ", formatFormID(formID), " has a field that extends past the end of the record!");
+
+			if (type == TYPE_XXXX && size == 4)
+				largeSize = load32(fields.data() + pos);
+			else if (type == TYPE_DATA)
+				return size == DATA_SIZE ? pos : std::string_view::npos;
+			pos += size;
+		}
+		return std::string_view::npos;
+	}
+
+#ifdef ENABLE_ZLIB
+	/**
+	 * @brief			Decompresses the data of a compressed record.
+	 * @param data		The record's data; a uint32 decompressed size followed by a zlib stream.
+	 * @param buffer	Receives the decompressed fields. It is reused between records to avoid allocations.
+	 * @param formID	The record's form ID, which is used in error messages.
+	 */
+	inline void decompress(std::span<const char> data, std::vector<char>& buffer, const uint32_t formID)
+	{
+		if (data.size() < 4)
+			throw make_exception("Compressed record ", formatFormID(formID), " is too small!");
+		buffer.resize(load32(data.data()));
+		uLongf length{ static_cast<uLongf>(buffer.size()) };
+		if (uncompress(reinterpret_cast<Bytef*>(buffer.data()), &length, reinterpret_cast<const Bytef*>(data.data() + 4), static_cast<uLong>(data.size() - 4)) != Z_OK || length != buffer.size())
+			throw make_exception("Failed to decompress record ", formatFormID(formID), "!");
+	}
+	/**
+	 * @brief			Compresses the fields of a record into the format used by compressed records.
+	 * @param fields	The record's fields.
+	 * @param buffer	Receives the compressed data. It is reused between records to avoid allocations.
+	 * @param formID	The record's form ID, which is used in error messages.
+	 */
+	inline void compress(std::span<const char> fields, std::vector<char>& buffer, const uint32_t formID)
+	{
+		uLongf length{ compressBound(static_cast<uLong>(fields.size())) };
+		buffer.resize(4 + length);
+		store32(buffer.data(), static_cast<uint32_t>(fields.size()));
+		if (compress2(reinterpret_cast<Bytef*>(buffer.data() + 4), &length, reinterpret_cast<const Bytef*>(fields.data()), static_cast<uLong>(fields.size()), Z_DEFAULT_COMPRESSION) != Z_OK)
+			throw make_exception("Failed to compress record ", formatFormID(formID), "!");
+		buffer.resize(4 + length);
+	}
+#endif
+
+	/**
+	 * @struct	Record
+	 * @brief	A record in a plugin file, which refers directly to the memory-mapped file.
+	 */
+	struct Record {
+		uint32_t type;
+		uint32_t flags;
+		uint32_t formID;
+		std::span<const char> header;
+		std::span<const char> data;
+
+		bool isCompressed() const noexcept { return (flags & FLAG_COMPRESSED) != 0; }
+	};
+
+	/**
+	 * @class	Reader
+	 * @brief	Walks the records & groups in a memory-mapped plugin file.
+	 */
+	class Reader {
+		table::MappedFile file;
+		std::span<const char> contents;
+		size_t headerSize;
+
+	public:
+		Reader(std::filesystem::path const& path) : file{ path }, contents{ file.span() }
+		{
+			// the first field of the TES4 record is always HEDR, which tells us how long the record headers are
+			if (contents.size() >= 28 && load32(contents.data()) == TYPE_TES4 && load32(contents.data() + 24) == TYPE_HEDR)
+				headerSize = 24;
+			else if (contents.size() >= 24 && load32(contents.data()) == TYPE_TES4 && load32(contents.data() + 20) == TYPE_HEDR)
+				headerSize = 20;
+			else throw make_exception("'", path.generic_string(), "' isn't a TES4 plugin file!");
+		}
+
+		/// @brief	Gets the size of the record & group headers in this file.
+		size_t getHeaderSize() const noexcept { return headerSize; }
+
+		/**
+		 * @brief			Visits every record & group in the order they appear in the file.
+		 * @param visitor	An object with these methods:
+		 *\n				  group(std::span<const char> header)	Called at the start of a group.
+		 *\n				  endGroup()							Called at the end of a group.
+		 *\n				  record(Record const& record)			Called for each record.
+		 */
+		template<typename TVisitor>
+		void walk(TVisitor& visitor) const
+		{
+			// the end offsets of the groups that contain the current position
+			std::vector<size_t> ends;
+			for (size_t pos{ 0 }; pos < contents.size(); ) {
+				while (!ends.empty() && pos == ends.back()) {
+					ends.pop_back();
+					visitor.endGroup();
+				}
+				if (pos == contents.size())
+					break;
+
+				const size_t limit{ ends.empty() ? contents.size() : ends.back() };
+				if (limit - pos < headerSize)
+					throw make_exception("Truncated header at offset ", pos, "!");
+				const char* const header{ contents.data() + pos };
+				const uint32_t type{ load32(header) };
+				const size_t size{ load32(header + 4) };
+
+				if (type == TYPE_GRUP) {
+					if (size < headerSize || size > limit - pos)
+						throw make_exception("Group at offset ", pos, " has an invalid size!");
+					visitor.group(contents.subspan(pos, headerSize));
+					ends.emplace_back(pos + size);
+					pos += headerSize;
+				}
+				else {
+					if (size > limit - pos - headerSize)
+						throw make_exception("Record ", formatFormID(load32(header + 12)), " at offset ", pos, " extends past the end of its group!");
+					visitor.record(Record{ type, load32(header + 8), load32(header + 12), contents.subspan(pos, headerSize), contents.subspan(pos + headerSize, size) });
+					pos += headerSize + size;
+				}
+			}
+			while (!ends.empty()) {
+				ends.pop_back();
+				visitor.endGroup();
+			}
+		}
+	};
+
+	/**
+	 * @class	PositionWriter
+	 * @brief	Writes the converted position of every placed reference in a plugin, in the output format specified by --format.
+	 */
+	class PositionWriter {
+		std::ostream& os;
+		double factor;
+		std::string unit;
+		struct Reference {
+			uint32_t type;
+			uint32_t formID;
+		};
+		std::vector<Reference> references;
+		std::vector<float> positions;
+		std::vector<double> results;
+		std::vector<char> fields;
+		std::string buffer;
+		/// @brief	The color sequences & unit that surround each part of a human-readable line, which are rendered once.
+		std::string prefix, middle, suffix;
+
+		template<typename... Ts>
+		static std::string render(Ts&&... args)
+		{
+			std::stringstream ss;
+			(ss << ... << std::forward<Ts>(args));
+			return ss.str();
+		}
+
+		/// @brief	Converts & writes the current batch.
+		void flush()
+		{
+			results.resize(positions.size());
+			convertPositions(positions.data(), results.data(), positions.size(), factor);
+
+			const bool header{ !global.quiet };
+			for (size_t i{ 0 }; i < references.size(); ++i) {
+				const double* const xyz{ results.data() + i * 3 };
+				switch (global.outputFormat) {
+				case OutputFormat::HUMAN:
+					buffer += prefix;
+					if (header) {
+						appendType(buffer, references[i].type);
+						buffer += ' ';
+						appendFormID(buffer, references[i].formID);
+						buffer += middle;
+					}
+					for (size_t axis{ 0 }; axis < 3; ++axis) {
+						if (axis != 0)
+							buffer += header ? ", " : " ";
+						append_fp(buffer, xyz[axis]);
+					}
+					buffer += suffix;
+					break;
+				case OutputFormat::JSONL: {
+					std::string type;
+					appendType(type, references[i].type);
+					buffer += "{\"type\":";
+					RecordWriter::appendJSON(buffer, type);
+					buffer += ",\"form_id\":\"";
+					appendFormID(buffer, references[i].formID);
+					buffer += "\",\"x\":";
+					RecordWriter::appendJSON(buffer, xyz[0]);
+					buffer += ",\"y\":";
+					RecordWriter::appendJSON(buffer, xyz[1]);
+					buffer += ",\"z\":";
+					RecordWriter::appendJSON(buffer, xyz[2]);
+					buffer += ",\"unit\":";
+					RecordWriter::appendJSON(buffer, unit);
+					buffer += '}';
+					break;
+				}
+				default: {
+					const char separator{ global.outputFormat == OutputFormat::TSV ? '\t' : ',' };
+					appendType(buffer, references[i].type);
+					buffer += separator;
+					appendFormID(buffer, references[i].formID);
+					for (size_t axis{ 0 }; axis < 3; ++axis) {
+						buffer += separator;
+						append_fp(buffer, xyz[axis]);
+					}
+					buffer += separator;
+					if (global.outputFormat == OutputFormat::CSV)
+						RecordWriter::appendCSV(buffer, unit);
+					else RecordWriter::appendTSV(buffer, unit);
+					break;
+				}
+				}
+				buffer += '\n';
+			}
+			os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+			buffer.clear();
+			references.clear();
+			positions.clear();
+		}
+
+	public:
+		/// @brief	The number of references that were written.
+		size_t count{ 0 };
+		/// @brief	The number of compressed references that were skipped, because zlib isn't available.
+		size_t skipped{ 0 };
+
+		/**
+		 * @param os		Output stream.
+		 * @param inUnit	The unit that positions are stored in. *(Creation Kit units, by default)*
+		 * @param outUnit	The unit to convert positions to.
+		 */
+		PositionWriter(std::ostream& os, conv::Unit const& inUnit, conv::Unit const& outUnit) : os{ os }, factor{ static_cast<double>(conv::getConversionFactor(inUnit, outUnit)) }, unit{ format_unit(outUnit, true) }
+		{
+			references.reserve(BATCH_SIZE);
+			positions.reserve(BATCH_SIZE * 3);
+			if (global.outputFormat == OutputFormat::HUMAN && !global.quiet) {
+				prefix = render(global.csync(global.InputColor));
+				middle = render(global.csync(), " = ", global.csync(global.ResultColor));
+				suffix = render(global.csync(), ' ', global.csync(global.UnitColor), unit, global.csync());
+			}
+			else if (global.outputFormat == OutputFormat::HUMAN) {
+				prefix = render(global.csync(global.ResultColor));
+				suffix = render(global.csync());
+			}
+			else if (global.outputFormat == OutputFormat::CSV && !global.quiet)
+				buffer += "type,form_id,x,y,z,unit\n";
+			else if (global.outputFormat == OutputFormat::TSV && !global.quiet)
+				buffer += "type\tform_id\tx\ty\tz\tunit\n";
+		}
+
+		void group(std::span<const char>) {}
+		void endGroup() {}
+		void record(Record const& record)
+		{
+			if (!isPlacedReference(record.type))
+				return;
+			std::span<const char> data{ record.data };
+			if (record.isCompressed()) {
+			#ifdef ENABLE_ZLIB
+				decompress(record.data, fields, record.formID);
+				data = fields;
+			#else
+				++skipped;
+				return;
+			#endif
+			}
+			if (const size_t offset{ findPosition(data, record.formID) }; offset != std::string_view::npos) {
+				references.emplace_back(Reference{ record.type, record.formID });
+				positions.resize(positions.size() + 3);
+				std::memcpy(positions.data() + positions.size() - 3, data.data() + offset, sizeof(float) * 3);
+				++count;
+				if (references.size() == BATCH_SIZE)
+					flush();
+			}
+		}
+		/// @brief	Writes the last batch.
+		void finish()
+		{
+			flush();
+			os.flush();
+		}
+	};
+
+	/**
+	 * @class	PositionRewriter
+	 * @brief	Writes a copy of a plugin with the position of every placed reference converted.
+	 *\n		Compressed records are recompressed, so their size may change; the size of each group that contains them is updated-
+	 *\n		 -after the group is written. Group headers that were already flushed are updated by seeking back in the output file.
+	 */
+	class PositionRewriter {
+		std::ostream& os;
+		double factor;
+		/// @brief	The output that hasn't been written yet, & the number of bytes that were written before it.
+		std::string buffer;
+		size_t flushed{ 0 };
+		/// @brief	The offsets of the positions in the buffer that haven't been converted yet.
+		std::vector<size_t> pending;
+		std::vector<float> positions;
+		struct Group {
+			size_t offset;
+			uint32_t size;
+		};
+		std::vector<Group> groups;
+		std::vector<char> fields, packed;
+
+		/// @brief	Converts the pending positions in the buffer, then writes it to the output file.
+		void flush()
+		{
+			positions.resize(pending.size() * 3);
+			for (size_t i{ 0 }; i < pending.size(); ++i)
+				std::memcpy(positions.data() + i * 3, buffer.data() + pending[i], sizeof(float) * 3);
+			convertPositions(positions.data(), positions.data(), positions.size(), factor);
+			for (size_t i{ 0 }; i < pending.size(); ++i)
+				std::memcpy(buffer.data() + pending[i], positions.data() + i * 3, sizeof(float) * 3);
+			pending.clear();
+
+			if (!os.write(buffer.data(), static_cast<std::streamsize>(buffer.size())))
+				throw make_exception("Failed to write the output file!");
+			flushed += buffer.size();
+			buffer.clear();
+		}
+		/// @brief	Sets the size of a group that was already written.
+		void patch(const size_t offset, const uint32_t size)
+		{
+			if (offset >= flushed) {
+				store32(buffer.data() + (offset - flushed), size);
+				return;
+			}
+			char bytes[4];
+			store32(bytes, size);
+			if (!os.seekp(static_cast<std::streamoff>(offset)) || !os.write(bytes, sizeof(bytes)) || !os.seekp(static_cast<std::streamoff>(flushed)))
+				throw make_exception("Failed to update a group size in the output file!");
+		}
+
+	public:
+		/// @brief	The number of references that were converted.
+		size_t count{ 0 };
+
+		/**
+		 * @param os		Output stream. This must be seekable, since group sizes may be updated after they're written.
+		 * @param inUnit	The unit that positions are stored in.
+		 * @param outUnit	The unit to convert positions to.
+		 */
+		PositionRewriter(std::ostream& os, conv::Unit const& inUnit, conv::Unit const& outUnit) : os{ os }, factor{ static_cast<double>(conv::getConversionFactor(inUnit, outUnit)) }
+		{
+			buffer.reserve(FLUSH_SIZE);
+			pending.reserve(BATCH_SIZE);
+		}
+
+		void group(std::span<const char> header)
+		{
+			groups.emplace_back(Group{ flushed + buffer.size(), load32(header.data() + 4) });
+			buffer.append(header.data(), header.size());
+		}
+		void endGroup()
+		{
+			const Group group{ groups.back() };
+			groups.pop_back();
+			const size_t size{ flushed + buffer.size() - group.offset };
+			if (size > UINT32_MAX)
+				throw make_exception("A group in the output file is too large!");
+			if (size != group.size)
+				patch(group.offset + 4, static_cast<uint32_t>(size));
+		}
+		void record(Record const& record)
+		{
+			if (isPlacedReference(record.type) && record.isCompressed()) {
+			#ifdef ENABLE_ZLIB
+				decompress(record.data, fields, record.formID);
+				if (const size_t offset{ findPosition(fields, record.formID) }; offset != std::string_view::npos) {
+					float xyz[3];
+					std::memcpy(xyz, fields.data() + offset, sizeof(xyz));
+					convertPositions(xyz, xyz, 3, factor);
+					std::memcpy(fields.data() + offset, xyz, sizeof(xyz));
+					compress(fields, packed, record.formID);
+					if (packed.size() > UINT32_MAX)
+						throw make_exception("Record ", formatFormID(record.formID), " is too large!");
+					const size_t start{ buffer.size() };
+					buffer.append(record.header.data(), record.header.size());
+					store32(buffer.data() + start + 4, static_cast<uint32_t>(packed.size()));
+					buffer.append(packed.data(), packed.size());
+					++count;
+				}
+				else {
+					buffer.append(record.header.data(), record.header.size());
+					buffer.append(record.data.data(), record.data.size());
+				}
+			#else
+				throw make_exception("Record ", formatFormID(record.formID), " is compressed, but ckconv was built without zlib!");
+			#endif
+			}
+			else {
+				const size_t start{ buffer.size() };
+				buffer.append(record.header.data(), record.header.size());
+				buffer.append(record.data.data(), record.data.size());
+				if (isPlacedReference(record.type)) {
+					if (const size_t offset{ findPosition(record.data, record.formID) }; offset != std::string_view::npos) {
+						pending.emplace_back(start + record.header.size() + offset);
+						++count;
+					}
+				}
+			}
+			if (buffer.size() >= FLUSH_SIZE || pending.size() >= BATCH_SIZE)
+				flush();
+		}
+		/// @brief	Writes the rest of the output.
+		void finish()
+		{
+			flush();
+			if (!os.flush())
+				throw make_exception("Failed to write the output file!");
+		}
+	};
+
+	/**
+	 * @brief			Writes the position of every placed reference in a plugin.
+	 * @param path		The plugin file.
+	 * @param inUnit	The unit that positions are stored in.
+	 * @param outUnit	The unit to convert positions to.
+	 * @param os		Output stream.
+	 * @returns			The number of references that were written.
+	 */
+	inline size_t extract(std::filesystem::path const& path, conv::Unit const& inUnit, conv::Unit const& outUnit, std::ostream& os)
+	{
+		const Reader reader{ path };
+		PositionWriter writer{ os, inUnit, outUnit };
+		reader.walk(writer);
+		writer.finish();
+		if (writer.skipped != 0)
+			std::cerr << global.csync.get_warn() << "Skipped " << writer.skipped << " compressed references, because ckconv was built without zlib." << std::endl;
+		return writer.count;
+	}
+
+	/**
+	 * @brief				Writes a copy of a plugin with the position of every placed reference converted.
+	 * @param path			The plugin file.
+	 * @param outputPath	The output file, which can't be the same as the plugin file.
+	 * @param inUnit		The unit that positions are stored in.
+	 * @param outUnit		The unit to convert positions to.
+	 * @returns				The number of references that were converted.
+	 */
+	inline size_t rewrite(std::filesystem::path const& path, std::filesystem::path const& outputPath, conv::Unit const& inUnit, conv::Unit const& outUnit)
+	{
+		// the plugin is memory-mapped, so overwriting it while it's being read would corrupt the output
+		if (std::filesystem::exists(outputPath) && std::filesystem::equivalent(path, outputPath))
+			throw make_exception("The output file can't be the same as the plugin file!");
+
+		const Reader reader{ path };
+		std::ofstream ofs{ outputPath, std::ios_base::binary | std::ios_base::trunc };
+		if (!ofs)
+			throw make_exception("Failed to open output file '", outputPath.generic_string(), "'!");
+		PositionRewriter rewriter{ ofs, inUnit, outUnit };
+		reader.walk(rewriter);
+		rewriter.finish();
+		return rewriter.count;
+	}
+}
@@ -16,81 +16,52 @@ namespace ckconv {
 		return os << (global.useFullNames ? unit.GetFullName() : unit.GetSymbol());
 	}
 
+	/**
+	 * @brief			Prints the units in a measurement system as a table.
+	 * @param os		Output stream.
+	 * @param system	The measurement system to print.
+	 * @param title		The title to print above the table.
+	 */
+	inline void printSystemUnits(std::ostream& os, conv::System const& system, std::string const& title)
+	{
+		constexpr const std::streamsize
+			symbol_indent_postfix{ 8ll },
+			name_indent_postfix{ 16ll };
+		os
+			<< global.csync(global.HeaderColor) << title << " Units:" << global.csync() << "\n"
+			<< "  Symbol  Name            1 in Base Unit\n"
+			<< "  --------------------------------------\n"
+			;
+		for (const auto& unit : system.expand()) {
+			const auto& symbol{ (unit.HasFullName() ? unit.GetSymbol() : ""s) }, name{ unit.GetFullName() };
+			os
+				<< "  " << symbol << indent(symbol_indent_postfix, symbol.size())
+				<< name << indent(name_indent_postfix, name.size())
+				<< unit.GetConversionFactor() << ' ' << *conv::getSystem(unit.GetSystemID())->base
+				<< '\n';
+		}
+	}
+
 	template<conv::SystemID System>
 	struct PrintableMeasurementUnits {
 		friend std::ostream& operator<<(std::ostream& os, const PrintableMeasurementUnits<System>& u)
 		{
-			bool fallthrough{ System == conv::SystemID::ALL }; // fallthrough all cases and print everything
-			constexpr const std::streamsize
-				symbol_indent_postfix{ 8ll },
-				name_indent_postfix{ 16ll };
 			std::stringstream ss;
 
-			switch (System) {
-			case conv::SystemID::ALL:
-				if (!fallthrough) break;
-				[[fallthrough]];
-			case conv::SystemID::CREATIONKIT:
-			{
-				ss
-					<< global.csync(global.HeaderColor) << "Creation Kit Units:" << global.csync() << "\n"
-					<< "  Symbol  Name            1 in Base Unit\n"
-					<< "  --------------------------------------\n"
-					;
-				int power{ -12 };
-				for (const auto& unit : conv::CreationKit.units) {
-					const auto& symbol{ (unit.HasFullName() ? unit.GetSymbol() : ""s) }, name{ unit.GetFullName() };
-					ss
-						<< "  " << symbol << indent(symbol_indent_postfix, symbol.size())
-						<< name << indent(name_indent_postfix, name.size())
-						<< unit.GetConversionFactor() << ' ' << *conv::CreationKit.base
-						<< '\n';
+			if constexpr (System == conv::SystemID::ALL) {
+				// built-in systems are printed in this order, followed by user-defined systems
+				constexpr conv::SystemID order[]{ conv::SystemID::CREATIONKIT, conv::SystemID::METRIC, conv::SystemID::IMPERIAL, conv::SystemID::HAVOK, conv::SystemID::UNREAL, conv::SystemID::UNITY };
+				for (const auto& id : order) {
+					if (id != order[0]) ss << '\n';
+					printSystemUnits(ss, *conv::getSystem(id), conv::getSystem(id)->name);
 				}
-				if (!fallthrough) break;
-				ss << '\n';
-				[[fallthrough]];
-			}
-			case conv::SystemID::METRIC:
-			{
-				ss
-					<< global.csync(global.HeaderColor) << "Metric Units:" << global.csync() << "\n"
-					<< "  Symbol  Name            1 in Base Unit\n"
-					<< "  --------------------------------------\n"
-					;
-				int power{ -12 };
-				for (const auto& unit : conv::Metric.units) {
-					const auto& symbol{ (unit.HasFullName() ? unit.GetSymbol() : ""s) }, name{ unit.GetFullName() };
-					ss
-						<< "  " << symbol << indent(symbol_indent_postfix, symbol.size())
-						<< name << indent(name_indent_postfix, name.size())
-						<< unit.GetConversionFactor() << ' ' << *conv::Metric.base
-						<< '\n';
-					power += (power < 3 || power > 3 ? 3 : 1);
+				for (const auto& system : conv::UserSystems) {
+					ss << '\n';
+					printSystemUnits(ss, *system, system->name);
 				}
-				if (!fallthrough) break;
-				ss << '\n';
-				[[fallthrough]];
-			}
-			case conv::SystemID::IMPERIAL:
-			{
-				ss
-					<< global.csync(global.HeaderColor) << "Imperial Units:" << global.csync() << "\n"
-					<< "  Symbol  Name            1 in Base Unit\n"
-					<< "  --------------------------------------\n"
-					;
-				for (const auto& unit : conv::Imperial.units) {
-					const auto& symbol{ (unit.HasFullName() ? unit.GetSymbol() : ""s) }, name{ unit.GetFullName() };
-					ss
-						<< "  " << symbol << indent(symbol_indent_postfix, symbol.size())
-						<< name << indent(name_indent_postfix, name.size())
-						<< unit.GetConversionFactor() << ' ' << *conv::Imperial.base
-						<< '\n';
-				}
-				if (!fallthrough) break;
-				[[fallthrough]];
-			}
-			default:break;
 			}
+			else printSystemUnits(ss, *conv::getSystem(System), conv::getSystem(System)->name);
+
 			return os << ss.rdbuf();
 		}
 	};
@@ -99,7 +70,8 @@ namespace ckconv {
 	inline const conv::Unit DEFAULT_UNIT{ conv::SystemID::ALL, 0.0, "(all)", "(all)" };
 
 	struct PrintMeasurementUnits {
-		static conv::SystemID StringToSystemID(std::string const& systemName)
+		/// @brief	Gets the built-in system with the given name, or std::nullopt when it isn't the name of a built-in system.
+		static std::optional<conv::SystemID> StringToSystemID(std::string const& systemName)
 		{
 			if (systemName.empty())
 				return conv::SystemID::ALL;
@@ -110,15 +82,50 @@ namespace ckconv {
 				return conv::SystemID::IMPERIAL;
 			if (str::equalsAny<true>(systemName, "creationkit", "ck", "creation-kit", "creation_kit", "gamebryo", "engine", "bethesda"))
 				return conv::SystemID::CREATIONKIT;
+			if (str::equalsAny<true>(systemName, "havok", "hk", "physics"))
+				return conv::SystemID::HAVOK;
+			if (str::equalsAny<true>(systemName, "unreal", "ue", "unreal-engine", "unreal_engine"))
+				return conv::SystemID::UNREAL;
+			if (str::equalsAny<true>(systemName, "unity"))
+				return conv::SystemID::UNITY;
 
-			return conv::getUnit(systemName, DEFAULT_UNIT).GetSystemID();
+			return std::nullopt;
+		}
+		/// @brief	Gets the user-defined system with the given name, or the one that contains the given user-defined unit, or nullptr.
+		static const conv::System* StringToUserSystem(std::string const& systemName)
+		{
+			const auto& name{ str::tolower(systemName) };
+			for (const auto& system : conv::UserSystems)
+				if (str::tolower(std::string{ system->name }) == name)
+					return system.get();
+			// built-in units take precedence over user-defined units, the same way as in conv::getUnit()
+			for (const auto* system : conv::BuiltinSystems)
+				if (system->resolve(systemName).has_value())
+					return nullptr;
+			for (const auto& system : conv::UserSystems)
+				if (system->resolve(systemName).has_value())
+					return system.get();
+			return nullptr;
 		}
 
-		conv::SystemID system;
-		PrintMeasurementUnits(std::string const& systemName) : system{ StringToSystemID(systemName) } {}
+		conv::SystemID system{ conv::SystemID::ALL };
+		/// @brief	The user-defined system to print instead of a built-in system, or nullptr.
+		const conv::System* userSystem{ nullptr };
+		PrintMeasurementUnits(std::string const& systemName)
+		{
+			// user-defined systems are checked before the name is resolved as a unit, since custom units use the SystemID of a built-in system
+			if (const auto& id{ StringToSystemID(systemName) }; id.has_value())
+				system = id.value();
+			else if (userSystem = StringToUserSystem(systemName); userSystem == nullptr)
+				system = conv::getUnit(systemName, DEFAULT_UNIT).GetSystemID();
+		}
 		PrintMeasurementUnits(conv::SystemID const& systemID) : system{ systemID } {}
 		friend std::ostream& operator<<(std::ostream& os, const PrintMeasurementUnits& pm)
 		{
+			if (pm.userSystem != nullptr) {
+				printSystemUnits(os, *pm.userSystem, pm.userSystem->name);
+				return os;
+			}
 			switch (pm.system) {
 			case conv::SystemID::ALL:
 				return os << PrintableMeasurementUnits<conv::SystemID::ALL>();
@@ -128,6 +135,12 @@ namespace ckconv {
 				return os << PrintableMeasurementUnits<conv::SystemID::IMPERIAL>();
 			case conv::SystemID::CREATIONKIT:
 				return os << PrintableMeasurementUnits<conv::SystemID::CREATIONKIT>();
+			case conv::SystemID::HAVOK:
+				return os << PrintableMeasurementUnits<conv::SystemID::HAVOK>();
+			case conv::SystemID::UNREAL:
+				return os << PrintableMeasurementUnits<conv::SystemID::UNREAL>();
+			case conv::SystemID::UNITY:
+				return os << PrintableMeasurementUnits<conv::SystemID::UNITY>();
 			default:
 				return os;
 			}
@@ -0,0 +1,152 @@
+#pragma once
+/**
+ * @file	Quantity.hpp
+ * @author	radj307
+ * @brief	Compile-time length quantities, for C++ code that converts between units that are known at compile time.
+ *\n		Conversions between Quantity types are folded into a single constant multiplication; conv::Unit is still used when the units are only known at runtime.
+ *\n
+ *\n		Example:
+ *\n		  using namespace conv::literals;
+ *\n		  constexpr conv::Meters m{ 128.0_u };	// 1.8288m
+ *\n		  static_assert(conv::Feet{ 12_in }.count() == 1.0L);
+ */
+#include "conv.hpp"
+
+#include <compare>
+#include <ratio>
+#include <type_traits>
+
+namespace conv {
+	namespace _internal {
+		template<typename T> struct is_ratio : std::false_type {};
+		template<std::intmax_t Num, std::intmax_t Den> struct is_ratio<std::ratio<Num, Den>> : std::true_type {};
+
+		template<typename TRatio>
+		inline constexpr number_t ratio_value{ static_cast<number_t>(TRatio::num) / static_cast<number_t>(TRatio::den) };
+	}
+
+	/**
+	 * @class			Quantity
+	 * @brief			A length measurement in a unit that is known at compile time.
+	 * @tparam System	The measurement system that the unit belongs to. This cannot be SystemID::ALL.
+	 * @tparam Ratio	A std::ratio that specifies the size of the unit, relative to the system's base unit. *(Meters, Feet, or Units)*
+	 */
+	template<SystemID System, typename Ratio = std::ratio<1>> requires (System != SystemID::ALL && _internal::is_ratio<typename Ratio::type>::value)
+	class Quantity {
+		number_t value{ 0.0L };
+
+		/// @brief	Gets the factor that converts values in the given quantity type to this quantity type.
+		template<SystemID InSystem, typename InRatio>
+		static constexpr number_t factor_from() noexcept
+		{
+			if constexpr (InSystem == System) // reduce the ratio first to avoid rounding errors
+				return _internal::ratio_value<std::ratio_divide<InRatio, Ratio>>;
+			else return convert_system(InSystem, _internal::ratio_value<InRatio>, System) / _internal::ratio_value<Ratio>;
+		}
+
+	public:
+		static constexpr SystemID system{ System };
+		using ratio = typename Ratio::type;
+
+		constexpr Quantity() = default;
+		constexpr explicit Quantity(const number_t value) noexcept : value{ value } {}
+		/// @brief	Converts from another quantity type. The conversion factor is computed at compile time.
+		template<SystemID InSystem, typename InRatio>
+		constexpr Quantity(Quantity<InSystem, InRatio> const& other) noexcept : value{ other.count() * factor<InSystem, InRatio> } {}
+
+		/// @brief	The factor that converts values in the given quantity type to this quantity type.
+		template<SystemID InSystem, typename InRatio>
+		static constexpr number_t factor{ factor_from<InSystem, InRatio>() };
+
+		/// @brief	Gets the value of this quantity, in its own unit.
+		constexpr number_t count() const noexcept { return value; }
+
+		/// @brief	Gets the runtime equivalent of this quantity's unit, which has no symbol or name.
+		WINCONSTEXPR Unit unit() const { return Unit{ System, _internal::ratio_value<Ratio>, "" }; }
+		/**
+		 * @brief		Converts this quantity to a unit that is only known at runtime.
+		 * @param out	Output Unit.
+		 * @returns		number_t
+		 */
+		number_t to(Unit const& out) const { return convert(unit(), value, out); }
+
+		constexpr Quantity operator+() const noexcept { return *this; }
+		constexpr Quantity operator-() const noexcept { return Quantity{ -value }; }
+		constexpr Quantity& operator+=(Quantity const& o) noexcept { value += o.value; return *this; }
+		constexpr Quantity& operator-=(Quantity const& o) noexcept { value -= o.value; return *this; }
+		constexpr Quantity& operator*=(const number_t n) noexcept { value *= n; return *this; }
+		constexpr Quantity& operator/=(const number_t n) noexcept { value /= n; return *this; }
+
+		/// @brief	Adds two quantities. The result has the type of the left operand.
+		template<SystemID RSystem, typename RRatio>
+		friend constexpr Quantity operator+(Quantity l, Quantity<RSystem, RRatio> const& r) noexcept { return l += Quantity{ r }; }
+		/// @brief	Subtracts two quantities. The result has the type of the left operand.
+		template<SystemID RSystem, typename RRatio>
+		friend constexpr Quantity operator-(Quantity l, Quantity<RSystem, RRatio> const& r) noexcept { return l -= Quantity{ r }; }
+		friend constexpr Quantity operator*(Quantity l, const number_t n) noexcept { return l *= n; }
+		friend constexpr Quantity operator*(const number_t n, Quantity r) noexcept { return r *= n; }
+		friend constexpr Quantity operator/(Quantity l, const number_t n) noexcept { return l /= n; }
+		/// @brief	Gets the ratio between two quantities of the same type.
+		friend constexpr number_t operator/(Quantity const& l, Quantity const& r) noexcept { return l.value / r.value; }
+
+		friend constexpr auto operator<=>(Quantity const&, Quantity const&) noexcept = default;
+		/// @brief	Compares two quantities after converting the right operand to the type of the left operand.
+		template<SystemID RSystem, typename RRatio>
+		friend constexpr auto operator<=>(Quantity const& l, Quantity<RSystem, RRatio> const& r) noexcept { return l.value <=> Quantity{ r }.value; }
+		template<SystemID RSystem, typename RRatio>
+		friend constexpr bool operator==(Quantity const& l, Quantity<RSystem, RRatio> const& r) noexcept { return l.value == Quantity{ r }.value; }
+	};
+
+	/**
+	 * @brief		Converts a quantity to another quantity type. This is equivalent to the converting constructor.
+	 * @tparam TOut	The output Quantity type.
+	 * @param in	Input quantity.
+	 * @returns		TOut
+	 */
+	template<typename TOut, SystemID InSystem, typename InRatio>
+	constexpr TOut quantity_cast(Quantity<InSystem, InRatio> const& in) noexcept
+	{
+		return TOut{ in };
+	}
+
+	// Metric
+	using Millimeters = Quantity<SystemID::METRIC, std::milli>;
+	using Centimeters = Quantity<SystemID::METRIC, std::centi>;
+	using Meters = Quantity<SystemID::METRIC>;
+	using Kilometers = Quantity<SystemID::METRIC, std::kilo>;
+	// Imperial
+	using Thous = Quantity<SystemID::IMPERIAL, std::ratio<1, 12000>>;
+	using Inches = Quantity<SystemID::IMPERIAL, std::ratio<1, 12>>;
+	using Feet = Quantity<SystemID::IMPERIAL>;
+	using Yards = Quantity<SystemID::IMPERIAL, std::ratio<3>>;
+	using Miles = Quantity<SystemID::IMPERIAL, std::ratio<5280>>;
+	// Creation Kit
+	using Units = Quantity<SystemID::CREATIONKIT>;
+	using Kilounits = Quantity<SystemID::CREATIONKIT, std::kilo>;
+	// Game engines
+	using HavokUnits = Quantity<SystemID::HAVOK>;
+	using UnrealUnits = Quantity<SystemID::UNREAL>;
+	using UnityUnits = Quantity<SystemID::UNITY>;
+
+	/// @brief	User-defined literals for Quantity types. *(ex. 10.0_u, 3.5_m, 12_ft)*
+	namespace literals {
+	#define CKCONV_DEFINE_QUANTITY_LITERAL(suffix, type) \
+		constexpr type operator""_##suffix(const long double v) noexcept { return type{ static_cast<number_t>(v) }; } \
+		constexpr type operator""_##suffix(const unsigned long long v) noexcept { return type{ static_cast<number_t>(v) }; }
+
+		CKCONV_DEFINE_QUANTITY_LITERAL(mm, Millimeters)
+		CKCONV_DEFINE_QUANTITY_LITERAL(cm, Centimeters)
+		CKCONV_DEFINE_QUANTITY_LITERAL(m, Meters)
+		CKCONV_DEFINE_QUANTITY_LITERAL(km, Kilometers)
+		CKCONV_DEFINE_QUANTITY_LITERAL(th, Thous)
+		CKCONV_DEFINE_QUANTITY_LITERAL(in, Inches)
+		CKCONV_DEFINE_QUANTITY_LITERAL(ft, Feet)
+		CKCONV_DEFINE_QUANTITY_LITERAL(yd, Yards)
+		CKCONV_DEFINE_QUANTITY_LITERAL(mi, Miles)
+		CKCONV_DEFINE_QUANTITY_LITERAL(u, Units)
+		CKCONV_DEFINE_QUANTITY_LITERAL(ku, Kilounits)
+		CKCONV_DEFINE_QUANTITY_LITERAL(hk, HavokUnits)
+
+	#undef CKCONV_DEFINE_QUANTITY_LITERAL
+	}
+}
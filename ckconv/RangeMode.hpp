@@ -0,0 +1,180 @@
+#pragma once
+/**
+ * @file	RangeMode.hpp
+ * @author	radj307
+ * @brief	Generates conversion tables for a range of input values, without parsing any input.
+ */
+#include "conv.hpp"
+#include "global.h"
+#include "RecordWriter.hpp"
+
+#include <str.hpp>
+#include <make_exception.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ckconv {
+	/**
+	 * @struct	RangeSpec
+	 * @brief	Describes an evenly-spaced range of values, including both ends.
+	 */
+	struct RangeSpec {
+		long double start, stop, step;
+
+		/// @brief	The largest number of values in a range. Larger ranges are almost certainly a typo, and their size can't be represented.
+		static constexpr size_t MAX_SIZE{ 1'000'000'000ull };
+
+		/**
+		 * @brief		Parses a range from a string in the form "<START>:<STOP>:<STEP>". The step defaults to 1 when omitted.
+		 * @param s		Input string.
+		 * @returns		RangeSpec
+		 */
+		static RangeSpec parse(std::string const& s)
+		{
+			const auto& segments{ str::split_all(s, ":") };
+			if (segments.size() < 2 || segments.size() > 3)
+				throw make_exception("Invalid range '", s, "'; expected '<START>:<STOP>[:<STEP>]'!");
+
+			RangeSpec range{ str::stold(segments[0]), str::stold(segments[1]), (segments.size() == 3 ? str::stold(segments[2]) : 1.0L) };
+			if (range.step == 0.0L || !std::isfinite(range.step) || !std::isfinite(range.start) || !std::isfinite(range.stop))
+				throw make_exception("Invalid range '", s, "'; the start, stop, & step must be finite and the step can't be zero!");
+			if ((range.stop - range.start) / range.step < 0.0L)
+				throw make_exception("Invalid range '", s, "'; the step moves away from the stop value!");
+			// checked before size() casts the count to an integer
+			if ((range.stop - range.start) / range.step >= static_cast<long double>(MAX_SIZE))
+				throw make_exception("Invalid range '", s, "'; it contains more than ", MAX_SIZE, " values!");
+			return range;
+		}
+
+		/// @brief	Gets the number of values in the range.
+		size_t size() const noexcept
+		{
+			// allow for a small amount of rounding error so the stop value is included
+			return static_cast<size_t>(std::floor((stop - start) / step + 1e-9L)) + 1ull;
+		}
+		/// @brief	Gets the value at the given index. Values are computed directly from the index so rounding errors don't accumulate.
+		long double at(const size_t i) const noexcept
+		{
+			return start + static_cast<long double>(i) * step;
+		}
+	};
+
+	/**
+	 * @brief			Converts a contiguous block of values with a single factor.
+	 *\n				This is kept as a simple loop over contiguous memory so the compiler can vectorize it on platforms where number_t is a double.
+	 * @param in		Input values.
+	 * @param out		Output values. Must be at least as large as the input.
+	 * @param count		Number of values.
+	 * @param factor	Conversion factor, from conv::getConversionFactor().
+	 */
+	inline void convertBlock(const conv::number_t* const in, conv::number_t* const out, const size_t count, const conv::number_t factor) noexcept
+	{
+		for (size_t i{ 0 }; i < count; ++i)
+			out[i] = in[i] * factor;
+	}
+
+	/**
+	 * @class	RangeTable
+	 * @brief	Converts a range of values to one or more output units in parallel chunks, & streams the results as columns.
+	 *\n		With a structured --format, each value is written as one record per output unit instead.
+	 */
+	class RangeTable {
+		RangeSpec range;
+		conv::Unit inUnit;
+		std::vector<conv::Unit> outUnits;
+		std::vector<conv::number_t> factors;
+		/// @brief	The unit names, from format_unit().
+		std::string inName;
+		std::vector<std::string> outNames;
+		RecordWriter writer{ global.outputFormat };
+
+		/// @brief	The number of rows that each thread converts & formats at a time.
+		static constexpr size_t CHUNK_SIZE{ 16384 };
+
+		/// @brief	Converts & formats the rows in [begin, end).
+		std::string formatChunk(const size_t begin, const size_t end) const
+		{
+			const size_t count{ end - begin };
+			std::vector<conv::number_t> values(count), results(count * factors.size());
+
+			for (size_t i{ 0 }; i < count; ++i)
+				values[i] = range.at(begin + i);
+			for (size_t col{ 0 }; col < factors.size(); ++col)
+				convertBlock(values.data(), results.data() + col * count, count, factors[col]);
+
+			std::string buffer;
+			if (global.outputFormat != OutputFormat::HUMAN) {
+				for (size_t i{ 0 }; i < count; ++i)
+					for (size_t col{ 0 }; col < factors.size(); ++col)
+						writer.writeResult(buffer, values[i], inName, results[col * count + i], outNames[col]);
+				return buffer;
+			}
+			buffer.reserve(count * (factors.size() + 1) * 12);
+			for (size_t i{ 0 }; i < count; ++i) {
+				append_fp(buffer, values[i]);
+				for (size_t col{ 0 }; col < factors.size(); ++col) {
+					buffer += '\t';
+					append_fp(buffer, results[col * count + i]);
+				}
+				buffer += '\n';
+			}
+			return buffer;
+		}
+
+	public:
+		RangeTable(RangeSpec const& range, conv::Unit const& inUnit, std::vector<conv::Unit> const& outUnits) : range{ range }, inUnit{ inUnit }, outUnits{ outUnits }, inName{ format_unit(inUnit, true) }
+		{
+			if (outUnits.empty())
+				throw make_exception("No output units were specified for the range!");
+			factors.reserve(outUnits.size());
+			outNames.reserve(outUnits.size());
+			for (const auto& outUnit : outUnits) {
+				factors.emplace_back(conv::getConversionFactor(inUnit, outUnit));
+				outNames.emplace_back(format_unit(outUnit, true));
+			}
+		}
+
+		/**
+		 * @brief			Writes the table to the given stream. Chunks are converted on all available threads, and written in order.
+		 * @param os		Output stream.
+		 * @param header	When true, a header row containing the unit names is written first. *(or the CSV/TSV header row)*
+		 */
+		void write(std::ostream& os, const bool header) const
+		{
+			if (header && global.outputFormat != OutputFormat::HUMAN) {
+				std::string buffer;
+				writer.writeHeader(buffer);
+				os << buffer;
+			}
+			else if (header) {
+				os << global.csync(global.HeaderColor) << inName;
+				for (const auto& outName : outNames)
+					os << '\t' << outName;
+				os << global.csync() << '\n';
+			}
+
+			const size_t total{ range.size() };
+			const size_t threadCount{ std::max(1u, std::thread::hardware_concurrency()) };
+
+			// convert one chunk per thread at a time, so memory usage stays bounded regardless of the size of the range
+			std::vector<std::future<std::string>> chunks;
+			chunks.reserve(threadCount);
+			for (size_t begin{ 0 }; begin < total; ) {
+				chunks.clear();
+				for (size_t t{ 0 }; t < threadCount && begin < total; ++t, begin += CHUNK_SIZE) {
+					const size_t end{ std::min(begin + CHUNK_SIZE, total) };
+					chunks.emplace_back(std::async(std::launch::async, &RangeTable::formatChunk, this, begin, end));
+				}
+				for (auto& chunk : chunks)
+					os << chunk.get();
+			}
+			os.flush();
+		}
+	};
+}
@@ -0,0 +1,290 @@
+#pragma once
+/**
+ * @file	RecordWriter.hpp
+ * @author	radj307
+ * @brief	Writes conversion results as structured records *(JSON Lines, CSV, or TSV)* for other programs to consume.
+ */
+#include "global.h"
+
+#include <make_exception.hpp>
+#include <str.hpp>
+
+#include <cmath>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace ckconv {
+	/**
+	 * @brief		Parses the name of an output format.
+	 * @param s		Input string. *(human, jsonl, csv, or tsv)*
+	 * @returns		OutputFormat
+	 */
+	inline OutputFormat parseOutputFormat(std::string const& s)
+	{
+		const auto& name{ str::tolower(s) };
+		if (name == "human" || name == "text")
+			return OutputFormat::HUMAN;
+		if (name == "jsonl" || name == "json" || name == "ndjson")
+			return OutputFormat::JSONL;
+		if (name == "csv")
+			return OutputFormat::CSV;
+		if (name == "tsv")
+			return OutputFormat::TSV;
+		throw make_exception("Invalid output format '", s, "'; expected 'human', 'jsonl', 'csv', or 'tsv'!");
+	}
+
+	/**
+	 * @class	RecordWriter
+	 * @brief	Appends records directly to an output buffer. Every record has the same fields: the input value, input unit,-
+	 *\n		 -output value, output unit, & error message. Fields that don't apply are empty *(or null, for JSON)*.
+	 *\n		The input value is always a string in JSON Lines, since failed conversions & expressions write the input exactly as it-
+	 *\n		 -was received. The output value is a number, or null when the conversion failed.
+	 */
+	class RecordWriter {
+		OutputFormat format;
+
+	public:
+		/// @brief	Appends a CSV field, quoting it if necessary.
+		static void appendCSV(std::string& buffer, std::string_view const& field)
+		{
+			if (field.find_first_of(",\"\r\n") == std::string_view::npos) {
+				buffer += field;
+				return;
+			}
+			buffer += '"';
+			for (const char c : field) {
+				if (c == '"')
+					buffer += '"';
+				buffer += c;
+			}
+			buffer += '"';
+		}
+		/// @brief	Appends a TSV field. Tabs & newlines can't be escaped in TSV, so they're replaced with spaces.
+		static void appendTSV(std::string& buffer, std::string_view const& field)
+		{
+			for (const char c : field)
+				buffer += (c == '\t' || c == '\r' || c == '\n') ? ' ' : c;
+		}
+		/// @brief	Appends a quoted JSON string.
+		static void appendJSON(std::string& buffer, std::string_view const& field)
+		{
+			constexpr char HEX[]{ "0123456789abcdef" };
+			buffer += '"';
+			for (const char c : field) {
+				switch (c) {
+				case '"':
+					buffer += "\\\"";
+					break;
+				case '\\':
+					buffer += "\\\\";
+					break;
+				case '\n':
+					buffer += "\\n";
+					break;
+				case '\r':
+					buffer += "\\r";
+					break;
+				case '\t':
+					buffer += "\\t";
+					break;
+				default:
+					if (static_cast<unsigned char>(c) < 0x20) {
+						buffer += "\\u00";
+						buffer += HEX[(c >> 4) & 0xF];
+						buffer += HEX[c & 0xF];
+					}
+					else buffer += c;
+					break;
+				}
+			}
+			buffer += '"';
+		}
+		/// @brief	Appends a JSON number, or null if it isn't finite. Hexadecimal notation is written as a string, since JSON doesn't support it.
+		static void appendJSON(std::string& buffer, const long double value)
+		{
+			if (!std::isfinite(value)) {
+				buffer += "null";
+				return;
+			}
+			const bool hex{ global.floatfield.has_value() && (global.floatfield.value() & std::ios_base::floatfield) == (std::ios_base::fixed | std::ios_base::scientific) };
+			if (hex) buffer += '"';
+			append_fp(buffer, value);
+			if (hex) buffer += '"';
+		}
+
+	private:
+		/// @brief	Appends a number as a quoted JSON string, for the input value field.
+		static void appendJSONString(std::string& buffer, const long double value)
+		{
+			buffer += '"';
+			append_fp(buffer, value);
+			buffer += '"';
+		}
+		/// @brief	Appends the separator between two fields.
+		void separator(std::string& buffer) const
+		{
+			buffer += (format == OutputFormat::TSV ? '\t' : ',');
+		}
+		/// @brief	Appends a string field.
+		void field(std::string& buffer, std::string_view const& value) const
+		{
+			if (format == OutputFormat::CSV)
+				appendCSV(buffer, value);
+			else appendTSV(buffer, value);
+		}
+
+	public:
+		RecordWriter(const OutputFormat format) : format{ format } {}
+
+		/// @brief	Appends the header row for CSV & TSV. Does nothing for JSON Lines.
+		void writeHeader(std::string& buffer) const
+		{
+			if (format == OutputFormat::CSV)
+				buffer += "input_value,input_unit,output_value,output_unit,error\n";
+			else if (format == OutputFormat::TSV)
+				buffer += "input_value\tinput_unit\toutput_value\toutput_unit\terror\n";
+		}
+
+		/**
+		 * @brief			Appends a successful conversion.
+		 * @param buffer	Output buffer.
+		 * @param inValue	The input value.
+		 * @param inUnit	The input unit, from format_unit().
+		 * @param outValue	The converted value.
+		 * @param outUnit	The output unit, from format_unit().
+		 */
+		void writeResult(std::string& buffer, const long double inValue, std::string_view const& inUnit, const long double outValue, std::string_view const& outUnit) const
+		{
+			if (format == OutputFormat::JSONL) {
+				buffer += "{\"input_value\":";
+				appendJSONString(buffer, inValue);
+				buffer += ",\"input_unit\":";
+				appendJSON(buffer, inUnit);
+				buffer += ",\"output_value\":";
+				appendJSON(buffer, outValue);
+				buffer += ",\"output_unit\":";
+				appendJSON(buffer, outUnit);
+				buffer += ",\"error\":null}\n";
+				return;
+			}
+			append_fp(buffer, inValue);
+			separator(buffer);
+			field(buffer, inUnit);
+			separator(buffer);
+			append_fp(buffer, outValue);
+			separator(buffer);
+			field(buffer, outUnit);
+			separator(buffer);
+			buffer += '\n';
+		}
+
+		/**
+		 * @brief			Appends a successful conversion to a compound output unit, i.e. "ft+in".
+		 *\n				JSON Lines writes the output value as an array with one number per unit; CSV & TSV join them with '+', like the unit.
+		 * @param buffer	Output buffer.
+		 * @param inValue	The input value.
+		 * @param inUnit	The input unit, from format_unit().
+		 * @param outValues	The value of each output unit, from CompoundUnit::split().
+		 * @param outUnit	The compound output unit, with each unit from format_unit() joined by '+'.
+		 */
+		void writeResult(std::string& buffer, const long double inValue, std::string_view const& inUnit, std::span<const long double> outValues, std::string_view const& outUnit) const
+		{
+			if (format == OutputFormat::JSONL) {
+				buffer += "{\"input_value\":";
+				appendJSONString(buffer, inValue);
+				buffer += ",\"input_unit\":";
+				appendJSON(buffer, inUnit);
+				buffer += ",\"output_value\":[";
+				for (size_t i{ 0ull }; i < outValues.size(); ++i) {
+					if (i != 0ull)
+						buffer += ',';
+					appendJSON(buffer, outValues[i]);
+				}
+				buffer += "],\"output_unit\":";
+				appendJSON(buffer, outUnit);
+				buffer += ",\"error\":null}\n";
+				return;
+			}
+			append_fp(buffer, inValue);
+			separator(buffer);
+			field(buffer, inUnit);
+			separator(buffer);
+			for (size_t i{ 0ull }; i < outValues.size(); ++i) {
+				if (i != 0ull)
+					buffer += '+';
+				append_fp(buffer, outValues[i]);
+			}
+			separator(buffer);
+			field(buffer, outUnit);
+			separator(buffer);
+			buffer += '\n';
+		}
+
+		/**
+		 * @brief			Appends a successful conversion whose input isn't a single number, such as an expression.
+		 * @param buffer	Output buffer.
+		 * @param input		The input string, which is written in the input value field.
+		 * @param inUnit	The input unit, or an empty string.
+		 * @param outValue	The converted value.
+		 * @param outUnit	The output unit, from format_unit().
+		 */
+		void writeResult(std::string& buffer, std::string_view const& input, std::string_view const& inUnit, const long double outValue, std::string_view const& outUnit) const
+		{
+			if (format == OutputFormat::JSONL) {
+				buffer += "{\"input_value\":";
+				appendJSON(buffer, input);
+				buffer += ",\"input_unit\":";
+				appendJSON(buffer, inUnit);
+				buffer += ",\"output_value\":";
+				appendJSON(buffer, outValue);
+				buffer += ",\"output_unit\":";
+				appendJSON(buffer, outUnit);
+				buffer += ",\"error\":null}\n";
+				return;
+			}
+			field(buffer, input);
+			separator(buffer);
+			field(buffer, inUnit);
+			separator(buffer);
+			append_fp(buffer, outValue);
+			separator(buffer);
+			field(buffer, outUnit);
+			separator(buffer);
+			buffer += '\n';
+		}
+
+		/**
+		 * @brief			Appends a failed conversion. The input fields are written exactly as they were received.
+		 * @param buffer	Output buffer.
+		 * @param inValue	The input value string.
+		 * @param inUnit	The input unit string.
+		 * @param outUnit	The output unit string.
+		 * @param error		The error message.
+		 */
+		void writeError(std::string& buffer, std::string_view const& inValue, std::string_view const& inUnit, std::string_view const& outUnit, std::string_view const& error) const
+		{
+			if (format == OutputFormat::JSONL) {
+				buffer += "{\"input_value\":";
+				appendJSON(buffer, inValue);
+				buffer += ",\"input_unit\":";
+				appendJSON(buffer, inUnit);
+				buffer += ",\"output_value\":null,\"output_unit\":";
+				appendJSON(buffer, outUnit);
+				buffer += ",\"error\":";
+				appendJSON(buffer, error);
+				buffer += "}\n";
+				return;
+			}
+			field(buffer, inValue);
+			separator(buffer);
+			field(buffer, inUnit);
+			separator(buffer);
+			separator(buffer);
+			field(buffer, outUnit);
+			separator(buffer);
+			field(buffer, error);
+			buffer += '\n';
+		}
+	};
+}
@@ -0,0 +1,350 @@
+#pragma once
+/**
+ * @file	SharedMemoryRing.hpp
+ * @author	radj307
+ * @brief	Shared-memory ring buffer that lets other processes on the same machine request conversions without a syscall per message.
+ * @details	The ring lives in a POSIX shared memory object and is made up of a fixed number of slots, each of which is claimed by a client-
+ *			-using an atomic ticket. Any number of clients may post requests concurrently, and a single server *(ckconv --shm <NAME>)* answers them in order.
+ *			Both sides spin for a short time before blocking with a futex *(Linux)* or yielding *(other POSIX systems)*.
+ *\n		Every slot has a sequence number that moves through these states for the ticket `t` that currently owns it:
+ *\n		  t          free; the client that owns ticket t may write its request
+ *\n		  t + 1      request posted; the server may read it
+ *\n		  t + 2      result posted; the client may read it
+ *\n		  t + cap    released; the slot is free for the next lap of the ring
+ */
+#include "conv.hpp"
+#include "AllocStats.hpp"
+
+#include <sysarch.h>
+#include <make_exception.hpp>
+
+#ifndef OS_WIN
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef OS_LINUX
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace ckconv::shm {
+	/// @brief	Identifies the shared memory layout; "CKSH" in little-endian.
+	inline constexpr uint32_t MAGIC{ 0x48534B43 };
+	/// @brief	Incremented whenever the shared memory layout changes.
+	inline constexpr uint32_t VERSION{ 1 };
+	/// @brief	Number of slots used when the server creates the ring.
+	inline constexpr uint32_t DEFAULT_CAPACITY{ 4096 };
+	/// @brief	Number of times to spin before blocking.
+	inline constexpr int SPIN_COUNT{ 4096 };
+	/// @brief	The smallest number of slots; with fewer, a released slot *(t + cap)* can't be told apart from a posted request or result.
+	inline constexpr uint32_t MIN_CAPACITY{ 4 };
+	/// @brief	The longest time that a wait() with a shutdown flag blocks before checking the flag again, in nanoseconds.
+	inline constexpr long SHUTDOWN_POLL_NS{ 100'000'000 };
+
+	static_assert(std::atomic<uint32_t>::is_always_lock_free, "The shared memory ring requires lock-free 32-bit atomics!");
+
+	/// @brief	Result codes written to Slot::status by the server.
+	enum class Status : int32_t {
+		OK = 0,
+		INVALID_UNIT = 1,
+		CONVERSION_FAILED = 2,
+	};
+
+	/**
+	 * @struct	Slot
+	 * @brief	One binary request & its result.
+	 */
+	struct alignas(64) Slot {
+		std::atomic<uint32_t> seq;
+		/// @brief	The number of clients that are blocked waiting for this slot.
+		std::atomic<uint32_t> waiting;
+		conv::unit_id_t inUnit;
+		conv::unit_id_t outUnit;
+		double value;
+		double result;
+		Status status;
+	};
+
+	/**
+	 * @struct	Header
+	 * @brief	Located at the beginning of the shared memory object, and followed by the slots.
+	 */
+	struct Header {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t capacity;
+		/// @brief	Set to non-zero to make the server exit.
+		std::atomic<uint32_t> shutdown;
+		/// @brief	The next ticket that will be handed out to a client.
+		alignas(64) std::atomic<uint32_t> head;
+		/// @brief	The next ticket that the server will answer.
+		alignas(64) std::atomic<uint32_t> tail;
+		/// @brief	Non-zero while the server is blocked waiting for a request.
+		alignas(64) std::atomic<uint32_t> serverWaiting;
+
+		Slot* slots() noexcept { return reinterpret_cast<Slot*>(this + 1); }
+		Slot& slot(const uint32_t ticket) noexcept { return slots()[ticket % capacity]; }
+	};
+
+	/// @brief	Gets the size of a shared memory object that has the given number of slots.
+	inline constexpr size_t getSize(const uint32_t capacity) noexcept { return sizeof(Header) + sizeof(Slot) * capacity; }
+
+	/**
+	 * @brief			Blocks until the value of the given atomic is no longer equal to the expected value, or a spurious wakeup occurs.
+	 * @param word		The atomic to wait on.
+	 * @param expected	The value to wait for the atomic to change from.
+	 * @param timeout	When true, this returns after at most SHUTDOWN_POLL_NS even if the value didn't change.
+	 */
+	inline void wait(std::atomic<uint32_t>& word, const uint32_t expected, const bool timeout = false) noexcept
+	{
+	#ifdef OS_LINUX
+		const timespec poll{ 0, SHUTDOWN_POLL_NS };
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, timeout ? &poll : nullptr, nullptr, 0);
+	#else
+		(void)timeout;
+		if (word.load() == expected)
+			std::this_thread::yield();
+	#endif
+	}
+	/// @brief	Wakes all threads *(in any process)* that are blocked in wait() on the given atomic.
+	inline void wake(std::atomic<uint32_t>& word) noexcept
+	{
+	#ifdef OS_LINUX
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+	#else
+		(void)word;
+	#endif
+	}
+
+	/**
+	 * @brief			Spins, and then blocks, until the given sequence number reaches the target value.
+	 * @param seq		The sequence number to wait on.
+	 * @param target	The value to wait for.
+	 * @param waiting	Counts the threads that are blocked, so that the other side knows that it has to call wake().
+	 * @param shutdown	Optional flag that stops waiting early when it becomes non-zero.
+	 * @returns			true when the target was reached; false when shutdown was requested.
+	 */
+	inline bool await(std::atomic<uint32_t>& seq, const uint32_t target, std::atomic<uint32_t>& waiting, const std::atomic<uint32_t>* shutdown = nullptr) noexcept
+	{
+		for (int i{ 0 }; i < SPIN_COUNT; ++i)
+			if (seq.load(std::memory_order_acquire) == target)
+				return true;
+		for (uint32_t current; (current = seq.load(std::memory_order_acquire)) != target; ) {
+			if (shutdown != nullptr && shutdown->load(std::memory_order_acquire) != 0)
+				return false;
+			waiting.fetch_add(1);
+			// re-check after announcing that we're waiting, so a wake() can't be missed. Client::shutdown() doesn't change the-
+			//  -sequence number, so a shutdown that lands between this check & the futex is only seen when the wait times out.
+			if ((current = seq.load()) != target && (shutdown == nullptr || shutdown->load() == 0))
+				wait(seq, current, shutdown != nullptr);
+			waiting.fetch_sub(1);
+		}
+		return true;
+	}
+
+	/**
+	 * @class	Mapping
+	 * @brief	RAII wrapper for a mapped POSIX shared memory object.
+	 */
+	class Mapping {
+		std::string name;
+		Header* header{ nullptr };
+		size_t size{ 0 };
+		bool owner{ false };
+
+	public:
+		/**
+		 * @brief			Creates *(or attaches to)* the named shared memory object.
+		 * @param name		The name of the shared memory object. A leading '/' is added when missing.
+		 * @param create	When true, the object is created & initialized with the given capacity; otherwise an existing object is attached to.
+		 * @param capacity	The number of slots to use when creating the object. Must be a power of two, and at least MIN_CAPACITY.
+		 */
+		Mapping(std::string const& name, const bool create, const uint32_t capacity = DEFAULT_CAPACITY) : name{ name.starts_with('/') ? name : '/' + name }, owner{ create }
+		{
+			// tickets wrap around at 2^32, so the capacity has to divide it evenly
+			if (create && (capacity < MIN_CAPACITY || (capacity & (capacity - 1)) != 0))
+				throw make_exception("Shared memory ring capacity must be a power of two, and at least ", MIN_CAPACITY, '!');
+
+			const int fd{ shm_open(this->name.c_str(), create ? (O_CREAT | O_RDWR) : O_RDWR, 0600) };
+			if (fd == -1)
+				throw make_exception("Failed to open shared memory object '", this->name, "'!");
+
+			if (create) {
+				size = getSize(capacity);
+				if (ftruncate(fd, static_cast<off_t>(size)) == -1) {
+					close(fd);
+					throw make_exception("Failed to resize shared memory object '", this->name, "'!");
+				}
+			}
+			else {
+				struct stat st {};
+				if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+					close(fd);
+					throw make_exception("Shared memory object '", this->name, "' isn't a ckconv ring!");
+				}
+				size = static_cast<size_t>(st.st_size);
+			}
+
+			void* addr{ mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) };
+			close(fd);
+			if (addr == MAP_FAILED)
+				throw make_exception("Failed to map shared memory object '", this->name, "'!");
+			header = static_cast<Header*>(addr);
+
+			if (create) {
+				header->magic = MAGIC;
+				header->version = VERSION;
+				header->capacity = capacity;
+				header->shutdown.store(0);
+				header->head.store(0);
+				header->tail.store(0);
+				header->serverWaiting.store(0);
+				for (uint32_t i{ 0 }; i < capacity; ++i) {
+					header->slots()[i].seq.store(i);
+					header->slots()[i].waiting.store(0);
+				}
+			}
+			else if (header->magic != MAGIC || header->version != VERSION || header->capacity < MIN_CAPACITY || (header->capacity & (header->capacity - 1)) != 0 || size < getSize(header->capacity)) {
+				munmap(header, size);
+				throw make_exception("Shared memory object '", this->name, "' isn't a compatible ckconv ring!");
+			}
+		}
+		~Mapping()
+		{
+			if (header != nullptr)
+				munmap(header, size);
+			if (owner)
+				shm_unlink(name.c_str());
+		}
+		Mapping(Mapping const&) = delete;
+		Mapping& operator=(Mapping const&) = delete;
+
+		Header* operator->() const noexcept { return header; }
+		Header& operator*() const noexcept { return *header; }
+	};
+
+	/**
+	 * @class	Client
+	 * @brief	Posts conversion requests to a running ckconv server. Instances may be used from any number of threads & processes at once.
+	 */
+	class Client {
+		Mapping ring;
+
+	public:
+		using ticket_t = uint32_t;
+
+		Client(std::string const& name) : ring{ name, false } {}
+
+		/**
+		 * @brief			Posts a conversion request to the ring.
+		 * @param inUnit	Input unit ID, from conv::getUnitID().
+		 * @param value		Input value.
+		 * @param outUnit	Output unit ID, from conv::getUnitID().
+		 * @returns			A ticket that must be passed to wait() to receive the result & release the slot.
+		 */
+		ticket_t post(const conv::unit_id_t inUnit, const double value, const conv::unit_id_t outUnit) noexcept
+		{
+			const ticket_t ticket{ ring->head.fetch_add(1) };
+			auto& slot{ ring->slot(ticket) };
+			// wait until the previous lap's client has released this slot
+			await(slot.seq, ticket, slot.waiting);
+			slot.inUnit = inUnit;
+			slot.value = value;
+			slot.outUnit = outUnit;
+			slot.seq.store(ticket + 1);
+			if (ring->serverWaiting.load() != 0)
+				wake(slot.seq);
+			return ticket;
+		}
+		/**
+		 * @brief			Waits for the result of a request & releases its slot.
+		 * @param ticket	A ticket returned by post().
+		 * @param status	Receives the status of the request.
+		 * @returns			The converted value. This is only meaningful when status is Status::OK.
+		 */
+		double wait(const ticket_t ticket, Status& status) noexcept
+		{
+			auto& slot{ ring->slot(ticket) };
+			await(slot.seq, ticket + 2, slot.waiting);
+			const double result{ slot.result };
+			status = slot.status;
+			slot.seq.store(ticket + ring->capacity);
+			if (slot.waiting.load() != 0)
+				wake(slot.seq);
+			return result;
+		}
+		/// @brief	Posts a request & waits for its result. Throws if the server couldn't convert it.
+		double convert(const conv::unit_id_t inUnit, const double value, const conv::unit_id_t outUnit)
+		{
+			Status status;
+			const double result{ wait(post(inUnit, value, outUnit), status) };
+			if (status != Status::OK)
+				throw make_exception("Conversion request failed with status code ", static_cast<int32_t>(status), '!');
+			return result;
+		}
+
+		/// @brief	Asks the server to exit.
+		void shutdown() noexcept
+		{
+			ring->shutdown.store(1);
+			auto& slot{ ring->slot(ring->tail.load()) };
+			wake(slot.seq);
+		}
+	};
+
+	/**
+	 * @brief			Creates a ring & answers requests until a client calls Client::shutdown().
+	 * @param name		The name of the shared memory object to create.
+	 * @param capacity	The number of slots in the ring. Must be a power of two, and at least MIN_CAPACITY.
+	 */
+	inline void runServer(std::string const& name, const uint32_t capacity = DEFAULT_CAPACITY)
+	{
+		Mapping ring{ name, true, capacity };
+		// resolving a unit ID allocates, so only do it once per distinct unit
+		std::unordered_map<conv::unit_id_t, std::optional<conv::Unit>> units;
+		const auto& resolve{ [&units](const conv::unit_id_t id) -> std::optional<conv::Unit> const& {
+			if (const auto& it{ units.find(id) }; it != units.end())
+				return it->second;
+			std::optional<conv::Unit> unit;
+			try {
+				unit = conv::getUnitByID(id);
+			} catch (const std::exception&) {}
+			return units.emplace(id, std::move(unit)).first->second;
+		} };
+
+		$alloc_stage(CONVERT);
+		for (uint32_t ticket{ ring->tail.load() }; ; ring->tail.store(++ticket)) {
+			auto& slot{ ring->slot(ticket) };
+			if (!await(slot.seq, ticket + 1, ring->serverWaiting, &ring->shutdown))
+				break;
+			$alloc_count_line();
+
+			const auto& in{ resolve(slot.inUnit) };
+			const auto& out{ resolve(slot.outUnit) };
+			if (!in.has_value() || !out.has_value())
+				slot.status = Status::INVALID_UNIT;
+			else {
+				try {
+					slot.result = static_cast<double>(conv::convert(in.value(), static_cast<long double>(slot.value), out.value()));
+					slot.status = Status::OK;
+				} catch (const std::exception&) {
+					slot.status = Status::CONVERSION_FAILED;
+				}
+			}
+
+			slot.seq.store(ticket + 2);
+			if (slot.waiting.load() != 0)
+				wake(slot.seq);
+		}
+	}
+}
+#endif // !OS_WIN
@@ -0,0 +1,478 @@
+#pragma once
+/**
+ * @file	TableFile.hpp
+ * @author	radj307
+ * @brief	Exports the unit metadata & conversion factor matrix for every known unit, either as a C++ header or as a versioned binary file that can be memory-mapped.
+ * @details	The binary format is little-endian and made up of these sections, each aligned to 8 bytes:
+ *\n		  FileHeader
+ *\n		  UnitRecord[unitCount]
+ *\n		  double[unitCount * unitCount]	The factor matrix in row-major order, where `value_in_unit_j = value_in_unit_i * matrix[i * unitCount + j]`
+ *\n		  char[stringsSize]				Null-terminated strings referenced by the unit records.
+ */
+#include "conv.hpp"
+
+#include <sysarch.h>
+#include <make_exception.hpp>
+#include <str.hpp>
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef OS_WIN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ckconv::table {
+	static_assert(std::endian::native == std::endian::little, "The binary table format is only supported on little-endian platforms!");
+
+	/// @brief	Identifies a binary table file; "CKUT" in little-endian.
+	inline constexpr uint32_t MAGIC{ 0x54554B43 };
+	/// @brief	Incremented whenever the binary table format changes.
+	inline constexpr uint32_t VERSION{ 3 };
+
+	/**
+	 * @struct	FileHeader
+	 * @brief	Located at the beginning of a binary table file.
+	 */
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t unitCount;
+		uint32_t reserved;
+		uint64_t unitsOffset;
+		uint64_t matrixOffset;
+		uint64_t stringsOffset;
+		uint64_t stringsSize;
+		/// @brief	Identifies the source that this table was compiled from *(ex. the INI config)*, or 0.
+		uint64_t sourceStamp;
+	};
+	static_assert(sizeof(FileHeader) == 56);
+
+	/**
+	 * @struct	UnitRecord
+	 * @brief	Describes one unit. String fields are offsets into the strings section.
+	 */
+	struct UnitRecord {
+		/// @brief	The unit's ID, from conv::getUnitID(). Units that don't have an ID use 0xFFFFFFFF.
+		uint32_t id;
+		/// @brief	The unit's conv::SystemID.
+		uint8_t system;
+		/// @brief	The unit's conv::SIPrefix exponent.
+		int8_t prefix;
+		uint16_t reserved;
+		/// @brief	The factor that converts this unit to the base unit of its system.
+		double factor;
+		/// @brief	The difference between the factor & its conv::number_t value, which is 0 when number_t is a double.
+		double factorRemainder;
+		uint32_t symbol;
+		uint32_t name;
+		uint32_t plural;
+		/// @brief	Comma-separated list of extra names.
+		uint32_t aliases;
+		/// @brief	The name of the system that the unit is listed under. This differs from the SystemID for user-defined units.
+		uint32_t group;
+		/// @brief	A combination of UnitFlags.
+		uint32_t flags;
+	};
+	static_assert(sizeof(UnitRecord) == 48);
+
+	/// @brief	Flags that describe how a UnitRecord relates to the system that it is listed under.
+	enum UnitFlags : uint32_t {
+		NONE = 0,
+		/// @brief	This is the base unit of its group.
+		BASE_UNIT = 1,
+		/// @brief	The group accepts SI prefixes.
+		PREFIXABLE = 2,
+	};
+
+	/**
+	 * @struct	ExportedUnit
+	 * @brief	A unit, and the system that it is listed under.
+	 */
+	struct ExportedUnit {
+		const conv::System* system;
+		conv::Unit unit;
+	};
+
+	/**
+	 * @brief			Gets all of the units in the given systems, including prefixed units.
+	 * @param systems	The systems to include.
+	 * @returns			std::vector<ExportedUnit>, in the same order as the given systems and then ascending size.
+	 */
+	inline std::vector<ExportedUnit> getExportedUnits(std::vector<const conv::System*> const& systems)
+	{
+		std::vector<ExportedUnit> vec;
+		for (const auto* system : systems)
+			for (auto&& unit : system->expand())
+				vec.emplace_back(ExportedUnit{ system, std::move(unit) });
+		return vec;
+	}
+	/// @brief	Gets all of the units that are exported, in order of SystemID and then ascending size, followed by user-defined units.
+	inline std::vector<ExportedUnit> getExportedUnits()
+	{
+		std::vector<const conv::System*> systems{ &conv::Metric, &conv::Imperial, &conv::CreationKit, &conv::Havok, &conv::Unreal, &conv::Unity };
+		for (const auto& system : conv::UserSystems)
+			systems.emplace_back(system.get());
+		return getExportedUnits(systems);
+	}
+
+	/// @brief	Builds the factor matrix for the given units in row-major order.
+	inline std::vector<double> getFactorMatrix(std::vector<ExportedUnit> const& units)
+	{
+		std::vector<double> matrix;
+		matrix.reserve(units.size() * units.size());
+		for (const auto& in : units)
+			for (const auto& out : units)
+				matrix.emplace_back(static_cast<double>(conv::getConversionFactor(in.unit, out.unit)));
+		return matrix;
+	}
+
+	/// @brief	Gets the name of the C++ identifier used for the given unit. *(ex. "NauticalMile" => "NAUTICAL_MILE")*
+	inline std::string getIdentifier(conv::Unit const& unit)
+	{
+		const auto& name{ unit.GetPrintableName(true, false) };
+		std::string id;
+		id.reserve(name.size() + 4);
+		for (size_t i{ 0 }; i < name.size(); ++i) {
+			const char c{ name[i] };
+			if (std::isupper(static_cast<unsigned char>(c)) && i > 0 && std::islower(static_cast<unsigned char>(name[i - 1])))
+				id += '_';
+			id += (std::isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(std::toupper(static_cast<unsigned char>(c))) : '_');
+		}
+		return id;
+	}
+
+	/// @brief	Joins the extra names of a unit with commas.
+	inline std::string getAliases(conv::Unit const& unit)
+	{
+		std::string aliases;
+		for (const auto& name : unit.GetExtraNames()) {
+			if (!aliases.empty()) aliases += ',';
+			aliases += name;
+		}
+		return aliases;
+	}
+
+	/// @brief	Escapes a string for use in a C++ string literal.
+	inline std::string escape(std::string_view const& s)
+	{
+		std::string out;
+		out.reserve(s.size());
+		for (const char c : s) {
+			if (c == '\"' || c == '\\')
+				out += '\\';
+			out += c;
+		}
+		return out;
+	}
+
+	/**
+	 * @brief			Writes a self-contained C++ header that defines the unit metadata & factor matrix as constexpr arrays.
+	 * @param os		Output stream.
+	 * @param version	Version string written to the header comment.
+	 */
+	inline void writeHeader(std::ostream& os, std::string const& version)
+	{
+		const auto& units{ getExportedUnits() };
+		const auto& matrix{ getFactorMatrix(units) };
+		const size_t count{ units.size() };
+
+		os
+			<< "#pragma once\n"
+			<< "/**\n"
+			<< " * @file\tckconv_table.hpp\n"
+			<< " * @brief\tUnit metadata & conversion factors generated by ckconv v" << version << ". Do not edit this file; regenerate it with `ckconv --export-table header`.\n"
+			<< " */\n"
+			<< "#include <cstddef>\n"
+			<< '\n'
+			<< "namespace ckconv_table {\n"
+			<< "\tinline constexpr unsigned VERSION{ " << VERSION << " };\n"
+			<< '\n'
+			<< "\tenum class System : unsigned char {\n"
+			<< "\t\tMETRIC = " << static_cast<int>(conv::SystemID::METRIC) << ",\n"
+			<< "\t\tIMPERIAL = " << static_cast<int>(conv::SystemID::IMPERIAL) << ",\n"
+			<< "\t\tCREATIONKIT = " << static_cast<int>(conv::SystemID::CREATIONKIT) << ",\n"
+			<< "\t\tHAVOK = " << static_cast<int>(conv::SystemID::HAVOK) << ",\n"
+			<< "\t\tUNREAL = " << static_cast<int>(conv::SystemID::UNREAL) << ",\n"
+			<< "\t\tUNITY = " << static_cast<int>(conv::SystemID::UNITY) << ",\n"
+			<< "\t};\n"
+			<< '\n'
+			<< "\tstruct UnitInfo {\n"
+			<< "\t\tunsigned id;\n"
+			<< "\t\tSystem system;\n"
+			<< "\t\tsigned char prefix;\n"
+			<< "\t\tconst char* symbol;\n"
+			<< "\t\tconst char* name;\n"
+			<< "\t\tconst char* plural;\n"
+			<< "\t\t/// @brief\tThe factor that converts this unit to the base unit of its system.\n"
+			<< "\t\tdouble factor;\n"
+			<< "\t};\n"
+			<< '\n'
+			<< "\tinline constexpr std::size_t UNIT_COUNT{ " << count << " };\n"
+			<< '\n'
+			<< "\t/// @brief\tIndices into UNITS & FACTORS.\n"
+			<< "\tnamespace unit {\n";
+		for (size_t i{ 0 }; i < count; ++i)
+			os << "\t\tinline constexpr std::size_t " << getIdentifier(units[i].unit) << "{ " << i << " };\n";
+		os
+			<< "\t}\n"
+			<< '\n'
+			<< std::setprecision(std::numeric_limits<double>::max_digits10)
+			<< "\tinline constexpr UnitInfo UNITS[UNIT_COUNT]{\n";
+		for (const auto& [system, unit] : units) {
+			os
+				<< "\t\tUnitInfo{ " << conv::getUnitID(unit).value_or(0xFFFFFFFF) << "u, "
+				<< "System(" << static_cast<int>(unit.GetSystemID()) << "), "
+				<< static_cast<int>(unit.GetPrefix()) << ", "
+				<< '\"' << escape(unit.GetSymbol()) << "\", "
+				<< '\"' << escape(unit.GetFullName(false)) << "\", "
+				<< '\"' << escape(unit.HasFullName() ? unit.GetFullName(true) : ""s) << "\", "
+				<< static_cast<double>(unit.GetConversionFactor()) << " },\n";
+		}
+		os
+			<< "\t};\n"
+			<< '\n'
+			<< "\t/// @brief\tFACTORS[from][to] converts a value in UNITS[from] to UNITS[to].\n"
+			<< "\tinline constexpr double FACTORS[UNIT_COUNT][UNIT_COUNT]{\n";
+		for (size_t i{ 0 }; i < count; ++i) {
+			os << "\t\t{ ";
+			for (size_t j{ 0 }; j < count; ++j)
+				os << (j == 0 ? "" : ", ") << matrix[i * count + j];
+			os << " },\n";
+		}
+		os
+			<< "\t};\n"
+			<< '\n'
+			<< "\t/// @brief\tConverts a value from one unit to another. When both indices are constant expressions, this folds into a single multiplication.\n"
+			<< "\tconstexpr double convert(const double value, const std::size_t from, const std::size_t to) noexcept { return value * FACTORS[from][to]; }\n"
+			<< "}\n";
+	}
+
+	/// @brief	Rounds the given offset up to the next multiple of 8.
+	inline constexpr uint64_t align8(const uint64_t offset) noexcept { return (offset + 7ull) & ~7ull; }
+
+	/// @brief	Gets the UnitFlags for the given unit.
+	inline uint32_t getFlags(const conv::System* system, conv::Unit const& unit)
+	{
+		uint32_t flags{ NONE };
+		if (system->base != nullptr && system->base->GetSymbol() == unit.GetSymbol() && system->base->GetFullName() == unit.GetFullName())
+			flags |= BASE_UNIT;
+		if (system->siPrefixable)
+			flags |= PREFIXABLE;
+		return flags;
+	}
+
+	/**
+	 * @brief				Serializes the given units & their factor matrix into the binary table format.
+	 * @param units			The units to include.
+	 * @param sourceStamp	Identifies the source that the units were compiled from, or 0.
+	 * @returns				std::vector<char>
+	 */
+	inline std::vector<char> serialize(std::vector<ExportedUnit> const& units, const uint64_t sourceStamp = 0)
+	{
+		std::string strings{ '\0' }; //< offset 0 is always an empty string
+		const auto& addString{ [&strings](std::string const& s) -> uint32_t {
+			if (s.empty()) return 0;
+			const auto offset{ static_cast<uint32_t>(strings.size()) };
+			strings += s;
+			strings += '\0';
+			return offset;
+		} };
+
+		std::vector<UnitRecord> records;
+		records.reserve(units.size());
+		for (const auto& [system, unit] : units) {
+			// the remainder is exact, so the sum of both parts is the same number_t as the unit's factor
+			const conv::number_t factor{ unit.GetConversionFactor() };
+			const double high{ static_cast<double>(factor) };
+			records.emplace_back(UnitRecord{
+				conv::getUnitID(unit).value_or(0xFFFFFFFF),
+				static_cast<uint8_t>(unit.GetSystemID()),
+				static_cast<int8_t>(unit.GetPrefix()),
+				0,
+				high,
+				static_cast<double>(factor - static_cast<conv::number_t>(high)),
+				addString(unit.GetSymbol()),
+				addString(unit.GetFullName(false)),
+				addString(unit.HasFullName() ? unit.GetFullName(true) : ""s),
+				addString(getAliases(unit)),
+				addString(system->name),
+				getFlags(system, unit),
+			});
+		}
+		const auto& matrix{ getFactorMatrix(units) };
+
+		const uint64_t unitsOffset{ align8(sizeof(FileHeader)) };
+		const uint64_t matrixOffset{ align8(unitsOffset + records.size() * sizeof(UnitRecord)) };
+		const FileHeader header{
+			.magic = MAGIC,
+			.version = VERSION,
+			.unitCount = static_cast<uint32_t>(units.size()),
+			.reserved = 0,
+			.unitsOffset = unitsOffset,
+			.matrixOffset = matrixOffset,
+			.stringsOffset = align8(matrixOffset + matrix.size() * sizeof(double)),
+			.stringsSize = strings.size(),
+			.sourceStamp = sourceStamp,
+		};
+
+		std::vector<char> buffer(header.stringsOffset + header.stringsSize, '\0');
+		std::memcpy(buffer.data(), &header, sizeof(FileHeader));
+		std::memcpy(buffer.data() + header.unitsOffset, records.data(), records.size() * sizeof(UnitRecord));
+		std::memcpy(buffer.data() + header.matrixOffset, matrix.data(), matrix.size() * sizeof(double));
+		std::memcpy(buffer.data() + header.stringsOffset, strings.data(), strings.size());
+		return buffer;
+	}
+
+	/**
+	 * @brief		Writes the binary table for every exported unit to the given stream.
+	 * @param os	Output stream. This should be opened in binary mode.
+	 */
+	inline void writeBinary(std::ostream& os)
+	{
+		const auto& buffer{ serialize(getExportedUnits()) };
+		os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		os.flush();
+	}
+
+	/**
+	 * @class	TableView
+	 * @brief	Read-only, zero-copy view of a binary table that is already in memory *(ex. a MappedFile)*.
+	 */
+	class TableView {
+		std::span<const char> data;
+		const FileHeader* header{ nullptr };
+
+	public:
+		/// @brief	Validates the header & section bounds of the given binary table. Throws if it isn't valid.
+		TableView(std::span<const char> const& data) : data{ data }
+		{
+			if (data.size() < sizeof(FileHeader))
+				throw make_exception("Binary unit table is too small!");
+			header = reinterpret_cast<const FileHeader*>(data.data());
+			if (header->magic != MAGIC)
+				throw make_exception("Binary unit table has an invalid header!");
+			if (header->version != VERSION)
+				throw make_exception("Binary unit table version ", header->version, " isn't supported! (Expected ", VERSION, ')');
+
+			// the offsets & sizes come from the file, so they're checked without adding them in case they overflow
+			const auto& contains{ [size = static_cast<uint64_t>(data.size())](const uint64_t offset, const uint64_t count, const uint64_t elementSize) {
+				return offset <= size && count <= (size - offset) / elementSize;
+			} };
+			const uint64_t count{ header->unitCount };
+			if (!contains(header->unitsOffset, count, sizeof(UnitRecord))
+				|| !contains(header->matrixOffset, count * count, sizeof(double))
+				|| !contains(header->stringsOffset, header->stringsSize, 1)
+				|| header->stringsSize == 0 || data[header->stringsOffset + header->stringsSize - 1] != '\0')
+				throw make_exception("Binary unit table is truncated or corrupt!");
+		}
+
+		size_t size() const noexcept { return header->unitCount; }
+		uint64_t sourceStamp() const noexcept { return header->sourceStamp; }
+
+		UnitRecord const& unit(const size_t index) const noexcept { return reinterpret_cast<const UnitRecord*>(data.data() + header->unitsOffset)[index]; }
+		double factor(const size_t from, const size_t to) const noexcept { return reinterpret_cast<const double*>(data.data() + header->matrixOffset)[from * header->unitCount + to]; }
+		/// @brief	Gets a string from the strings section, given its offset.
+		std::string_view string(const uint32_t offset) const noexcept
+		{
+			if (offset >= header->stringsSize) return {};
+			return { data.data() + header->stringsOffset + offset };
+		}
+
+		/// @brief	Converts the given record back into a unit.
+		conv::Unit toUnit(UnitRecord const& record) const
+		{
+			const auto& plural{ string(record.plural) }, name{ string(record.name) };
+			conv::Unit unit{ static_cast<conv::SystemID>(record.system), static_cast<conv::number_t>(record.factor) + static_cast<conv::number_t>(record.factorRemainder), std::string{ string(record.symbol) }, std::string{ name }, std::string{ plural }, true };
+			for (const auto& alias : str::split_all(std::string{ string(record.aliases) }, ","))
+				if (!alias.empty()) unit.AddExtraName(alias);
+			return unit;
+		}
+	};
+
+	/**
+	 * @class	MappedFile
+	 * @brief	RAII wrapper for a read-only memory-mapped file.
+	 */
+	class MappedFile {
+		const char* addr{ nullptr };
+		size_t length{ 0 };
+	#ifdef OS_WIN
+		HANDLE file{ INVALID_HANDLE_VALUE };
+		HANDLE mapping{ nullptr };
+	#endif
+
+	public:
+		MappedFile(std::filesystem::path const& path)
+		{
+		#ifdef OS_WIN
+			file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				throw make_exception("Failed to open '", path.generic_string(), "'!");
+			LARGE_INTEGER fileSize{};
+			GetFileSizeEx(file, &fileSize);
+			length = static_cast<size_t>(fileSize.QuadPart);
+			if (length == 0) return;
+			mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping == nullptr || (addr = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0))) == nullptr) {
+				release();
+				throw make_exception("Failed to map '", path.generic_string(), "'!");
+			}
+		#else
+			const int fd{ open(path.c_str(), O_RDONLY) };
+			if (fd == -1)
+				throw make_exception("Failed to open '", path.generic_string(), "'!");
+			struct stat st {};
+			if (fstat(fd, &st) == -1) {
+				close(fd);
+				throw make_exception("Failed to get the size of '", path.generic_string(), "'!");
+			}
+			length = static_cast<size_t>(st.st_size);
+			if (length != 0) {
+				void* p{ mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0) };
+				if (p == MAP_FAILED) {
+					close(fd);
+					throw make_exception("Failed to map '", path.generic_string(), "'!");
+				}
+				addr = static_cast<const char*>(p);
+			}
+			close(fd);
+		#endif
+		}
+		~MappedFile() { release(); }
+		MappedFile(MappedFile const&) = delete;
+		MappedFile& operator=(MappedFile const&) = delete;
+
+		std::span<const char> span() const noexcept { return { addr, length }; }
+
+	private:
+		void release() noexcept
+		{
+		#ifdef OS_WIN
+			if (addr != nullptr) UnmapViewOfFile(addr);
+			if (mapping != nullptr) CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+			addr = nullptr;
+			mapping = nullptr;
+			file = INVALID_HANDLE_VALUE;
+		#else
+			if (addr != nullptr) munmap(const_cast<char*>(addr), length);
+			addr = nullptr;
+		#endif
+		}
+	};
+}
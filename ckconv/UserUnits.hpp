@@ -0,0 +1,332 @@
+#pragma once
+/**
+ * @file	UserUnits.hpp
+ * @author	radj307
+ * @brief	Loads user-defined units & measurement systems from the INI config, and caches the compiled units on disk.
+ *\n
+ *\n		Systems are defined in sections named "[system.<NAME>]", and units are defined in sections named "[unit.<KEY>]".
+ *\n		Both accept the keys "symbol", "name", "plural", "aliases", "relative-to", & "factor".
+ *\n		 - "relative-to" is the symbol or name of an existing unit, & "factor" is the number of those units in 1 of this unit.
+ *\n		 - Systems also accept "prefixable" *(true/false, yes/no, on/off, or 1/0)*, which enables SI prefixes for all of the units in the system.
+ *\n		 - Units also accept "system", which is the name of the system to list the unit under. *(Default: "Custom")*
+ *\n		   When "relative-to" is omitted, it defaults to the base unit of that system.
+ *\n		Units may be relative to units from other sections, regardless of the order that the sections appear in.
+ *\n		Example:
+ *\n		  [system.Navmesh]
+ *\n		  symbol = cell
+ *\n		  name = Cell
+ *\n		  relative-to = u
+ *\n		  factor = 4096
+ *\n		  [unit.grid]
+ *\n		  name = Grid Square
+ *\n		  system = Navmesh
+ *\n		  factor = 0.25
+ */
+#include "conv.hpp"
+#include "TableFile.hpp"
+
+#include <make_exception.hpp>
+#include <simpleINI.hpp>
+#include <str.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ckconv {
+	/// @brief	Characters that are trimmed from each of the aliases in a unit's "aliases" list.
+	inline const std::string WHITESPACE{ " \t\v\r\n" };
+
+	/**
+	 * @struct	UnitSection
+	 * @brief	The keys from a single "[system.<NAME>]" or "[unit.<KEY>]" section of the INI config.
+	 */
+	struct UnitSection {
+		std::string header;
+		std::string key;
+		std::map<std::string, std::string> values;
+
+		std::optional<std::string> get(std::string const& name) const
+		{
+			if (const auto& it{ values.find(name) }; it != values.end() && !it->second.empty())
+				return it->second;
+			return std::nullopt;
+		}
+		/// @brief	Gets a boolean value. Accepts true/yes/on/1 & false/no/off/0 in any case, and throws for anything else.
+		bool getBool(std::string const& name, const bool defaultValue) const
+		{
+			const auto& value{ get(name) };
+			if (!value.has_value())
+				return defaultValue;
+			const auto& s{ str::tolower(value.value()) };
+			if (s == "true" || s == "yes" || s == "on" || s == "1")
+				return true;
+			if (s == "false" || s == "no" || s == "off" || s == "0")
+				return false;
+			throw make_exception("INI section [", header, '.', key, "] has an invalid value '", value.value(), "' for '", name, "'; expected true or false!");
+		}
+	};
+
+	/**
+	 * @brief		Gets the unit & system sections from the INI config, which was already read by the INI parser.
+	 * @param cfg	The INI config.
+	 * @returns		std::vector<UnitSection>
+	 */
+	inline std::vector<UnitSection> readUnitSections(ini::INI const& cfg)
+	{
+		std::vector<UnitSection> sections;
+		for (const auto& [header, keys] : cfg) {
+			const auto dot{ header.find('.') };
+			if (dot == std::string::npos)
+				continue;
+			if (const auto& type{ str::tolower(header.substr(0, dot)) }; type == "system" || type == "unit") {
+				auto& section{ sections.emplace_back(UnitSection{ type, header.substr(dot + 1), {} }) };
+				for (const auto& [key, value] : keys)
+					section.values.insert_or_assign(key, std::string{ value });
+			}
+		}
+		return sections;
+	}
+
+	/**
+	 * @class	UserUnitLoader
+	 * @brief	Compiles the unit & system sections of the INI config into conv::CustomSystem instances.
+	 */
+	class UserUnitLoader {
+		struct PendingSystem {
+			std::string name;
+			std::vector<conv::Unit> units;
+			bool hasBaseUnit{ false };
+			bool siPrefixable{ false };
+		};
+		std::vector<PendingSystem> systems;
+
+		PendingSystem& getSystem(std::string const& name)
+		{
+			for (auto& system : systems)
+				if (str::tolower(system.name) == str::tolower(name))
+					return system;
+			return systems.emplace_back(PendingSystem{ name, {} });
+		}
+
+		/// @brief	Finds a built-in unit, or a user-defined unit that was already added.
+		std::optional<conv::Unit> findUnit(std::string const& s) const
+		{
+			for (const auto& system : systems) {
+				const conv::System view{ "", std::vector<conv::Unit>{ system.units }, system.siPrefixable };
+				if (const auto& unit{ view.resolve(s) }; unit.has_value())
+					return unit.value();
+			}
+			try {
+				return conv::getUnit(s);
+			} catch (conv::invalid_unit_exception const&) {}
+			return std::nullopt;
+		}
+
+		/// @brief	Creates a unit from the keys in the given section.
+		conv::Unit makeUnit(UnitSection const& section, conv::Unit const& relativeTo, std::string const& defaultSymbol) const
+		{
+			conv::number_t factor{ 1.0L };
+			if (const auto& value{ section.get("factor") }; value.has_value()) {
+				try {
+					factor = str::stold(value.value());
+				} catch (...) {
+					throw make_exception("INI section [", section.header, '.', section.key, "] has an invalid factor '", value.value(), "'!");
+				}
+			}
+			if (!(factor > 0.0L))
+				throw make_exception("INI section [", section.header, '.', section.key, "] has a factor that isn't greater than zero!");
+
+			const auto& name{ section.get("name").value_or("") };
+			const auto& plural{ section.get("plural") };
+			conv::Unit unit{ relativeTo.GetSystemID(), relativeTo.GetConversionFactor() * factor, section.get("symbol").value_or(defaultSymbol), name, plural.value_or(name.empty() ? "" : name + 's'), true };
+			for (const auto& alias : str::split_all(section.get("aliases").value_or(""), ","))
+				if (const auto& trimmed{ str::trim(alias, WHITESPACE) }; !trimmed.empty())
+					unit.AddExtraName(trimmed);
+			return unit;
+		}
+
+		/**
+		 * @brief			Adds the unit that is defined by the given section.
+		 * @param section	A system or unit section.
+		 * @param required	When true, a unit that can't be added yet is an error; otherwise, it is added by a later pass.
+		 * @returns			true when the section was added; false when the unit that it is relative to hasn't been added yet.
+		 */
+		bool add(UnitSection const& section, const bool required)
+		{
+			if (section.header == "system") {
+				auto& system{ getSystem(section.key) };
+				system.siPrefixable = section.getBool("prefixable", false);
+				if (!section.get("symbol").has_value() && !section.get("name").has_value())
+					return true; // systems aren't required to have a base unit
+				const auto& relativeTo{ section.get("relative-to") };
+				if (!relativeTo.has_value())
+					throw make_exception("INI section [system.", section.key, "] defines a base unit without a 'relative-to' key!");
+				const auto& relativeUnit{ findUnit(relativeTo.value()) };
+				if (!relativeUnit.has_value()) {
+					if (required)
+						throw make_exception("INI section [system.", section.key, "] is relative to unknown unit '", relativeTo.value(), "'!");
+					return false;
+				}
+				system.units.insert(system.units.begin(), makeUnit(section, relativeUnit.value(), ""));
+				system.hasBaseUnit = true;
+			}
+			else {
+				const auto& systemName{ section.get("system").value_or("Custom") };
+				const auto& relativeTo{ section.get("relative-to") };
+				std::optional<conv::Unit> relativeUnit;
+				if (relativeTo.has_value()) {
+					relativeUnit = findUnit(relativeTo.value());
+					if (!relativeUnit.has_value() && required)
+						throw make_exception("INI section [unit.", section.key, "] is relative to unknown unit '", relativeTo.value(), "'!");
+				}
+				else if (const auto& system{ getSystem(systemName) }; system.hasBaseUnit)
+					relativeUnit = system.units.front();
+				else if (required)
+					throw make_exception("INI section [unit.", section.key, "] doesn't have a 'relative-to' key, and system '", systemName, "' doesn't have a base unit!");
+				if (!relativeUnit.has_value())
+					return false;
+				getSystem(systemName).units.emplace_back(makeUnit(section, relativeUnit.value(), section.key));
+			}
+			return true;
+		}
+
+	public:
+		/// @brief	Compiles the given sections. Throws if any of them are invalid.
+		UserUnitLoader(std::vector<UnitSection> const& sections)
+		{
+			// sections are added in passes until every unit that they're relative to exists
+			std::vector<const UnitSection*> pending, remaining;
+			for (const auto& section : sections)
+				pending.emplace_back(&section);
+			while (!pending.empty()) {
+				remaining.clear();
+				for (const auto* section : pending)
+					if (!add(*section, false))
+						remaining.emplace_back(section);
+				// when nothing was added, the first remaining section can never be added; this throws the reason why
+				if (remaining.size() == pending.size())
+					add(*remaining.front(), true);
+				pending.swap(remaining);
+			}
+		}
+
+		/// @brief	Moves the compiled systems into conv::UserSystems.
+		void apply()
+		{
+			for (auto& system : systems)
+				if (!system.units.empty())
+					conv::UserSystems.emplace_back(std::make_unique<conv::CustomSystem>(system.name, std::move(system.units), system.hasBaseUnit, system.siPrefixable));
+			systems.clear();
+		}
+	};
+
+	/**
+	 * @brief		Gets a value that changes whenever the given file is modified.
+	 * @param path	The location of a file that exists.
+	 * @returns		uint64_t
+	 */
+	inline uint64_t getSourceStamp(std::filesystem::path const& path)
+	{
+		// FNV-1a of the file size, modification time, & table version
+		uint64_t hash{ 14695981039346656037ull };
+		for (const uint64_t value : { static_cast<uint64_t>(std::filesystem::file_size(path)), static_cast<uint64_t>(std::filesystem::last_write_time(path).time_since_epoch().count()), static_cast<uint64_t>(table::VERSION) }) {
+			for (int i{ 0 }; i < 8; ++i) {
+				hash ^= (value >> (i * 8)) & 0xFF;
+				hash *= 1099511628211ull;
+			}
+		}
+		return hash == 0 ? 1 : hash;
+	}
+
+	/// @brief	Gets the location of the compiled unit cache for the given INI config.
+	inline std::filesystem::path getUnitCachePath(std::filesystem::path const& iniPath)
+	{
+		return std::filesystem::path{ iniPath }.replace_extension(".units");
+	}
+
+	/**
+	 * @brief			Loads the compiled unit cache into conv::UserSystems.
+	 * @param path		The location of the cache.
+	 * @param stamp		The expected source stamp, from getSourceStamp().
+	 * @returns			true when the cache was loaded; false when it doesn't exist or is stale.
+	 */
+	inline bool loadUnitCache(std::filesystem::path const& path, const uint64_t stamp)
+	{
+		std::error_code ec;
+		if (!std::filesystem::exists(path, ec))
+			return false;
+		try {
+			const table::MappedFile file{ path };
+			const table::TableView view{ file.span() };
+			if (view.sourceStamp() != stamp)
+				return false;
+
+			struct Group {
+				std::string_view name;
+				std::vector<conv::Unit> units;
+				bool hasBaseUnit{ false }, siPrefixable{ false };
+			};
+			std::vector<Group> groups;
+			for (size_t i{ 0 }; i < view.size(); ++i) {
+				const auto& record{ view.unit(i) };
+				const auto& name{ view.string(record.group) };
+				if (groups.empty() || groups.back().name != name)
+					groups.emplace_back(Group{ name, {} });
+				auto& group{ groups.back() };
+				group.hasBaseUnit |= (record.flags & table::BASE_UNIT) != 0;
+				group.siPrefixable |= (record.flags & table::PREFIXABLE) != 0;
+				group.units.emplace_back(view.toUnit(record));
+			}
+			for (auto& group : groups)
+				conv::UserSystems.emplace_back(std::make_unique<conv::CustomSystem>(std::string{ group.name }, std::move(group.units), group.hasBaseUnit, group.siPrefixable));
+			return true;
+		} catch (...) {
+			conv::UserSystems.clear();
+			return false; // a corrupt cache is rebuilt from the INI
+		}
+	}
+
+	/**
+	 * @brief			Writes conv::UserSystems to the compiled unit cache. Failures are ignored, since the cache is only an optimization.
+	 * @param path		The location of the cache.
+	 * @param stamp		The source stamp of the INI config, from getSourceStamp().
+	 */
+	inline void writeUnitCache(std::filesystem::path const& path, const uint64_t stamp) noexcept
+	{
+		try {
+			// prefixed units are resolved at runtime, so only the units that were defined are cached
+			std::vector<table::ExportedUnit> units;
+			for (const auto& system : conv::UserSystems)
+				for (const auto& unit : system->units)
+					units.emplace_back(table::ExportedUnit{ system.get(), unit });
+
+			const auto& buffer{ table::serialize(units, stamp) };
+			if (std::ofstream ofs{ path, std::ios::binary | std::ios::trunc }; ofs.is_open())
+				ofs.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		} catch (...) {}
+	}
+
+	/**
+	 * @brief			Loads the user-defined units & systems from the INI config into conv::UserSystems.
+	 *\n				The compiled units are cached next to the INI, & the cache is memory-mapped instead of re-parsing the INI until the INI changes.
+	 * @param iniPath	The location of the INI config, which must exist.
+	 * @param cfg		The INI config, which was read from iniPath.
+	 */
+	inline void loadUserUnits(std::filesystem::path const& iniPath, ini::INI const& cfg)
+	{
+		const auto& cachePath{ getUnitCachePath(iniPath) };
+		const uint64_t stamp{ getSourceStamp(iniPath) };
+		if (loadUnitCache(cachePath, stamp))
+			return;
+
+		UserUnitLoader loader{ readUnitSections(cfg) };
+		loader.apply();
+		writeUnitCache(cachePath, stamp);
+	}
+}
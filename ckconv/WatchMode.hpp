@@ -0,0 +1,302 @@
+#pragma once
+/**
+ * @file	WatchMode.hpp
+ * @author	radj307
+ * @brief	Keeps an output file up to date with the conversions in an input file, re-converting only the lines that changed.
+ * @details	Each line of the input file is converted independently, and its formatted output is cached by the text of the line.
+ *\n		When the input file changes *(see inotify(7))*, the whole file is read & every line is looked up in the cache again, but only-
+ *\n		 -lines that aren't in the cache are converted, so the number of conversions depends on the size of the edit rather than the-
+ *\n		 -size of the file. Lines that were moved or duplicated reuse their cached output. Lines with errors aren't cached, so their-
+ *\n		 -errors are reported again by every update until they're fixed.
+ *\n		The output file is only written from the first byte that changed, and only up to the last byte that changed when its size is the same.
+ */
+#include "util.h"
+#include "global.h"
+#include "Pipeline.hpp"
+#include "RecordWriter.hpp"
+#include "Arena.hpp"
+#include "AllocStats.hpp"
+
+#include <sysarch.h>
+#include <make_exception.hpp>
+
+#ifdef OS_LINUX
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace ckconv::watch {
+	/// @brief	Returns the 64-bit FNV-1a hash of a line.
+	constexpr uint64_t hashLine(std::string_view const& line) noexcept
+	{
+		uint64_t hash{ 0xcbf29ce484222325ull };
+		for (const char c : line) {
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	/// @brief	Hashes lines with hashLine(). This allows the line cache to be searched with a string_view, without copying the line.
+	struct LineHash {
+		using is_transparent = void;
+		size_t operator()(std::string_view const& line) const noexcept { return static_cast<size_t>(hashLine(line)); }
+	};
+	/// @brief	Maps the text of each line to its formatted output.
+	using LineCache = std::unordered_map<std::string, std::string, LineHash, std::equal_to<>>;
+
+	/**
+	 * @brief		Reads the entire contents of a file.
+	 * @param path	The path of the file to read.
+	 * @returns		The contents of the file, or std::nullopt if it couldn't be opened. Editors that save by replacing the file may-
+	 *\n			 -briefly remove it, so this isn't an error.
+	 */
+	inline std::optional<std::string> readFile(std::filesystem::path const& path)
+	{
+		const int fd{ open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+		if (fd == -1)
+			return std::nullopt;
+
+		std::string contents;
+		char buffer[65536];
+		for (ssize_t count; (count = read(fd, buffer, sizeof(buffer))) != 0; ) {
+			if (count == -1) {
+				if (errno == EINTR)
+					continue;
+				close(fd);
+				throw make_exception("Failed to read input file '", path.generic_string(), "'!");
+			}
+			contents.append(buffer, static_cast<size_t>(count));
+		}
+		close(fd);
+		return contents;
+	}
+
+	/**
+	 * @class	OutputFile
+	 * @brief	An output file that is updated in place with the smallest write that makes its contents match the given string.
+	 */
+	class OutputFile {
+		std::filesystem::path path;
+		int fd;
+		/// @brief	The current contents of the file.
+		std::string contents;
+
+		/// @brief	Writes a range of the contents at the same offset in the file.
+		void write(const size_t begin, const size_t end)
+		{
+			for (size_t pos{ begin }; pos < end; ) {
+				const ssize_t count{ pwrite(fd, contents.data() + pos, end - pos, static_cast<off_t>(pos)) };
+				if (count == -1) {
+					if (errno == EINTR)
+						continue;
+					throw make_exception("Failed to write output file '", path.generic_string(), "'!");
+				}
+				pos += static_cast<size_t>(count);
+			}
+		}
+
+	public:
+		/// @brief	Opens *(or creates)* the output file. Its existing contents are read, so an up-to-date file isn't written at all.
+		OutputFile(std::filesystem::path const& path) : path{ path }, fd{ open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644) }
+		{
+			if (fd == -1)
+				throw make_exception("Failed to open output file '", path.generic_string(), "'!");
+			contents = readFile(path).value_or("");
+		}
+		OutputFile(OutputFile const&) = delete;
+		OutputFile& operator=(OutputFile const&) = delete;
+		~OutputFile() { close(fd); }
+
+		/**
+		 * @brief				Updates the file to match the given contents.
+		 * @param newContents	The new contents of the file.
+		 * @returns				The number of bytes that were written.
+		 */
+		size_t update(std::string newContents)
+		{
+			const size_t common{ std::min(contents.size(), newContents.size()) };
+			const size_t begin{ static_cast<size_t>(std::mismatch(contents.begin(), contents.begin() + common, newContents.begin()).first - contents.begin()) };
+			size_t end{ newContents.size() };
+			// when the size hasn't changed, nothing after the edit has moved
+			if (newContents.size() == contents.size())
+				end -= static_cast<size_t>(std::mismatch(contents.rbegin(), contents.rend() - begin, newContents.rbegin()).first - contents.rbegin());
+
+			const bool shrunk{ newContents.size() < contents.size() };
+			contents = std::move(newContents);
+			write(begin, end);
+			if (shrunk && ftruncate(fd, static_cast<off_t>(contents.size())) == -1)
+				throw make_exception("Failed to resize output file '", path.generic_string(), "'!");
+			return end - begin;
+		}
+	};
+
+	/**
+	 * @class	IncrementalConverter
+	 * @brief	Converts the lines of a file, reusing the output of every line that was already converted by the previous update.
+	 */
+	class IncrementalConverter {
+		std::string name;
+		std::string outputUnits;
+		/// @brief	The formatted output of each distinct line in the previous version of the file that was converted without errors.
+		LineCache cache;
+		/// @brief	Holds the tokens of the line that is being converted.
+		BatchArena arena;
+
+		/**
+		 * @brief			Converts one line. Errors are written to STDERR with the line number, since they don't belong in the output file.
+		 * @param line		The line to convert.
+		 * @param number	The line number, for error messages.
+		 * @param output	The string to append the formatted output of the line to.
+		 * @returns			true when the line was converted without errors, and its output can be cached.
+		 */
+		bool convertLine(std::string_view const& line, const size_t number, std::string& output)
+		{
+			$alloc_count_line();
+			$alloc_stage(CONVERT);
+			bool valid{ true };
+			try {
+				for (auto&& formatted : pipeline::format(pipeline::convert(pipeline::operations(pipeline::expandUnits(splitWhitespace(line, arena.resource()), outputUnits.empty()), outputUnits)), false)) {
+					if (formatted.isError) {
+						std::cerr << global.csync.get_error() << name << ':' << number << ": " << formatted.text;
+						valid = false;
+					}
+					else output += formatted.text;
+				}
+			} catch (const std::exception& ex) {
+				std::cerr << global.csync.get_error() << name << ':' << number << ": " << ex.what() << std::endl;
+				valid = false;
+			}
+			arena.release();
+			return valid;
+		}
+
+	public:
+		/// @brief	The number of lines in the last update, & the number of them that had to be converted.
+		size_t lineCount{ 0ull }, convertedCount{ 0ull };
+
+		/**
+		 * @param name			The name of the input file, which is used in error messages.
+		 * @param outputUnits	The output unit(s) specified by --to, or an empty string.
+		 */
+		IncrementalConverter(std::string name, std::string outputUnits) : name{ std::move(name) }, outputUnits{ std::move(outputUnits) } {}
+
+		/**
+		 * @brief		Converts the new contents of the input file. Every line is looked up, so this is still linear in the size of the-
+		 *\n			 -file, but only the lines that aren't cached are converted.
+		 * @param input	The contents of the input file.
+		 * @returns		The contents of the output file.
+		 */
+		std::string update(std::string_view const& input)
+		{
+			std::string output;
+			if (global.outputFormat != OutputFormat::HUMAN && !global.quiet)
+				RecordWriter{ global.outputFormat }.writeHeader(output);
+
+			LineCache next;
+			lineCount = convertedCount = 0ull;
+			for (size_t pos{ 0ull }; pos < input.size(); ) {
+				size_t eol{ input.find('\n', pos) };
+				if (eol == std::string_view::npos)
+					eol = input.size();
+				std::string_view line{ input.substr(pos, eol - pos) };
+				if (line.ends_with('\r'))
+					line.remove_suffix(1ull);
+				pos = eol + 1ull;
+				++lineCount;
+
+				auto it{ next.find(line) };
+				if (it == next.end()) {
+					if (const auto& prev{ cache.find(line) }; prev != cache.end())
+						it = next.emplace(std::string{ line }, std::move(prev->second)).first;
+					else {
+						std::string lineOutput;
+						++convertedCount;
+						if (!convertLine(line, lineCount, lineOutput)) {
+							// lines with errors are converted again by the next update, so their errors are reported again
+							output += lineOutput;
+							continue;
+						}
+						it = next.emplace(std::string{ line }, std::move(lineOutput)).first;
+					}
+				}
+				output += it->second;
+			}
+			cache = std::move(next);
+			return output;
+		}
+	};
+
+	/**
+	 * @brief				Converts the input file to the output file, then updates the output file whenever the input file changes.
+	 *\n					This doesn't return unless an error occurs.
+	 * @param inputPath		The file to watch.
+	 * @param outputPath	The file to write the conversions to.
+	 * @param outputUnits	The output unit(s) specified by --to, or an empty string.
+	 */
+	inline void run(std::filesystem::path const& inputPath, std::filesystem::path const& outputPath, std::string const& outputUnits)
+	{
+		IncrementalConverter converter{ inputPath.generic_string(), outputUnits };
+		OutputFile output{ outputPath };
+
+		// returns false when the input file doesn't exist
+		const auto& update{ [&]() {
+			const auto& input{ readFile(inputPath) };
+			if (!input.has_value())
+				return false;
+			const size_t written{ output.update(converter.update(input.value())) };
+			if (!global.quiet)
+				std::cerr << "Converted " << converter.convertedCount << " of " << converter.lineCount << " lines; wrote " << written << " bytes." << std::endl;
+			return true;
+		} };
+
+		// editors often save by replacing the file, which would remove a watch on the file itself, so the directory is watched instead
+		const int fd{ inotify_init1(IN_CLOEXEC) };
+		if (fd == -1)
+			throw make_exception("Failed to initialize inotify!");
+		const auto& directory{ inputPath.has_parent_path() ? inputPath.parent_path() : std::filesystem::path{ "." } };
+		const auto& filename{ inputPath.filename().native() };
+		if (inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) == -1) {
+			close(fd);
+			throw make_exception("Failed to watch directory '", directory.generic_string(), "'!");
+		}
+
+		if (!update()) {
+			close(fd);
+			throw make_exception("Failed to open input file '", inputPath.generic_string(), "'!");
+		}
+
+		alignas(inotify_event) char buffer[4096];
+		for (ssize_t count; (count = read(fd, buffer, sizeof(buffer))) != 0; ) {
+			if (count == -1) {
+				if (errno == EINTR)
+					continue;
+				close(fd);
+				throw make_exception("Failed to read inotify events!");
+			}
+			// a single save may produce several events, but they all result in one update
+			bool changed{ false };
+			for (ssize_t pos{ 0 }; pos < count; ) {
+				const auto* event{ reinterpret_cast<const inotify_event*>(buffer + pos) };
+				if (event->len != 0 && filename == event->name)
+					changed = true;
+				pos += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+			}
+			if (changed)
+				update();
+		}
+		close(fd);
+	}
+}
+#endif // OS_LINUX
@@ -1,12 +1,29 @@
 ﻿#include "rc/version.h"
 #include "PrintableMeasurementUnits.hpp"
 #include "util.h"
+#include "SharedMemoryRing.hpp"
+#include "RangeMode.hpp"
+#include "TableFile.hpp"
+#include "Aggregate.hpp"
+#include "AllocStats.hpp"
+#include "OutputTemplate.hpp"
+#include "RecordWriter.hpp"
+#include "Pipeline.hpp"
+#include "WatchMode.hpp"
+#include "Expression.hpp"
+#include "Arena.hpp"
+#include "Plugin.hpp"
 
 #include <opt3.hpp>
 #include <TermAPI.hpp>
 #include <envpath.hpp>
 #include <color-sync.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <span>
+#include <sstream>
+
 #ifdef OS_LINUX
 #undef ENABLE_UPDATE_CHECK
 #endif
@@ -21,9 +38,15 @@ inline static const shared::semver CKCONV_SEMVER{ ckconv_VERSION_EXTENDED };
 #endif
 
 #ifdef ENABLE_CONFIG_FILE
+#include "UserUnits.hpp"
 #include <simpleINI.hpp>
 #endif
 
+#ifdef OS_WIN
+#include <fcntl.h>
+#include <io.h>
+#endif
+
 struct Help {
 	std::string programName;
 	WINCONSTEXPR Help(std::string const& programName) : programName{ programName } {}
@@ -32,12 +55,21 @@ struct Help {
 		os
 			<< "Creation Kit Unit Converter (ckconv) v" << ckconv_VERSION_EXTENDED << '\n'
 			<< "  Converts between Metric, Imperial, and the eponymous 'Unit' used by Bethesda's Gamebryo & Creation Kit engines." << '\n'
+			<< "  Havok ('hk'), Unreal Engine ('UU'), & Unity ('UY') units are supported too, for porting assets between engines." << '\n'
 			<< '\n'
 			<< "USAGE:" << '\n'
-			<< "  " << h.programName << " [OPTIONS] [<UNIT> <VALUE> <OUTPUT_UNIT> ...]\n"
+			<< "  " << h.programName << " [OPTIONS] [<UNIT> <VALUE> <OUTPUT_UNIT> ...] [-- <UNIT> <VALUE> <OUTPUT_UNIT> ...]\n"
 			<< '\n'
 			<< "  The input syntax is flexible and supports multiple forms. For example, these are both valid:" << '\n'
 			<< "   '260meters kilounits' or '<VALUE> <UNIT> <OUTPUT_UNIT>'" << '\n'
+			<< "  Areas & volumes are supported by adding an exponent or a prefix word to a unit, for example:" << '\n'
+			<< "   '12m2 sq ft', '5 u^3 cm3', or '1 cubic meter cu u'" << '\n'
+			<< "  Multiple output units can be specified with a comma-separated list, for example: '100u m,ft,in'" << '\n'
+			<< "  Compound Imperial values are added together, for example: '6\'2\" m' or '5 ft 3 in m'. Compound output units split-" << '\n'
+			<< "   -the result into whole units, for example: '1.8m ft+in' prints '1.8 m = 5 ft 10.8661 in'." << '\n'
+			<< "  With --to, compound values aren't added together, so '--to m 5 ft 3 in' is two separate conversions." << '\n'
+			<< "  Arguments after '--' are never parsed as options, which is faster for very long argument lists." << '\n'
+			<< "  Any argument can be '@<PATH>' to read more arguments from a (response) file, which avoids the argument limit." << '\n'
 			<< '\n'
 			<< "OPTIONS:\n"
 			<< "  -h, --help                Show the help display and exit." << '\n'
@@ -50,6 +82,68 @@ struct Help {
 			<< "                             Optionally accepts the name of a specific measurement system or unit to" << '\n'
 			<< "                             only show units from that system." << '\n'
 			<< "  -w, --where               Prints the location of the `ckconv` executable." << '\n'
+			<< "  -e, --expression          Evaluates arithmetic expressions over mixed units instead of single conversions, for-" << '\n'
+			<< "                             -example: '5ft + 3in + 12u to m'. Units follow numbers or parentheses, & variables-" << '\n'
+			<< "                             -can be defined with 'NAME = <EXPRESSION>', i.e. 'len = 12u; (len * 2) to m'." << '\n'
+			<< "                             Each line of input is one expression; parameters are joined, & split on ';'." << '\n'
+			<< "      --line-mode           Reads newline-terminated requests from STDIN and answers each one immediately." << '\n'
+			<< "                             The process stays alive until STDIN is closed, so it can be used as a coprocess." << '\n'
+			<< "                             Failed conversions print an empty line to STDOUT to keep answers paired." << '\n'
+			<< "      --range <A:B[:STEP]>  Generates a conversion table for every value from A to B (inclusive) in increments-" << '\n'
+			<< "                             -of STEP, instead of reading any input. Requires the --from & --to options." << '\n'
+			<< "      --from <UNIT>         Sets the input unit for the --range option." << '\n'
+			<< "      --to <UNIT[,UNIT...]> Sets the output unit(s) for the --range option. Each unit gets its own column." << '\n'
+			<< "                             Without --range, this sets the output unit(s) of every conversion, and the input-" << '\n'
+			<< "                             -is read as '<UNIT> <VALUE>' pairs instead." << '\n'
+			<< "      --wide                Prints conversions with multiple output units on one row, instead of one row per unit." << '\n'
+			<< "      --format <FMT>        Sets the output format. FMT can be 'human' (default), 'jsonl', 'csv', or 'tsv'." << '\n'
+			<< "                             Structured formats write one record per result with the fields input_value, input_unit," << '\n'
+			<< "                             output_value, output_unit, & error. Failed conversions are written as records too." << '\n'
+			<< "                             In JSON Lines, input_value is always a string & output_value is a number or null." << '\n'
+			<< "                             --range writes one record per value & output unit. --aggregate only supports 'human'." << '\n'
+			<< "  -i, --input <PATH>        Reads input from a file instead of STDIN. gzip & zstd compressed input is detected-" << '\n'
+			<< "                             -automatically, both from files & from STDIN, and decompressed while it is converted." << '\n'
+			<< "      --compress <FMT>      Compresses everything written to STDOUT. FMT can be 'gzip', 'zstd', or 'none'." << '\n'
+			<< "      --aggregate <STATS>   Prints summary statistics of the converted values instead of each conversion." << '\n'
+			<< "                             STATS is a comma-separated list of 'sum', 'min', 'max', 'mean', 'count', & 'hist[:<BINS>]'." << '\n'
+			<< "                             Statistics are calculated separately for each output unit." << '\n'
+			<< "      --export-table <FMT>  Writes the metadata & conversion factor matrix of every unit to STDOUT, then exits." << '\n'
+			<< "                             FMT can be 'header' for a constexpr C++ header, or 'binary' for a versioned binary-" << '\n'
+			<< "                             -file that can be memory-mapped. See TableFile.hpp for the binary layout." << '\n'
+			<< "      --plugin <FILE>       Prints the position of every placed reference in a TES4 plugin file (ESP/ESM/ESL), converted-" << '\n'
+			<< "                             -from --from (default: u) to --to (default: m). When --output is specified, a copy of-" << '\n'
+			<< "                             -the plugin with every position converted is written to <PATH> instead." << '\n'
+			<< "  -o, --output <PATH>       The output file for --plugin & --watch." << '\n'
+			;
+	#ifdef ENABLE_IO_URING
+		os
+			<< "      --no-io-uring         Don't use io_uring for input files & STDOUT. By default, regular files are read & written-" << '\n'
+			<< "                             -asynchronously through io_uring when the kernel supports it." << '\n'
+			;
+	#endif
+	#ifdef ENABLE_ALLOC_STATS
+		os
+			<< "      --alloc-report        Prints the number of heap allocations made by each stage of the conversion pipeline-" << '\n'
+			<< "                             -to STDERR after converting the input." << '\n'
+			<< "      --alloc-budget <#>    Exits with an error when the average number of allocations per converted line is-" << '\n'
+			<< "                             -greater than <#>. This is used to catch allocation regressions in the hot path." << '\n'
+			;
+	#endif
+	#ifndef OS_WIN
+		os
+			<< "      --shm <NAME>          Creates a shared memory ring buffer with the given name, and answers binary conversion-" << '\n'
+			<< "                             -requests posted to it by other processes until one of them requests a shutdown." << '\n'
+			<< "                             See SharedMemoryRing.hpp for the client API & memory layout." << '\n'
+			<< "      --shm-capacity <#>    Sets the number of slots in the shared memory ring. Must be a power of two >= 4." << '\n'
+			;
+	#endif
+	#ifdef OS_LINUX
+		os
+			<< "      --watch <FILE>        Converts each line of <FILE> to the file specified by --output, then keeps the output-" << '\n'
+			<< "                             -up to date whenever <FILE> changes. Only changed lines are converted again." << '\n'
+			;
+	#endif
+		os
 			<< '\n'
 			<< "NOTATION:\n"
 			<< "  -F, --standard, --fixed   Force print numbers in fixed-point (standard) notation." << '\n'
@@ -71,6 +165,11 @@ struct Help {
 			<< "  -s, --set [H:]<K:V>       Changes the value of the specified key in the INI config." << '\n'
 			<< "      --dry                 When writing the INI config, write to STDOUT instead of to disk. This allows-" << '\n'
 			<< "                             -you to observe the changes made by the set option without actually writing them." << '\n'
+			<< '\n'
+			<< "  Custom units can be defined in the INI config using [unit.<KEY>] & [system.<NAME>] sections, with the keys" << '\n'
+			<< "   'symbol', 'name', 'plural', 'aliases', 'relative-to', 'factor', 'system' (units), & 'prefixable' (systems)." << '\n'
+			<< "   Example: '[unit.cell]' 'name = Cell' 'relative-to = u' 'factor = 4096'" << '\n'
+			<< "   The compiled units are cached in a '.units' file next to the INI, which is rebuilt whenever the INI changes." << '\n'
 			;
 	#endif
 	#ifdef ENABLE_UPDATE_CHECK
@@ -86,6 +185,208 @@ struct Help {
 	}
 };
 
+/**
+ * @brief				Converts & prints each of the given operations to STDOUT. Errors are printed to STDERR.
+ * @param userInputs	Operations returned by processInput(), or a lazy range of operations from pipeline::operations().
+ * @param keepPaired	When true, an empty line is printed to STDOUT in place of each failed conversion.
+ * @returns				The number of operations that were processed.
+ */
+template<std::ranges::input_range TRange>
+inline size_t printConversions(TRange&& userInputs, const bool keepPaired = false)
+{
+	using namespace ckconv;
+
+	// the output options don't change after startup, so templates are kept for the lifetime of the process
+	static OutputTemplateCache templates;
+	// compound output units, i.e. "ft+in", are parsed once; the values of their units are reused by every line
+	static compound::CompoundUnitCache compoundUnits;
+	std::vector<conv::number_t> components;
+	// results are buffered & written to STDOUT in large blocks
+	constexpr size_t FLUSH_THRESHOLD{ 1ull << 16 };
+	std::string buffer;
+	buffer.reserve(FLUSH_THRESHOLD + 256ull);
+
+	// --format
+	const bool structured{ global.outputFormat != OutputFormat::HUMAN };
+	const RecordWriter writer{ global.outputFormat };
+	if (static bool wroteHeader{ false }; structured && !wroteHeader && !global.quiet) {
+		writer.writeHeader(buffer);
+		wroteHeader = true;
+	}
+	const auto& write{ [&](conv::Unit const& inUnit, const long double inValue, conv::Unit const& outUnit, const long double outValue) {
+		if (structured)
+			writer.writeResult(buffer, inValue, format_unit(inUnit, true), outValue, format_unit(outUnit, true));
+		else templates.get(inUnit, outUnit).render(buffer, inValue, outValue);
+	} };
+
+	size_t count{ 0 };
+	try {
+		for (auto&& it : userInputs) {
+			++count;
+			try {
+				$alloc_count_line();
+				$alloc_stage(LOOKUP);
+				if (const auto& outUnits{ std::get<2>(it) }; isUnitList(outUnits)) {
+					// one input, many outputs; the input is parsed & converted to its base unit once
+					const auto& inUnit{ conv::getUnit(std::string{ std::get<0>(it) }) };
+					const auto inValue{ str::stold(std::string{ std::get<1>(it) }) };
+					const auto& outs{ getUnitList(outUnits) };
+					$alloc_stage(CONVERT);
+					const auto& outValues{ conv::convert_all(inUnit, inValue, outs) };
+
+					$alloc_stage(FORMAT);
+					if (global.wideRows && !structured) {
+						converted_many row{ inUnit, inValue, {} };
+						row.outputs.reserve(outs.size());
+						for (size_t i{ 0 }; i < outs.size(); ++i)
+							row.outputs.emplace_back(outs[i], outValues[i]);
+						buffer += row.getExpression();
+						buffer += '\n';
+					}
+					else {
+						for (size_t i{ 0 }; i < outs.size(); ++i)
+							write(inUnit, inValue, outs[i], outValues[i]);
+					}
+				}
+				else if (compound::isCompoundUnit(outUnits)) {
+					// one conversion to the smallest unit, which is then split into each unit
+					const auto& inUnit{ conv::getUnit(std::string{ std::get<0>(it) }) };
+					const auto inValue{ str::stold(std::string{ std::get<1>(it) }) };
+					const auto& outUnit{ compoundUnits.get(outUnits) };
+					$alloc_stage(CONVERT);
+					components.resize(outUnit->getUnits().size());
+					outUnit->split(conv::convert(inUnit, inValue, outUnit->smallest()), components, round_fp);
+
+					$alloc_stage(FORMAT);
+					if (structured)
+						writer.writeResult(buffer, inValue, format_unit(inUnit, true), std::span<const conv::number_t>{ components }, format_unit(outUnit->getUnits(), true));
+					else templates.get(inUnit, outUnit->getUnits()).render(buffer, inValue, std::span<const conv::number_t>{ components });
+				}
+				else {
+					const auto& [inUnit, inValue, outUnit] { toConvertible(it) };
+					$alloc_stage(CONVERT);
+					const auto outValue{ conv::convert(inUnit, inValue, outUnit) };
+
+					$alloc_stage(FORMAT);
+					write(inUnit, inValue, outUnit, outValue);
+				}
+			} catch (const std::exception& ex) {
+				$alloc_stage(OUTPUT);
+				if (structured) {
+					// errors are written as records, so every input has exactly one record per output
+					writer.writeError(buffer, std::get<1>(it), std::get<0>(it), std::get<2>(it), ex.what());
+					continue;
+				}
+				// write the preceding results first, so errors are printed in order
+				std::cout << buffer;
+				buffer.clear();
+				std::cout.flush();
+				std::cerr << global.csync.get_error() << ex.what() << std::endl;
+				if (keepPaired) buffer += '\n';
+			}
+
+			if (buffer.size() >= FLUSH_THRESHOLD) {
+				$alloc_stage(OUTPUT);
+				std::cout << buffer;
+				buffer.clear();
+			}
+			// lazy ranges read the next operation when the iterator is incremented
+			$alloc_stage(INPUT);
+		}
+	} catch (...) {
+		// an input error ends the stream; the results before it are still written
+		std::cout << buffer;
+		throw;
+	}
+	$alloc_stage(OUTPUT);
+	std::cout << buffer;
+	return count;
+}
+
+/**
+ * @brief				Answers newline-terminated requests from the input stream until it is closed, flushing STDOUT after each one.
+ * @param is			Input stream. This is usually STDIN.
+ * @param outputUnits	The output unit(s) specified by --to, or an empty string.
+ */
+inline void runLineMode(std::istream& is, std::string const& outputUnits)
+{
+	using namespace ckconv;
+
+	std::ios_base::sync_with_stdio(false);
+
+	// each line is a batch; its tokens & operations are released all at once
+	BatchArena arena;
+	for (std::string line; std::getline(is, line); ) {
+		$alloc_stage(INPUT);
+		try {
+			if (const auto& tokens{ splitWhitespace(line, arena.resource()) }; !tokens.empty())
+				printConversions(processInput(expandUnits(tokens, outputUnits.empty()), outputUnits), true);
+		} catch (const std::exception& ex) {
+			std::cerr << global.csync.get_error() << ex.what() << std::endl;
+			std::cout << '\n';
+		}
+		arena.release();
+		std::cout.flush();
+	}
+}
+
+/**
+ * @brief				Evaluates each line of the input stream as an expression, followed by each ';'-separated expression in the given string.
+ * @param is			Input stream.
+ * @param expressions	Expressions from the commandline.
+ * @returns				The number of expressions that were evaluated successfully.
+ */
+inline size_t printExpressions(std::istream& is, std::string_view const& expressions)
+{
+	using namespace ckconv;
+
+	std::ios_base::sync_with_stdio(false);
+
+	expr::Evaluator evaluator;
+	const RecordWriter writer{ global.outputFormat };
+	const bool structured{ global.outputFormat != OutputFormat::HUMAN };
+
+	// see printConversions()
+	constexpr size_t FLUSH_THRESHOLD{ 1ull << 16 };
+	std::string buffer;
+	buffer.reserve(FLUSH_THRESHOLD + 256ull);
+	if (structured && !global.quiet)
+		writer.writeHeader(buffer);
+
+	size_t count{ 0 };
+	const auto& evaluate{ [&](std::string_view const& expression) {
+		$alloc_count_line();
+		try {
+			evaluator.evaluate(expression, buffer, writer);
+			++count;
+		} catch (const std::exception& ex) {
+			if (structured) {
+				writer.writeError(buffer, expression, {}, {}, ex.what());
+				return;
+			}
+			std::cout << buffer;
+			buffer.clear();
+			std::cout.flush();
+			std::cerr << global.csync.get_error() << ex.what() << std::endl;
+		}
+		if (buffer.size() >= FLUSH_THRESHOLD) {
+			std::cout << buffer;
+			buffer.clear();
+		}
+	} };
+
+	for (std::string line; std::getline(is, line); )
+		evaluate(line);
+	for (size_t pos{ 0ull }; pos < expressions.size(); ) {
+		const size_t end{ std::min(expressions.find(';', pos), expressions.size()) };
+		evaluate(expressions.substr(pos, end - pos));
+		pos = end + 1ull;
+	}
+
+	std::cout << buffer;
+	return count;
+}
+
 #define $argNames_standardNotation 'F', "standard", "fix", "fixed", "fixed-point"
 #define $argNames_scientificNotation 'S', "scientific", "sci"
 #define $argNames_hexNotation 'H', 'X', "hexadecimal", "hex"
@@ -99,7 +400,11 @@ int main(const int argc, char** argv)
 	const auto& [programPath, programName] { pathVar.resolve_split(argv[0]) };
 
 	try {
-		opt3::ArgManager args{ argc, argv,
+		// -- (option parsing stops here, & the remaining arguments are used as-is without being copied)
+		const auto& separator{ std::find_if(argv + 1, argv + argc, [](const char* arg) { return std::strcmp(arg, "--") == 0; }) };
+		const std::span<char* const> trailingArgs{ separator == argv + argc ? separator : separator + 1, argv + argc };
+
+		opt3::ArgManager args{ static_cast<int>(separator - argv), argv,
 			opt3::make_template(opt3::CaptureStyle::Required, 'p', "precision"),
 			opt3::make_template(opt3::CaptureStyle::Required, 'a', "align-to"),
 			opt3::make_template(opt3::CaptureStyle::Optional, 'u', "units", "list-units"),
@@ -110,8 +415,43 @@ int main(const int argc, char** argv)
 			opt3::make_template(opt3::CaptureStyle::Required, 'g', "get").SetConflicts('s', "set"),
 			opt3::make_template(opt3::CaptureStyle::Required, "ini").SetMax(1),
 			opt3::make_template(opt3::CaptureStyle::Optional, "new-ini").SetMax(1),
+			opt3::make_template(opt3::CaptureStyle::Required, "shm").SetMax(1),
+			opt3::make_template(opt3::CaptureStyle::Required, "shm-capacity").SetMax(1),
+		#ifdef OS_LINUX
+			opt3::make_template(opt3::CaptureStyle::Required, "watch").SetMax(1),
+		#endif
+			opt3::make_template(opt3::CaptureStyle::Required, 'o', "output").SetMax(1),
+			opt3::make_template(opt3::CaptureStyle::Required, "plugin").SetMax(1),
+			opt3::make_template(opt3::CaptureStyle::Required, "range").SetMax(1),
+			opt3::make_template(opt3::CaptureStyle::Required, "from").SetMax(1),
+			opt3::make_template(opt3::CaptureStyle::Required, "to").SetMax(1),
+			opt3::make_template(opt3::CaptureStyle::Required, "export-table").SetMax(1),
+			opt3::make_template(opt3::CaptureStyle::Required, "aggregate").SetMax(1),
+			opt3::make_template(opt3::CaptureStyle::Required, "format").SetMax(1),
+			opt3::make_template(opt3::CaptureStyle::Required, 'i', "input").SetMax(1),
+			opt3::make_template(opt3::CaptureStyle::Required, "compress").SetMax(1),
+		#ifdef ENABLE_ALLOC_STATS
+			opt3::make_template(opt3::CaptureStyle::Required, "alloc-budget").SetMax(1),
+		#endif
 		};
 
+		// gets the exit code for the modes that convert values; this is where the allocation report & budget are checked
+		const auto& finish{ [&]() -> int {
+		#ifdef ENABLE_ALLOC_STATS
+			// --alloc-report
+			if (args.check_any<opt3::Option>("alloc-report"))
+				alloc::printReport(std::cerr);
+			// --alloc-budget
+			if (const auto& budget{ args.castgetv<double, opt3::Option>("alloc-budget") }; budget.has_value()) {
+				if (const auto perLine{ alloc::getAllocationsPerLine() }; perLine > budget.value()) {
+					std::cerr << global.csync.get_error() << "Allocation budget exceeded: " << perLine << " allocations per line > " << budget.value() << std::endl;
+					return 1;
+				}
+			}
+		#endif
+			return 0;
+		} };
+
 	#ifdef ENABLE_CONFIG_FILE
 		// --ini | $CKCONV_INI
 		const pathstring cfgPath{ args.castgetv<pathstring, opt3::Option>("ini").value_or(env::getvar("CKCONV_INI").value_or(pathstring{ programPath / std::filesystem::path{ programName }.replace_extension(".ini") })) };
@@ -206,9 +546,28 @@ int main(const int argc, char** argv)
 
 		// -f | --full-name
 		global.useFullNames = args.check_any<opt3::Flag, opt3::Option>('f', "full-name", "full-names");
+		// --wide
+		global.wideRows = args.check_any<opt3::Option>("wide");
+		// --format
+		if (const auto& formatArg{ args.castgetv<std::string, opt3::Option>("format") }; formatArg.has_value())
+			global.outputFormat = parseOutputFormat(formatArg.value());
+		// --to (outside of --range)
+		const auto& outputUnits{ args.castgetv<std::string, opt3::Option>("to").value_or("") };
+
+	#ifdef ENABLE_CONFIG_FILE
+		// load user-defined units & systems, except for the options that don't use them; an invalid unit section is reported without-
+		//  -stopping ckconv, so the built-in units still work & --new-ini can still replace the config
+		if (cfgExists && !(args.empty() && trailingArgs.empty()) && !args.check_any<opt3::Flag, opt3::Option>('h', "help", 'v', "version") && !args.check_any<opt3::Option>("new-ini", "ini-new")) {
+			try {
+				loadUserUnits(cfgPath, cfg);
+			} catch (const std::exception& ex) {
+				std::cerr << global.csync.get_warn() << ex.what() << " Custom units are unavailable until it is fixed." << std::endl;
+			}
+		}
+	#endif // ENABLE_CONFIG_FILE
 
 		// -h | --help
-		if (const auto& noArgsProvided{ args.empty() }; noArgsProvided || args.check_any<opt3::Flag, opt3::Option>('h', "help")) {
+		if (const auto& noArgsProvided{ args.empty() && trailingArgs.empty() }; noArgsProvided || args.check_any<opt3::Flag, opt3::Option>('h', "help")) {
 			std::cout << Help(programName.generic_string());
 			if (noArgsProvided)
 				std::cerr << term::get_fatal(false) << "No arguments provided!" << std::endl;
@@ -315,31 +674,156 @@ int main(const int argc, char** argv)
 		// -p | --precision
 		global.precision = args.castgetv_any<size_t, opt3::Flag, opt3::Option>('p', "precision");
 
+	#ifdef ENABLE_IO_URING
+		// --no-io-uring
+		io::uring::enabled = !args.check_any<opt3::Option>("no-io-uring");
+		// STDOUT is written asynchronously when it is redirected to a regular file; it must outlive the compressor, which writes to it
+		io::uring::AsyncOutput asyncOutput{ std::cout, STDOUT_FILENO, io::BLOCK_SIZE };
+	#endif
+		// --compress
+		std::optional<io::OutputCompressor> compressor;
+		if (const auto& compressArg{ args.castgetv<std::string, opt3::Option>("compress") }; compressArg.has_value()) {
+			if (const auto compression{ io::parseCompression(compressArg.value()) }; compression != io::Compression::NONE) {
+			#ifdef OS_WIN
+				_setmode(_fileno(stdout), _O_BINARY);
+			#endif
+				compressor.emplace(std::cout, compression);
+			}
+		}
+		// -i | --input
+		const auto& inputPath{ args.castgetv_any<std::string, opt3::Flag, opt3::Option>('i', "input") };
+
 		/// MAIN:
 
-		// process all parameters (trailing) & piped input (preceding) into a vector of string tuples that each represent an operation
-		if (const auto& userInputs{ processInput(expandUnits(cat(getInputsFromSTDIN(), args.getv_all<opt3::Parameter>()))) };
-			!userInputs.empty()) {
+		// --line-mode
+		if (args.check_any<opt3::Option>("line-mode")) {
+			if (inputPath.has_value()) {
+				io::InputStream is{ inputPath.value() };
+				runLineMode(is, outputUnits);
+			}
+			else {
+				io::InputStream is;
+				runLineMode(is, outputUnits);
+			}
+			return finish();
+		}
 
-			for (const auto& it : userInputs) {
-				stringifier s;
-				try {
-					const auto& [inUnit, inValue, outUnit] { toConvertible(it) };
-					const auto outValue{ conv::convert(inUnit, inValue, outUnit) };
+		// --export-table
+		if (const auto& exportArg{ args.castgetv<std::string, opt3::Option>("export-table") }; exportArg.has_value()) {
+			if (str::equalsAny<true>(exportArg.value(), "header", "hpp", "cpp", "c++"))
+				table::writeHeader(std::cout, ckconv_VERSION_EXTENDED);
+			else if (str::equalsAny<true>(exportArg.value(), "binary", "bin", "blob")) {
+			#ifdef OS_WIN
+				_setmode(_fileno(stdout), _O_BINARY);
+			#endif
+				table::writeBinary(std::cout);
+			}
+			else throw make_exception("Invalid table format '", exportArg.value(), "'; expected 'header' or 'binary'!");
+			return 0;
+		}
+
+		// --plugin
+		if (const auto& pluginArg{ args.castgetv<std::string, opt3::Option>("plugin") }; pluginArg.has_value()) {
+			$alloc_stage(CONVERT);
+			// positions are stored in Creation Kit units
+			const auto& inUnit{ conv::getUnit(args.castgetv<std::string, opt3::Option>("from").value_or("u")) };
+
+			if (const auto& outputArg{ args.castgetv_any<std::string, opt3::Flag, opt3::Option>('o', "output") }; outputArg.has_value()) {
+				if (outputUnits.empty())
+					throw make_exception("The --output option for --plugin requires the --to option!");
+				const size_t count{ plugin::rewrite(pluginArg.value(), outputArg.value(), inUnit, conv::getUnit(outputUnits)) };
+				$alloc_count_lines(count);
+				if (!global.quiet)
+					std::cerr << "Converted " << count << " reference positions." << std::endl;
+			}
+			else {
+				std::ios_base::sync_with_stdio(false);
+				$alloc_count_lines(plugin::extract(pluginArg.value(), inUnit, conv::getUnit(outputUnits.empty() ? "m" : outputUnits), std::cout));
+			}
+			return finish();
+		}
 
-					std::cout << converted{ inUnit, inValue, outUnit, outValue } << '\n';
+		// --range
+		if (const auto& rangeArg{ args.castgetv<std::string, opt3::Option>("range") }; rangeArg.has_value()) {
+			const auto& fromArg{ args.castgetv<std::string, opt3::Option>("from") };
+			const auto& toArg{ args.castgetv<std::string, opt3::Option>("to") };
+			if (!fromArg.has_value() || !toArg.has_value())
+				throw make_exception("The --range option requires both the --from & --to options!");
+
+			std::ios_base::sync_with_stdio(false);
+			$alloc_stage(CONVERT);
+			const auto& range{ RangeSpec::parse(rangeArg.value()) };
+			RangeTable(range, conv::getUnit(fromArg.value()), getUnitList(toArg.value())).write(std::cout, !global.quiet);
+			$alloc_count_lines(range.size());
+			return finish();
+		}
 
-				} catch (const std::exception& ex) {
-					std::cerr << global.csync.get_error() << ex.what() << std::endl;
-				}
+	#ifndef OS_WIN
+		// --shm
+		if (const auto& shmName{ args.castgetv<std::string, opt3::Option>("shm") }; shmName.has_value()) {
+			shm::runServer(shmName.value(), args.castgetv<uint32_t, opt3::Option>("shm-capacity").value_or(shm::DEFAULT_CAPACITY));
+			return finish();
+		}
+	#endif
+	#ifdef OS_LINUX
+		// --watch
+		if (const auto& watchArg{ args.castgetv<std::string, opt3::Option>("watch") }; watchArg.has_value()) {
+			const auto& outputArg{ args.castgetv_any<std::string, opt3::Flag, opt3::Option>('o', "output") };
+			if (!outputArg.has_value())
+				throw make_exception("The --watch option requires the --output option!");
+
+			watch::run(watchArg.value(), outputArg.value(), outputUnits);
+			return finish();
+		}
+	#endif
 
-				std::cout << s.rdbuf() << '\n';
-			}
+		// process piped input (preceding), all parameters, & the arguments after "--" (trailing) into a lazy stream of operations, which-
+		//  -are converted as they are read. Response files (@path) are expanded in place, but only in the arguments; tokens that are-
+		//  -read from STDIN or the --input file are never treated as response files.
+		$alloc_stage(INPUT);
+		std::optional<io::InputStream> inputStream;
+		if (inputPath.has_value())
+			inputStream.emplace(inputPath.value());
+		else if (hasPendingDataSTDIN())
+			inputStream.emplace();
+		std::istringstream noInput;
+
+		// -e | --expression
+		if (args.check_any<opt3::Flag, opt3::Option>('e', "expression")) {
+			// expressions may be split into several arguments by the shell
+			std::string expressions;
+			for (const auto& param : args.getv_all<opt3::Parameter>())
+				(expressions += param) += ' ';
+			for (const char* arg : trailingArgs)
+				(expressions += arg) += ' ';
+			if (printExpressions(inputStream.has_value() ? static_cast<std::istream&>(inputStream.value()) : noInput, expressions) == 0)
+				throw make_exception("No valid expressions specified!");
+			return finish();
+		}
+
+		auto userInputs{ pipeline::operations(pipeline::expandUnits(pipeline::concat(
+			pipeline::tokens(inputStream.has_value() ? static_cast<std::istream&>(inputStream.value()) : noInput),
+			pipeline::expandResponseFiles(pipeline::concat(
+				args.getv_all<opt3::Parameter>(),
+				trailingArgs | std::views::transform([](const char* arg) { return std::string_view{ arg }; })
+			))
+		), outputUnits.empty()), outputUnits) };
+
+		// --aggregate
+		if (const auto& aggregateArg{ args.castgetv<std::string, opt3::Option>("aggregate") }; aggregateArg.has_value()) {
+			if (global.outputFormat != OutputFormat::HUMAN)
+				throw make_exception("The --aggregate option doesn't support the --format option!");
+			Aggregator aggregator{ AggregateSpec::parse(aggregateArg.value()) };
+			const size_t count{ aggregator.add(userInputs) };
+			if (count == 0)
+				throw make_exception("No valid conversions specified!");
+			$alloc_count_lines(count);
+			aggregator.print(std::cout);
 		}
-		// 
-		else throw make_exception("No valid conversions specified!");
+		else if (printConversions(userInputs) == 0)
+			throw make_exception("No valid conversions specified!");
 
-		return 0;
+		return finish();
 	} catch (const std::exception& ex) {
 		std::cerr << term::get_fatal(false) << ex.what() << std::endl;
 		return 1;
@@ -15,6 +15,13 @@
 #include <optional>
 #include <iterator>
 #include <algorithm>
+#include <array>
+#include <string_view>
+#include <cctype>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace conv {
 	/**
@@ -28,9 +35,17 @@ namespace conv {
 		IMPERIAL,
 		/// @brief	Bethesda's Creation Kit Measurement System
 		CREATIONKIT,
+		/// @brief	The Havok Physics Engine's Measurement System
+		HAVOK,
+		/// @brief	Unreal Engine's Measurement System
+		UNREAL,
+		/// @brief	Unity's Measurement System
+		UNITY,
 		/// @brief	Represents all SystemIDs
 		ALL,
 	};
+	/// @brief	The number of measurement systems, excluding SystemID::ALL.
+	inline constexpr size_t SYSTEM_COUNT{ static_cast<size_t>(SystemID::ALL) };
 
 	/// @brief	Changes the *first occurrence* of the word 'metre' in the given string to 'meter'. This function ignores case.
 	inline std::string ChangeMetreToMeter(std::string s)
@@ -54,6 +69,257 @@ namespace conv {
 	/// @brief	Type used for numbers.
 	using number_t = long double;
 
+	/**
+	 * @enum	Powers
+	 * @brief	Defines all SI prefixes and their base-10 exponent.
+	 *\n		See https://en.wikipedia.org/wiki/Metric_prefix#List_of_SI_prefixes
+	 */
+	enum class SIPrefix : int8_t {
+		YOCTO = -24,
+		ZEPTO = -21,
+		ATTO = -18,
+		FEMTO = -15,
+		PICO = -12,
+		NANO = -9,
+		MICRO = -6,
+		MILLI = -3,
+		CENTI = -2,
+		DECI = -1,
+		BASE = 0,
+		DECA = 1,
+		HECTO = 2,
+		KILO = 3,
+		MEGA = 6,
+		GIGA = 9,
+		TERA = 12,
+		PETA = 15,
+		EXA = 18,
+		ZETTA = 21,
+		YOTTA = 24,
+	};
+
+	/**
+	 * @brief			Calculates 10 raised to the power of the given exponent.
+	 * @param exponent	Base-10 exponent.
+	 * @returns			number_t
+	 */
+	inline constexpr number_t pow10(const int exponent) noexcept
+	{
+		number_t result{ 1.0L };
+		for (int i{ 0 }, end{ exponent < 0 ? -exponent : exponent }; i < end; ++i)
+			result *= 10.0L;
+		return (exponent < 0 ? 1.0L / result : result);
+	}
+	/// @brief	Raises the given number to a small positive integral power at compile time.
+	inline constexpr number_t ipow(const number_t n, const unsigned exponent) noexcept
+	{
+		number_t result{ 1.0L };
+		for (unsigned i{ 0 }; i < exponent; ++i)
+			result *= n;
+		return result;
+	}
+
+	/// @brief	The largest supported dimension exponent. *(1 = length, 2 = area, 3 = volume)*
+	inline constexpr unsigned MAX_DIMENSION{ 3 };
+
+	/**
+	 * @struct	DimensionMatch
+	 * @brief	The result of splitting a dimension specifier from a unit string. *(ex. "m^2" -> "m", 2)*
+	 */
+	struct DimensionMatch {
+		/// @brief	The part of the string that specifies the length unit. This points into the string that was parsed.
+		std::string_view unit;
+		/// @brief	The dimension exponent, or 1 when the string doesn't specify one.
+		unsigned dimension{ 1 };
+	};
+
+	/**
+	 * @brief		Splits a dimension specifier from the given unit string without allocating.
+	 *\n				Recognized forms are suffixes ("m2", "m^2", "m²") and prefixes ("sq ft", "sqft", "square feet", "cu u", "cubic meters").
+	 * @param s		Input string.
+	 * @returns		DimensionMatch. The dimension is 1 & the unit is the entire string when there isn't a dimension specifier.
+	 */
+	inline constexpr DimensionMatch parseDimension(std::string_view const& s) noexcept
+	{
+		const auto& iequals_prefix{ [&s](std::string_view const& prefix) {
+			if (s.size() <= prefix.size())
+				return false;
+			for (size_t i{ 0 }; i < prefix.size(); ++i)
+				if ((s[i] | 0x20) != prefix[i])
+					return false;
+			return true;
+		} };
+		const auto& trimmed{ [](std::string_view sv) {
+			while (!sv.empty() && (sv.front() == ' ' || sv.front() == '.' || sv.front() == '-' || sv.front() == '_'))
+				sv.remove_prefix(1);
+			return sv;
+		} };
+
+		// prefixes; longer words are checked first so "square" isn't matched as "sq" + "uare"
+		constexpr std::pair<std::string_view, unsigned> prefixes[]{ { "square", 2 }, { "sq", 2 }, { "cubic", 3 }, { "cu", 3 } };
+		for (const auto& [prefix, dimension] : prefixes)
+			if (iequals_prefix(prefix))
+				if (const auto& rest{ trimmed(s.substr(prefix.size())) }; !rest.empty())
+					return { rest, dimension };
+
+		// suffixes
+		if (s.size() > 2 && (s.ends_with("\xC2\xB2") || s.ends_with("\xC2\xB3"))) // UTF-8 superscripts
+			return { s.substr(0, s.size() - 2), s.ends_with("\xC2\xB2") ? 2u : 3u };
+		if (s.size() > 1 && (s.back() == '2' || s.back() == '3')) {
+			auto rest{ s.substr(0, s.size() - 1) };
+			if (rest.size() > 1 && rest.back() == '^')
+				rest.remove_suffix(1);
+			// the character before the exponent must be part of a unit name, so numbers like "12" aren't matched
+			if (const char c{ rest.back() }; (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '\'' || c == '"')
+				return { rest, static_cast<unsigned>(s.back() - '0') };
+		}
+		return { s, 1 };
+	}
+
+	/**
+	 * @struct	SIPrefixInfo
+	 * @brief	Describes the symbol & name of an SI prefix.
+	 */
+	struct SIPrefixInfo {
+		SIPrefix prefix;
+		/// @brief	The prefix symbol, which is case-sensitive. (ex. "k")
+		std::string_view symbol;
+		/// @brief	The prefix name in lowercase, which is case-insensitive. (ex. "kilo")
+		std::string_view name;
+		/// @brief	The factor that this prefix applies to a base unit; derived from the prefix's exponent.
+		number_t factor{ pow10(static_cast<int>(prefix)) };
+
+		CONSTEXPR int GetExponent() const noexcept { return static_cast<int>(prefix); }
+	};
+
+	/// @brief	All SI prefixes *(except for BASE)*, in ascending order.
+	inline constexpr std::array<SIPrefixInfo, 20> SI_PREFIXES{
+		SIPrefixInfo{ SIPrefix::YOCTO, "y", "yocto" },
+		SIPrefixInfo{ SIPrefix::ZEPTO, "z", "zepto" },
+		SIPrefixInfo{ SIPrefix::ATTO, "a", "atto" },
+		SIPrefixInfo{ SIPrefix::FEMTO, "f", "femto" },
+		SIPrefixInfo{ SIPrefix::PICO, "p", "pico" },
+		SIPrefixInfo{ SIPrefix::NANO, "n", "nano" },
+		SIPrefixInfo{ SIPrefix::MICRO, "u", "micro" },
+		SIPrefixInfo{ SIPrefix::MILLI, "m", "milli" },
+		SIPrefixInfo{ SIPrefix::CENTI, "c", "centi" },
+		SIPrefixInfo{ SIPrefix::DECI, "d", "deci" },
+		SIPrefixInfo{ SIPrefix::DECA, "da", "deca" },
+		SIPrefixInfo{ SIPrefix::HECTO, "h", "hecto" },
+		SIPrefixInfo{ SIPrefix::KILO, "k", "kilo" },
+		SIPrefixInfo{ SIPrefix::MEGA, "M", "mega" },
+		SIPrefixInfo{ SIPrefix::GIGA, "G", "giga" },
+		SIPrefixInfo{ SIPrefix::TERA, "T", "tera" },
+		SIPrefixInfo{ SIPrefix::PETA, "P", "peta" },
+		SIPrefixInfo{ SIPrefix::EXA, "E", "exa" },
+		SIPrefixInfo{ SIPrefix::ZETTA, "Z", "zetta" },
+		SIPrefixInfo{ SIPrefix::YOTTA, "Y", "yotta" },
+	};
+
+	/// @brief	Gets the SIPrefixInfo for the given prefix, or nullptr when given SIPrefix::BASE.
+	inline constexpr const SIPrefixInfo* getSIPrefixInfo(const SIPrefix prefix) noexcept
+	{
+		for (const auto& info : SI_PREFIXES)
+			if (info.prefix == prefix)
+				return &info;
+		return nullptr;
+	}
+
+	/**
+	 * @struct	SIPrefixMatch
+	 * @brief	An SI prefix that was matched at the beginning of a string, and its length in characters.
+	 */
+	struct SIPrefixMatch {
+		/// @brief	The maximum number of prefixes that can match one string. *(ex. "d" & "da")*
+		static constexpr size_t MAX_MATCHES{ 4 };
+
+		size_t length;
+		const SIPrefixInfo* info;
+	};
+
+	/**
+	 * @class			SIPrefixTrie
+	 * @brief			A tiny character trie that matches SI prefix symbols or names at the beginning of a string.
+	 * @tparam UseNames	When true, the trie is built from the (case-insensitive) prefix names; otherwise it is built from the (case-sensitive) prefix symbols.
+	 */
+	template<bool UseNames>
+	class SIPrefixTrie {
+		struct node {
+			char ch{};
+			/// @brief	Index of the first child node; 0 means there are no children since the root is never a child.
+			uint8_t child{ 0 };
+			/// @brief	Index of the next sibling node; 0 means there are no more siblings.
+			uint8_t sibling{ 0 };
+			/// @brief	Index in SI_PREFIXES of the prefix that ends at this node, or -1.
+			int8_t prefix{ -1 };
+		};
+
+		static constexpr std::string_view key(SIPrefixInfo const& info) noexcept { return UseNames ? info.name : info.symbol; }
+		static constexpr char normalize(const char c) noexcept { return (UseNames && c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c; }
+		static constexpr size_t capacity() noexcept
+		{
+			size_t sz{ 1 }; //< root node
+			for (const auto& info : SI_PREFIXES)
+				sz += key(info).size();
+			return sz;
+		}
+
+		std::array<node, capacity()> nodes{};
+		uint8_t count{ 1 };
+
+	public:
+		using match = SIPrefixMatch;
+		using match_array = std::array<match, SIPrefixMatch::MAX_MATCHES>;
+
+		constexpr SIPrefixTrie()
+		{
+			for (int8_t i{ 0 }; i < static_cast<int8_t>(SI_PREFIXES.size()); ++i) {
+				uint8_t current{ 0 };
+				for (const char c : key(SI_PREFIXES[i])) {
+					uint8_t next{ nodes[current].child };
+					while (next != 0 && nodes[next].ch != c)
+						next = nodes[next].sibling;
+					if (next == 0) { // insert a new child
+						next = count++;
+						nodes[next].ch = c;
+						nodes[next].sibling = nodes[current].child;
+						nodes[current].child = next;
+					}
+					current = next;
+				}
+				nodes[current].prefix = i;
+			}
+		}
+
+		/**
+		 * @brief		Finds all prefixes that match the beginning of the given string, without allocating.
+		 * @param s		Input string.
+		 * @param out	Receives the matches, in order of ascending length.
+		 * @returns		The number of matches written to out.
+		 */
+		constexpr size_t match_all(std::string_view const& s, match_array& out) const noexcept
+		{
+			size_t matchCount{ 0 };
+			uint8_t current{ 0 };
+			for (size_t i{ 0 }; i < s.size() && matchCount < out.size(); ++i) {
+				const char c{ normalize(s[i]) };
+				uint8_t next{ nodes[current].child };
+				while (next != 0 && nodes[next].ch != c)
+					next = nodes[next].sibling;
+				if (next == 0) break;
+				current = next;
+				if (nodes[current].prefix != -1)
+					out[matchCount++] = match{ i + 1, &SI_PREFIXES[nodes[current].prefix] };
+			}
+			return matchCount;
+		}
+	};
+
+	/// @brief	Matches SI prefix symbols. *(ex. "k")*
+	inline constexpr SIPrefixTrie<false> SIPrefixSymbols{};
+	/// @brief	Matches SI prefix names. *(ex. "kilo")*
+	inline constexpr SIPrefixTrie<true> SIPrefixNames{};
+
 	/**
 	 * @struct	Unit
 	 * @brief	Represents a length measurement unit. *(Does not contain a value.)*
@@ -61,6 +327,8 @@ namespace conv {
 	class Unit {
 		SystemID _system;
 		number_t unitcf;
+		SIPrefix _prefix{ SIPrefix::BASE };
+		unsigned _dimension{ 1 };
 
 		std::string symbol;
 		std::string fullName;
@@ -84,6 +352,10 @@ namespace conv {
 		CONSTEXPR SystemID GetSystemID() const noexcept { return _system; }
 		CONSTEXPR explicit operator SystemID() const noexcept { return this->GetSystemID(); }
 
+		CONSTEXPR SIPrefix GetPrefix() const noexcept { return _prefix; }
+		/// @brief	Gets the dimension exponent of this unit. *(1 = length, 2 = area, 3 = volume)*
+		CONSTEXPR unsigned GetDimension() const noexcept { return _dimension; }
+
 		CONSTEXPR bool HasUniquePlural() const noexcept { return pluralIsOverrideNotExt; }
 
 		WINCONSTEXPR bool HasSymbol() const noexcept { return !symbol.empty(); }
@@ -92,8 +364,17 @@ namespace conv {
 		WINCONSTEXPR bool HasFullName() const noexcept { return !fullName.empty(); }
 		WINCONSTEXPR std::string GetFullName(const bool plural = true) const noexcept { return (plural ? (pluralIsOverrideNotExt ? fullNamePluralExt : fullName + fullNamePluralExt) : fullName); }
 
+		/// @brief	Checks if this is the same unit as another unit, without copying any of their names.
+		WINCONSTEXPR bool IsSameUnit(Unit const& other) const noexcept
+		{
+			return _system == other._system && _prefix == other._prefix && _dimension == other._dimension
+				&& symbol == other.symbol && fullName == other.fullName && fullNamePluralExt == other.fullNamePluralExt;
+		}
+
 		WINCONSTEXPR bool HasExtraNames() const noexcept { return !extraNames.empty(); }
 		WINCONSTEXPR std::vector<std::string> GetExtraNames() const noexcept { return extraNames; }
+		/// @brief	Adds another name that this unit can be referred to by.
+		WINCONSTEXPR Unit& AddExtraName(std::string const& name) { extraNames.emplace_back(name); return *this; }
 
 		WINCONSTEXPR std::string GetPrintableName(const bool preferFullName, const bool plural = true) const noexcept
 		{
@@ -103,35 +384,56 @@ namespace conv {
 		}
 
 		CONSTEXPR number_t ConvertToBase(number_t const& value) const noexcept { return value * unitcf; }
-	};
 
-	/**
-	 * @enum	Powers
-	 * @brief	Defines all SI prefixes and their base-10 exponent.
-	 *\n		See https://en.wikipedia.org/wiki/Metric_prefix#List_of_SI_prefixes
-	 */
-	enum class SIPrefix : int8_t {
-		YOCTO = -24,
-		ZEPTO = -21,
-		ATTO = -18,
-		FEMTO = -15,
-		PICO = -12,
-		NANO = -9,
-		MICRO = -6,
-		MILLI = -3,
-		CENTI = -2,
-		DECI = -1,
-		BASE = 0,
-		DECA = 1,
-		HECTO = 2,
-		KILO = 3,
-		MEGA = 6,
-		GIGA = 9,
-		TERA = 12,
-		PETA = 15,
-		EXA = 18,
-		ZETTA = 21,
-		YOTTA = 24,
+		/**
+		 * @brief			Creates a copy of this unit with the given SI prefix applied to its conversion factor, symbol, and names.
+		 * @param prefix	The SI prefix to apply. This unit must not already have a prefix.
+		 * @returns			Unit
+		 */
+		WINCONSTEXPR Unit ApplyPrefix(SIPrefixInfo const& prefix) const
+		{
+			Unit copy{ *this };
+			copy._prefix = prefix.prefix;
+			copy.unitcf = unitcf * prefix.factor;
+			if (HasSymbol())
+				copy.symbol = std::string{ prefix.symbol } + symbol;
+			if (HasFullName()) {
+				std::string prefixName{ prefix.name };
+				prefixName.front() = static_cast<char>(std::toupper(prefixName.front()));
+				copy.fullName = prefixName + str::tolower(fullName);
+				if (pluralIsOverrideNotExt)
+					copy.fullNamePluralExt = prefixName + str::tolower(fullNamePluralExt);
+			}
+			copy.extraNames.clear();
+			return copy;
+		}
+
+		/**
+		 * @brief				Creates a copy of this unit that measures area or volume, by raising its conversion factor to the given power.
+		 *\n					Any SI prefix must be applied first, since the prefix is also raised to the given power. *(ex. 1 km^2 = 1000^2 m^2)*
+		 * @param dimension		The dimension exponent, between 1 and MAX_DIMENSION. This unit must be a length unit.
+		 * @returns				Unit
+		 */
+		WINCONSTEXPR Unit WithDimension(const unsigned dimension) const
+		{
+			if (dimension == _dimension)
+				return *this;
+			if (_dimension != 1 || dimension == 0 || dimension > MAX_DIMENSION)
+				throw make_exception("Unit '", GetPrintableName(false), "' can't be raised to the power of ", dimension, '!');
+			Unit copy{ *this };
+			copy._dimension = dimension;
+			copy.unitcf = ipow(unitcf, dimension);
+			if (HasSymbol()) // use "ft" & "in" instead of the quote symbols, which are ambiguous with an exponent
+				copy.symbol = ((symbol == "'" || symbol == "\"") && HasExtraNames() ? extraNames.front() : symbol) + '^' + static_cast<char>('0' + dimension);
+			if (HasFullName()) {
+				const std::string word{ dimension == 2 ? "Square " : "Cubic " };
+				copy.fullName = word + fullName;
+				if (pluralIsOverrideNotExt)
+					copy.fullNamePluralExt = word + fullNamePluralExt;
+			}
+			copy.extraNames.clear();
+			return copy;
+		}
 	};
 
 	struct System {
@@ -142,9 +444,15 @@ namespace conv {
 		const char* const name;
 		const std::vector<Unit> units;
 		const Unit* base{ nullptr };
+		/// @brief	When true, every unit in this system also accepts any SI prefix. *(ex. "km" or "kilometer")*
+		const bool siPrefixable{ false };
 
 		template<var::same_or_convertible<Unit>... TUnits>
 		CONSTEXPR System(const char* const name, TUnits&&... units) : name{ name }, units{ (Unit{ std::forward<TUnits>(units) })... } {}
+		template<var::same_or_convertible<Unit>... TUnits>
+		CONSTEXPR System(const char* const name, const bool siPrefixable, TUnits&&... units) : name{ name }, units{ (Unit{ std::forward<TUnits>(units) })... }, siPrefixable{ siPrefixable } {}
+		WINCONSTEXPR System(const char* const name, std::vector<Unit>&& units, const bool siPrefixable = false) : name{ name }, units{ std::move(units) }, siPrefixable{ siPrefixable } {}
+		virtual ~System() = default;
 
 		virtual bool compare_unit_symbol(std::string const& s, std::string const& symbol) const noexcept
 		{
@@ -181,6 +489,77 @@ namespace conv {
 			return units.end();
 		}
 
+		/**
+		 * @brief		Resolves a unit from a string that may contain an SI prefix followed by the symbol or name of one of this system's units.
+		 *\n			Prefix symbols may only be followed by unit symbols, and prefix names may only be followed by unit names.
+		 * @param s		Input string.
+		 * @returns		The (possibly prefixed) unit when successful; otherwise std::nullopt.
+		 */
+		virtual std::optional<Unit> resolve(std::string const& s) const
+		{
+			if (const auto& it{ find(s) }; it != units.end())
+				return *it;
+			if (!siPrefixable)
+				return std::nullopt;
+
+			std::array<SIPrefixMatch, SIPrefixMatch::MAX_MATCHES> matches;
+
+			// prefix symbols; check the longest match first so "dam" resolves to "da" + "m"
+			for (size_t i{ SIPrefixSymbols.match_all(s, matches) }; i > 0; --i) {
+				const auto& [length, prefix] { matches[i - 1] };
+				const std::string remainder{ s.substr(length) };
+				for (const auto& unit : units)
+					if (unit.HasSymbol() && this->compare_unit_symbol(remainder, unit.GetSymbol()))
+						return unit.ApplyPrefix(*prefix);
+			}
+			// prefix names
+			for (size_t i{ SIPrefixNames.match_all(s, matches) }; i > 0; --i) {
+				const auto& [length, prefix] { matches[i - 1] };
+				const std::string remainder{ s.substr(length) };
+				for (const auto& unit : units) {
+					if ((unit.HasFullName() && (this->compare_unit_name(remainder, unit.GetFullName(false)) || this->compare_unit_name(remainder, unit.GetFullName(true))))
+						|| (unit.HasExtraNames() && this->compare_unit_extraNames(remainder, unit.GetExtraNames())))
+						return unit.ApplyPrefix(*prefix);
+				}
+			}
+			return std::nullopt;
+		}
+
+		/**
+		 * @brief			Gets this system's base unit with the given SI prefix applied.
+		 * @param prefix	An SI prefix.
+		 * @returns			Unit
+		 */
+		WINCONSTEXPR Unit get(const SIPrefix prefix) const
+		{
+			if (const auto* info{ getSIPrefixInfo(prefix) }; info != nullptr)
+				return base->ApplyPrefix(*info);
+			return *base;
+		}
+
+		/**
+		 * @brief		Gets all of the units in this system, including every prefixed variant of each unit when the system is SI-prefixable.
+		 *\n			This is intended for displaying units; use find() or resolve() for lookups.
+		 * @returns		std::vector<Unit>, sorted in order of ascending prefix exponent.
+		 */
+		WINCONSTEXPR std::vector<Unit> expand() const
+		{
+			if (!siPrefixable)
+				return units;
+			std::vector<Unit> vec;
+			vec.reserve(units.size() * (SI_PREFIXES.size() + 1ull));
+			bool insertedBase{ false };
+			for (const auto& prefix : SI_PREFIXES) {
+				if (!insertedBase && prefix.GetExponent() > 0) {
+					vec.insert(vec.end(), units.begin(), units.end());
+					insertedBase = true;
+				}
+				for (const auto& unit : units)
+					vec.emplace_back(unit.ApplyPrefix(prefix));
+			}
+			return vec;
+		}
+
 		WINCONSTEXPR auto begin() const noexcept { return units.begin(); }
 		WINCONSTEXPR auto end() const noexcept { return units.end(); }
 
@@ -195,117 +574,74 @@ namespace conv {
 	/**
 	 * @struct	Metric
 	 * @brief	Intra-Metric-System Conversion Factors. (Relative to Meters)
+	 *\n		Prefixed units *(ex. kilometers)* are resolved by System::resolve().
 	 */
 	struct MetricSystem : public System { // SystemID::METRIC
-		MetricSystem() : System("Metric",
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::YOCTO)), "ym", "Yoctometer" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::ZEPTO)), "zm", "Zeptometer" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::ATTO)), "am", "Attometer" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::FEMTO)), "fm", "Femtometer" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::PICO)), "pm", "Picometer" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::NANO)), "nm", "Nanometer" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::MICRO)), "um", "Micrometer" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::MILLI)), "mm", "Millimeter" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::CENTI)), "cm", "Centimeter" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::DECI)), "dm", "Decimeter" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::BASE)), "m", "Meter" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::DECA)), "dam", "Decameter" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::HECTO)), "hm", "Hectometer" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::KILO)), "km", "Kilometer" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::MEGA)), "Mm", "Megameter" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::GIGA)), "Gm", "Gigameter" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::TERA)), "Tm", "Terameter" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::PETA)), "Pm", "Petameter" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::EXA)), "Em", "Exameter" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::ZETTA)), "Zm", "Zettameter" },
-								Unit{ SystemID::METRIC, std::pow(10.0L, static_cast<number_t>(SIPrefix::YOTTA)), "Ym", "Yottameter" })
+		MetricSystem() : System("Metric", true,
+								Unit{ SystemID::METRIC, 1.0L, "m", "Meter" })
 		{
-			SetBaseUnit(&units.at(10));
-		}
-
-		const Unit* YOCTOMETER{ &units[0] };
-		const Unit* ZEPTOMETER{ &units[1] };
-		const Unit* ATTOMETER{ &units[2] };
-		const Unit* FEMTOMETER{ &units[3] };
-		const Unit* PICOMETER{ &units[4] };
-		const Unit* NANOMETER{ &units[5] };
-		const Unit* MICROMETER{ &units[6] };
-		const Unit* MILLIMETER{ &units[7] };
-		const Unit* CENTIMETER{ &units[8] };
-		const Unit* DECIMETER{ &units[9] };
-		const Unit* METER{ &units[10] };
-		const Unit* DECAMETER{ &units[11] };
-		const Unit* HECTOMETER{ &units[12] };
-		const Unit* KILOMETER{ &units[13] };
-		const Unit* MEGAMETER{ &units[14] };
-		const Unit* GIGAMETER{ &units[15] };
-		const Unit* TERAMETER{ &units[16] };
-		const Unit* PETAMETER{ &units[17] };
-		const Unit* EXAMETER{ &units[18] };
-		const Unit* ZETTAMETER{ &units[19] };
-		const Unit* YOTTAMETER{ &units[20] };
+			SetBaseUnit(&units.at(0));
+		}
+
+		const Unit* METER{ &units[0] };
 
 		// the base unit of the Metric system (meters)
 		const Unit* const base{ METER };
+
+		/// @brief	Resolves a unit, accepting the British spelling "metre" too.
+		std::optional<Unit> resolve(std::string const& s) const override
+		{
+			return System::resolve(ChangeMetreToMeter(s));
+		}
 	} Metric;
 
 	/**
 	 * @struct	CreationKit
 	 * @brief	Intra-CreationKit-System Conversion Factors. (Relative to Units)
+	 *\n		Prefixed units *(ex. kilounits)* are resolved by System::resolve().
 	 */
 	struct CreationKitSystem : public System { // SystemID::CREATIONKIT
-		CreationKitSystem() : System("Creation Kit",
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::YOCTO)), "yu", "Yoctounit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::ZEPTO)), "zu", "Zeptounit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::ATTO)), "au", "Attounit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::FEMTO)), "fu", "Femtounit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::PICO)), "pu", "Picounit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::NANO)), "nu", "Nanounit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::MICRO)), "uu", "Microunit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::MILLI)), "mu", "Milliunit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::CENTI)), "cu", "Centiunit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::DECI)), "du", "Deciunit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::BASE)), "u", "Unit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::DECA)), "dau", "Decaunit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::HECTO)), "hu", "Hectounit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::KILO)), "ku", "Kilometer" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::MEGA)), "Mu", "Megaunit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::GIGA)), "Gu", "Gigaunit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::TERA)), "Tu", "Teraunit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::PETA)), "Pu", "Petaunit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::EXA)), "Eu", "Exaunit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::ZETTA)), "Zu", "Zettaunit" },
-									 Unit{ SystemID::CREATIONKIT, std::pow(10.0L, static_cast<number_t>(SIPrefix::YOTTA)), "Yu", "Yottaunit" })
+		CreationKitSystem() : System("Creation Kit", true,
+									 Unit{ SystemID::CREATIONKIT, 1.0L, "u", "Unit" })
 		{
-			SetBaseUnit(&units.at(10));
-		}
-
-		const Unit* YOCTOUNIT{ &units[0] };
-		const Unit* ZEPTOUNIT{ &units[1] };
-		const Unit* ATTOUNIT{ &units[2] };
-		const Unit* FEMTOUNIT{ &units[3] };
-		const Unit* PICOUNIT{ &units[4] };
-		const Unit* NANOUNIT{ &units[5] };
-		const Unit* MICROUNIT{ &units[6] };
-		const Unit* MILLIUNIT{ &units[7] };
-		const Unit* CENTIUNIT{ &units[8] };
-		const Unit* DECIUNIT{ &units[9] };
-		const Unit* UNIT{ &units[10] };
-		const Unit* DECAUNIT{ &units[11] };
-		const Unit* HECTOUNIT{ &units[12] };
-		const Unit* KILOUNIT{ &units[13] };
-		const Unit* MEGAUNIT{ &units[14] };
-		const Unit* GIGAUNIT{ &units[15] };
-		const Unit* TERAUNIT{ &units[16] };
-		const Unit* PETAUNIT{ &units[17] };
-		const Unit* EXAUNIT{ &units[18] };
-		const Unit* ZETTAUNIT{ &units[19] };
-		const Unit* YOTTAUNIT{ &units[20] };
+			SetBaseUnit(&units.at(0));
+		}
+
+		const Unit* UNIT{ &units[0] };
 
 		// the base unit of this system
 		const Unit* const base{ UNIT };
 	} CreationKit;
 
+	namespace _internal {
+		/// @brief	Owns the name of a CustomSystem, so that it is constructed before the System base class that points to it.
+		struct system_name_holder { std::string systemName; };
+	}
+
+	/**
+	 * @struct	CustomSystem
+	 * @brief	A measurement system that is defined at runtime. *(ex. user-defined units from the INI config)*
+	 *\n		Custom units use the SystemID of the built-in system that their conversion factor is relative to.
+	 */
+	struct CustomSystem : private _internal::system_name_holder, public System {
+		/**
+		 * @param name			The name of the system.
+		 * @param units			The units in the system. When hasBaseUnit is true, the first unit is the system's base unit.
+		 * @param hasBaseUnit	When true, the first unit is used as the base unit of this system.
+		 * @param siPrefixable	When true, the units in this system accept SI prefixes.
+		 */
+		CustomSystem(std::string const& name, std::vector<Unit>&& units, const bool hasBaseUnit, const bool siPrefixable) : _internal::system_name_holder{ name }, System(systemName.c_str(), std::move(units), siPrefixable)
+		{
+			if (hasBaseUnit && !this->units.empty())
+				SetBaseUnit(&this->units.front());
+		}
+		CustomSystem(CustomSystem const&) = delete;
+		CustomSystem& operator=(CustomSystem const&) = delete;
+	};
+
+	/// @brief	User-defined measurement systems, which are searched by getUnit() after all of the built-in systems.
+	inline std::vector<std::unique_ptr<CustomSystem>> UserSystems;
+
 	/**
 	 * @struct	Imperial
 	 * @brief	Intra-Imperial-System Conversion Factors. (Relative to Feet)
@@ -354,12 +690,138 @@ namespace conv {
 		const Unit* const base{ FOOT };
 	} Imperial;
 
+	/**
+	 * @struct	Havok
+	 * @brief	Units used by the Havok physics engine, which Bethesda's games use for collision & physics data. (Relative to Havok Units)
+	 */
+	struct HavokSystem : public System { // SystemID::HAVOK
+		HavokSystem() : System("Havok",
+							   Unit{ SystemID::HAVOK, 1.0L, "hk", "Havok Unit", "s", "havok", "havokunit" })
+		{
+			SetBaseUnit(&units.at(0));
+		}
+
+		const Unit* HAVOK_UNIT{ &units[0] };
+
+		// the base unit of this system
+		const Unit* const base{ HAVOK_UNIT };
+	} Havok;
+
+	/**
+	 * @struct	Unreal
+	 * @brief	Unreal Engine units, which are defined as one centimeter. (Relative to Unreal Units)
+	 *\n		The symbol is "UU" *(case-sensitive)*, since "uu" is already a valid Creation Kit unit *(micro-units)*.
+	 */
+	struct UnrealSystem : public System { // SystemID::UNREAL
+		UnrealSystem() : System("Unreal",
+								Unit{ SystemID::UNREAL, 1.0L, "UU", "Unreal Unit", "s", "unreal", "unrealunit" })
+		{
+			SetBaseUnit(&units.at(0));
+		}
+
+		const Unit* UNREAL_UNIT{ &units[0] };
+
+		// the base unit of this system
+		const Unit* const base{ UNREAL_UNIT };
+	} Unreal;
+
+	/**
+	 * @struct	Unity
+	 * @brief	Unity units, which are defined as one meter. (Relative to Unity Units)
+	 */
+	struct UnitySystem : public System { // SystemID::UNITY
+		UnitySystem() : System("Unity",
+							   Unit{ SystemID::UNITY, 1.0L, "UY", "Unity Unit", "s", "unity", "unityunit" })
+		{
+			SetBaseUnit(&units.at(0));
+		}
+
+		const Unit* UNITY_UNIT{ &units[0] };
+
+		// the base unit of this system
+		const Unit* const base{ UNITY_UNIT };
+	} Unity;
+
 	/// @brief	Inter-System (Metric:Imperial) Conversion Factor
 	const constexpr auto ONE_FOOT_IN_METERS{ 0.3048L };
 	/// @brief	Inter-System (CKUnit:Metric) Conversion Factor
 	const constexpr auto ONE_UNIT_IN_METERS{ 0.0142875313L };
 	/// @brief	Inter-System (CKUnit:Imperial) Conversion Factor
 	const constexpr auto ONE_UNIT_IN_FEET{ 0.046875L };
+	/// @brief	Inter-System (Havok:CKUnit) Conversion Factor
+	const constexpr auto ONE_HAVOK_UNIT_IN_UNITS{ 69.99125L };
+	/// @brief	Inter-System (Unreal:Metric) Conversion Factor
+	const constexpr auto ONE_UNREAL_UNIT_IN_METERS{ 0.01L };
+	/// @brief	Inter-System (Unity:Metric) Conversion Factor
+	const constexpr auto ONE_UNITY_UNIT_IN_METERS{ 1.0L };
+
+	/**
+	 * @struct	SystemFactor
+	 * @brief	The size of a measurement system's base unit, in meters. Meters are the canonical base that all systems are related through.
+	 */
+	struct SystemFactor {
+		SystemID system;
+		number_t meters;
+	};
+	/// @brief	The size of each system's base unit in meters. Adding a system only requires adding one entry here.
+	inline constexpr SystemFactor SYSTEM_FACTORS[]{
+		{ SystemID::METRIC, 1.0L },
+		{ SystemID::IMPERIAL, ONE_FOOT_IN_METERS },
+		{ SystemID::CREATIONKIT, ONE_UNIT_IN_METERS },
+		{ SystemID::HAVOK, ONE_HAVOK_UNIT_IN_UNITS * ONE_UNIT_IN_METERS },
+		{ SystemID::UNREAL, ONE_UNREAL_UNIT_IN_METERS },
+		{ SystemID::UNITY, ONE_UNITY_UNIT_IN_METERS },
+	};
+
+	/**
+	 * @struct	ExactSystemFactor
+	 * @brief	A factor between two systems that is defined exactly, & used instead of the factor composed through meters.
+	 *\n		The factor converts one base unit of the first system to the second, & the inverse is applied in the other direction.
+	 */
+	struct ExactSystemFactor {
+		SystemID from, to;
+		number_t factor;
+	};
+	/// @brief	Factors that are defined directly between two systems, rather than through meters.
+	inline constexpr ExactSystemFactor EXACT_SYSTEM_FACTORS[]{
+		{ SystemID::CREATIONKIT, SystemID::IMPERIAL, ONE_UNIT_IN_FEET },
+		{ SystemID::HAVOK, SystemID::CREATIONKIT, ONE_HAVOK_UNIT_IN_UNITS },
+	};
+
+	/**
+	 * @class	SystemMatrix
+	 * @brief	The factor between the base units of every pair of systems, composed once at compile time from SYSTEM_FACTORS.
+	 */
+	class SystemMatrix {
+		std::array<std::array<number_t, SYSTEM_COUNT>, SYSTEM_COUNT> factors{};
+
+	public:
+		constexpr SystemMatrix()
+		{
+			std::array<number_t, SYSTEM_COUNT> meters{};
+			for (const auto& [system, factor] : SYSTEM_FACTORS)
+				meters[static_cast<size_t>(system)] = factor;
+			for (size_t in{ 0 }; in < SYSTEM_COUNT; ++in)
+				for (size_t out{ 0 }; out < SYSTEM_COUNT; ++out)
+					factors[in][out] = (in == out ? 1.0L : meters[in] / meters[out]);
+			for (const auto& [from, to, factor] : EXACT_SYSTEM_FACTORS) {
+				factors[static_cast<size_t>(from)][static_cast<size_t>(to)] = factor;
+				factors[static_cast<size_t>(to)][static_cast<size_t>(from)] = 1.0L / factor;
+			}
+		}
+
+		/// @brief	Gets the factor that converts a value in the input system's base unit to the output system's base unit.
+		constexpr number_t operator()(const SystemID in, const SystemID out) const
+		{
+			if (static_cast<size_t>(in) >= SYSTEM_COUNT || static_cast<size_t>(out) >= SYSTEM_COUNT)
+				throw make_exception("convert_system() failed:  No handler exists for the given input type!");
+			return factors[static_cast<size_t>(in)][static_cast<size_t>(out)];
+		}
+	};
+	/// @brief	The inter-system conversion factors.
+	inline constexpr SystemMatrix SYSTEM_MATRIX{};
+
+	static_assert(std::size(SYSTEM_FACTORS) == SYSTEM_COUNT, "Every measurement system must have an entry in SYSTEM_FACTORS!");
 
 	/**
 	 * @brief			Converts between units in one measurement system.
@@ -379,41 +841,16 @@ namespace conv {
 	 * @param in_system		Input Measurement SystemID
 	 * @param v_base		Input Value, in the input system's base unit. (Metric = Meters, Imperial = Feet)
 	 * @param out_system	Output Measurement SystemID
+	 * @param dimension		The dimension exponent of the value. The inter-system factor is raised to this power for areas & volumes.
 	 * @returns				long double
 	 */
-	inline constexpr long double convert_system(const SystemID& in_system, const long double& v_base, const SystemID& out_system)
+	inline constexpr long double convert_system(const SystemID& in_system, const long double& v_base, const SystemID& out_system, const unsigned dimension = 1)
 	{
 		if (in_system == out_system) // same system
 			return v_base;
-		// convert system
-		switch (in_system) {
-		case SystemID::METRIC:
-			switch (out_system) { // METRIC ->
-			case SystemID::IMPERIAL:
-				return v_base / ONE_FOOT_IN_METERS;
-			case SystemID::CREATIONKIT:
-				return v_base / ONE_UNIT_IN_METERS;
-			}
-			break;
-		case SystemID::IMPERIAL:
-			switch (out_system) { // IMPERIAL ->
-			case SystemID::METRIC:
-				return v_base * ONE_FOOT_IN_METERS;
-			case SystemID::CREATIONKIT:
-				return v_base / ONE_UNIT_IN_FEET;
-			}
-			break;
-		case SystemID::CREATIONKIT:
-			switch (out_system) { // CREATIONKIT ->
-			case SystemID::METRIC:
-				return v_base * ONE_UNIT_IN_METERS;
-			case SystemID::IMPERIAL:
-				return v_base * ONE_UNIT_IN_FEET;
-			}
-			break;
-		default:break;
-		}
-		throw make_exception("convert_system() failed:  No handler exists for the given input type!");
+		if (dimension != 1)
+			return v_base * ipow(SYSTEM_MATRIX(in_system, out_system), dimension);
+		return v_base * SYSTEM_MATRIX(in_system, out_system);
 	}
 
 	/**
@@ -429,15 +866,230 @@ namespace conv {
 			throw make_exception("Illegal input conversion factor '", in.GetConversionFactor(), "'");
 		if (out.GetConversionFactor() == 0.0L)
 			throw make_exception("Illegal output conversion factor '", out.GetConversionFactor(), "'");
+		if (in.GetDimension() != out.GetDimension())
+			throw make_exception("Can't convert between units with different dimensions! (", in.GetDimension(), " != ", out.GetDimension(), ')');
 
 		if (in.GetSystemID() == out.GetSystemID()) // convert between units only
 			return convert_unit(in.GetConversionFactor(), val, out.GetConversionFactor());
 		// Convert between systems & units
-		return convert_system(in.GetSystemID(), in.ConvertToBase(static_cast<long double>(val)), out.GetSystemID()) / out.GetConversionFactor();
+		return convert_system(in.GetSystemID(), in.ConvertToBase(static_cast<long double>(val)), out.GetSystemID(), in.GetDimension()) / out.GetConversionFactor();
+	}
+
+	/**
+	 * @brief		Converts a number in a given unit to several other units. The input value is only converted to its base unit once.
+	 * @param in	Input Unit.
+	 * @param val	Input Value.
+	 * @param outs	Output Units.
+	 * @returns		std::vector<long double> containing the result for each output unit, in the same order.
+	 */
+	inline std::vector<long double> convert_all(const Unit& in, const long double& val, std::vector<Unit> const& outs)
+	{
+		if (in.GetConversionFactor() == 0.0L)
+			throw make_exception("Illegal input conversion factor '", in.GetConversionFactor(), "'");
+
+		const long double base{ in.ConvertToBase(val) };
+		std::vector<long double> vec;
+		vec.reserve(outs.size());
+		for (const auto& out : outs) {
+			if (out.GetConversionFactor() == 0.0L)
+				throw make_exception("Illegal output conversion factor '", out.GetConversionFactor(), "'");
+			if (in.GetDimension() != out.GetDimension())
+				throw make_exception("Can't convert between units with different dimensions! (", in.GetDimension(), " != ", out.GetDimension(), ')');
+			vec.emplace_back(convert_system(in.GetSystemID(), base, out.GetSystemID(), in.GetDimension()) / out.GetConversionFactor());
+		}
+		return vec;
+	}
+
+	/**
+	 * @brief		Gets the factor that converts values in one unit to another unit. Since all supported conversions are linear,-
+	 *				-converting a value is equivalent to multiplying it by this factor.
+	 * @param in	Input Unit.
+	 * @param out	Output Unit.
+	 * @returns		long double
+	 */
+	inline constexpr long double getConversionFactor(const Unit& in, const Unit& out)
+	{
+		return convert(in, 1.0L, out);
 	}
 
 	$DefineExcept(invalid_unit_exception);
 
+	/// @brief	The built-in measurement systems, in the order that they're searched by getUnit().
+	inline const std::array<const System*, SYSTEM_COUNT> BuiltinSystems{ &Imperial, &Metric, &CreationKit, &Havok, &Unreal, &Unity };
+
+	/// @brief	Gets all of the built-in & user-defined measurement systems, in the order that they're searched by getUnit().
+	inline std::vector<const System*> getAllSystems()
+	{
+		std::vector<const System*> vec{ BuiltinSystems.begin(), BuiltinSystems.end() };
+		for (const auto& system : UserSystems)
+			vec.emplace_back(system.get());
+		return vec;
+	}
+
+	/**
+	 * @brief		Calculates the case-insensitive Levenshtein edit distance between two strings.
+	 * @param l		Left string.
+	 * @param r		Right string.
+	 * @returns		The minimum number of single-character insertions, deletions, or substitutions required to change one string into the other.
+	 */
+	inline size_t editDistance(std::string_view const& l, std::string_view const& r)
+	{
+		const auto& lower{ [](const char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); } };
+		// reuse the row buffers between calls, since this is called many times per query
+		thread_local std::vector<size_t> prev, curr;
+		prev.resize(r.size() + 1);
+		curr.resize(r.size() + 1);
+		for (size_t j{ 0 }; j <= r.size(); ++j)
+			prev[j] = j;
+		for (size_t i{ 1 }; i <= l.size(); ++i) {
+			curr[0] = i;
+			for (size_t j{ 1 }; j <= r.size(); ++j)
+				curr[j] = std::min({ prev[j] + 1, curr[j - 1] + 1, prev[j - 1] + (lower(l[i - 1]) == lower(r[j - 1]) ? 0 : 1) });
+			std::swap(prev, curr);
+		}
+		return prev[r.size()];
+	}
+
+	/**
+	 * @class	UnitSuggestions
+	 * @brief	BK-tree index over the symbols, names, plurals, & extra names of every known unit, which is used to suggest units for strings that don't match any.
+	 *\n		Since edit distance is a metric, the tree only has to visit subtrees that could contain a match, so queries take sublinear time.
+	 */
+	class UnitSuggestions {
+		struct node {
+			std::string term;
+			/// @brief	The index of the unit that this term refers to, so that each unit is only suggested once.
+			size_t unit;
+			/// @brief	Pairs of (distance to this node, child node index).
+			std::vector<std::pair<size_t, size_t>> children;
+		};
+
+		std::vector<node> nodes;
+		size_t unitCount{ 0 };
+		/// @brief	Previous query results, keyed by the query string.
+		std::unordered_map<std::string, std::vector<std::string>> cache;
+		std::mutex mutex;
+
+		void insert(std::string const& term, const size_t unit)
+		{
+			if (term.empty())
+				return;
+			if (nodes.empty()) {
+				nodes.emplace_back(node{ term, unit, {} });
+				return;
+			}
+			for (size_t current{ 0 }; ; ) {
+				const size_t distance{ editDistance(term, nodes[current].term) };
+				if (distance == 0 && term == nodes[current].term)
+					return; //< duplicate
+				const auto& children{ nodes[current].children };
+				if (const auto& it{ std::find_if(children.begin(), children.end(), [&distance](auto&& pr) { return pr.first == distance; }) }; it != children.end())
+					current = it->second;
+				else {
+					nodes[current].children.emplace_back(distance, nodes.size());
+					nodes.emplace_back(node{ term, unit, {} });
+					return;
+				}
+			}
+		}
+
+	public:
+		/// @brief	The maximum number of suggestions returned by a query.
+		static constexpr size_t MAX_SUGGESTIONS{ 3 };
+
+		UnitSuggestions() = default;
+		/// @brief	Creates an index containing every unit in the given systems, including prefixed units.
+		UnitSuggestions(std::vector<const System*> const& systems)
+		{
+			for (const auto* system : systems)
+				for (const auto& unit : system->expand())
+					insert(unit);
+		}
+
+		void insert(Unit const& unit)
+		{
+			const size_t index{ unitCount++ };
+			insert(unit.GetSymbol(), index);
+			insert(unit.GetFullName(false), index);
+			insert(unit.GetFullName(true), index);
+			for (const auto& name : unit.GetExtraNames())
+				insert(name, index);
+		}
+
+		/**
+		 * @brief		Gets up to MAX_SUGGESTIONS unit names that are similar to the given string, ranked from most to least similar.
+		 * @param s		A string that didn't match any units.
+		 * @returns		std::vector<std::string>
+		 */
+		std::vector<std::string> query(std::string const& s)
+		{
+			std::scoped_lock lock{ mutex };
+			if (const auto& it{ cache.find(s) }; it != cache.end())
+				return it->second;
+
+			// allow roughly one typo per 3 characters
+			const size_t tolerance{ std::clamp<size_t>((s.size() + 1ull) / 3ull, 1ull, 3ull) };
+			std::vector<std::pair<size_t, const node*>> matches;
+			if (!nodes.empty()) {
+				std::vector<size_t> pending{ 0 };
+				while (!pending.empty()) {
+					const auto& n{ nodes[pending.back()] };
+					pending.pop_back();
+					const size_t distance{ editDistance(s, n.term) };
+					// single-character symbols are too short to be meaningful suggestions for longer strings
+					if (distance <= tolerance && distance < std::max(n.term.size(), s.size()))
+						matches.emplace_back(distance, &n);
+					for (const auto& [childDistance, child] : n.children)
+						if (childDistance + tolerance >= distance && childDistance <= distance + tolerance)
+							pending.emplace_back(child);
+				}
+			}
+			std::sort(matches.begin(), matches.end(), [&s](auto&& l, auto&& r) {
+				if (l.first != r.first)
+					return l.first < r.first;
+				const auto& lTerm{ l.second->term }, rTerm{ r.second->term };
+				const auto lDiff{ lTerm.size() > s.size() ? lTerm.size() - s.size() : s.size() - lTerm.size() };
+				const auto rDiff{ rTerm.size() > s.size() ? rTerm.size() - s.size() : s.size() - rTerm.size() };
+				if (lDiff != rDiff)
+					return lDiff < rDiff;
+				return lTerm < rTerm;
+			});
+
+			std::vector<std::string> suggestions;
+			std::vector<size_t> suggestedUnits;
+			for (const auto& [distance, n] : matches) {
+				if (suggestions.size() == MAX_SUGGESTIONS)
+					break;
+				if (std::find(suggestedUnits.begin(), suggestedUnits.end(), n->unit) == suggestedUnits.end()) {
+					suggestions.emplace_back(n->term);
+					suggestedUnits.emplace_back(n->unit);
+				}
+			}
+			return cache.emplace(s, std::move(suggestions)).first->second;
+		}
+	};
+
+	/// @brief	Gets the suggestion index for all units, which is built the first time it's used.
+	inline UnitSuggestions& getUnitSuggestions()
+	{
+		static UnitSuggestions index{ getAllSystems() };
+		return index;
+	}
+
+	/// @brief	Formats a list of suggestions for an error message. *(ex. "; did you mean 'a' or 'b'?")*
+	inline std::string formatSuggestions(std::vector<std::string> const& suggestions)
+	{
+		if (suggestions.empty())
+			return{};
+		std::string s{ "; did you mean " };
+		for (size_t i{ 0 }; i < suggestions.size(); ++i) {
+			if (i > 0)
+				s += (i + 1 == suggestions.size() ? (suggestions.size() > 2 ? ", or " : " or ") : ", ");
+			s += '\'' + suggestions[i] + '\'';
+		}
+		return s + '?';
+	}
+
 	/**
 	 * @brief		Retrieve the unit specified by a string containing the unit's official symbol, or name.
 	 * @param str	Input String. Must match at least one symbol exactly, or any name using case-insensitive comparison.
@@ -446,16 +1098,90 @@ namespace conv {
 	 */
 	inline Unit getUnit(std::string const& s, std::optional<Unit> const& def = std::nullopt)
 	{
-		if (const auto& it{ Imperial.find(s) }; it != Imperial.end())
-			return *it;
-		if (const auto& it{ Metric.find(ChangeMetreToMeter(s)) }; it != Metric.end())
-			return *it;
-		if (const auto& it{ CreationKit.find(s) }; it != CreationKit.end())
-			return *it;
+		const auto& findLengthUnit{ [](std::string const& s) -> std::optional<Unit> {
+			for (const auto* system : BuiltinSystems)
+				if (const auto& unit{ system->resolve(s) }; unit.has_value())
+					return unit;
+			for (const auto& system : UserSystems)
+				if (const auto& unit{ system->resolve(s) }; unit.has_value())
+					return unit;
+			return std::nullopt;
+		} };
+
+		if (const auto& unit{ findLengthUnit(s) }; unit.has_value())
+			return unit.value();
+		// areas & volumes *(ex. "m2", "sq ft")*. These are only checked after length units, so a unit with an SI prefix always takes-
+		//  -precedence over a dimension word that is spelled the same way *(i.e. "cu" is a centi-unit, not "cubic")*.
+		if (const auto& [lengthUnit, dimension] { parseDimension(s) }; dimension != 1)
+			if (const auto& unit{ findLengthUnit(std::string{ lengthUnit }) }; unit.has_value())
+				return unit->WithDimension(dimension);
 
 		if (def.has_value())
 			return def.value();
-		throw ex::make_custom_exception<invalid_unit_exception>("Couldn't find any measurement units matching '", s, "'");
+		throw ex::make_custom_exception<invalid_unit_exception>("Couldn't find any measurement units matching '", s, "'", formatSuggestions(getUnitSuggestions().query(s)));
+	}
+
+	/**
+	 * @brief			Gets the measurement system with the given ID.
+	 * @param system	A SystemID other than SystemID::ALL.
+	 * @returns			const System*, or nullptr if there is no system with the given ID.
+	 */
+	inline const System* getSystem(const SystemID system) noexcept
+	{
+		for (const auto* it : BuiltinSystems)
+			if (it->base->GetSystemID() == system)
+				return it;
+		return nullptr;
+	}
+
+	/**
+	 * @brief	Compact & stable identifier for a unit, which can be exchanged with other processes.
+	 *\n		The layout is 0xDDSSIIPP, where DD is the dimension exponent minus 1, SS is the SystemID, II is the index of the unit in its system, and PP is the SI prefix exponent.
+	 */
+	using unit_id_t = uint32_t;
+
+	/**
+	 * @brief		Gets the unit ID of the given unit.
+	 * @param unit	A unit returned by getUnit().
+	 * @returns		The unit ID when successful; otherwise std::nullopt.
+	 */
+	inline std::optional<unit_id_t> getUnitID(Unit const& unit)
+	{
+		const auto* system{ getSystem(unit.GetSystemID()) };
+		if (system == nullptr)
+			return std::nullopt;
+		const auto* prefix{ getSIPrefixInfo(unit.GetPrefix()) };
+		for (size_t i{ 0 }; i < system->units.size(); ++i) {
+			const auto& candidate{ (prefix == nullptr ? system->units[i] : system->units[i].ApplyPrefix(*prefix)).WithDimension(unit.GetDimension()) };
+			if (candidate.GetSymbol() == unit.GetSymbol() && candidate.GetFullName(false) == unit.GetFullName(false)) {
+				return (static_cast<unit_id_t>(unit.GetDimension() - 1) << 24)
+					| (static_cast<unit_id_t>(static_cast<uint8_t>(unit.GetSystemID())) << 16)
+					| (static_cast<unit_id_t>(i) << 8)
+					| static_cast<unit_id_t>(static_cast<uint8_t>(unit.GetPrefix()));
+			}
+		}
+		return std::nullopt;
+	}
+
+	/**
+	 * @brief		Retrieve the unit specified by a unit ID.
+	 * @param id	A unit ID returned by getUnitID().
+	 * @returns		Unit
+	 */
+	inline Unit getUnitByID(const unit_id_t id)
+	{
+		const auto* system{ getSystem(static_cast<SystemID>((id >> 16) & 0xFF)) };
+		const size_t index{ (id >> 8) & 0xFF };
+		const auto prefix{ static_cast<SIPrefix>(static_cast<int8_t>(id & 0xFF)) };
+		const unsigned dimension{ (id >> 24) + 1 };
+
+		if (system == nullptr || index >= system->units.size() || dimension > MAX_DIMENSION)
+			throw ex::make_custom_exception<invalid_unit_exception>("Unit ID '", id, "' doesn't refer to a valid measurement unit!");
+		if (prefix == SIPrefix::BASE)
+			return system->units[index].WithDimension(dimension);
+		if (const auto* info{ getSIPrefixInfo(prefix) }; info != nullptr && system->siPrefixable)
+			return system->units[index].ApplyPrefix(*info).WithDimension(dimension);
+		throw ex::make_custom_exception<invalid_unit_exception>("Unit ID '", id, "' doesn't refer to a valid measurement unit!");
 	}
 	//inline Unit getUnit(const std::string& str, const std::optional<Unit>& def = std::nullopt)
 	//{
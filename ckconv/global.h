@@ -1,9 +1,25 @@
 #pragma once
 #include <color-sync.hpp>
 
+#include <charconv>
+#include <span>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 namespace ckconv {
+	/// @brief	The format that conversion results are written in.
+	enum class OutputFormat : unsigned char {
+		/// @brief	Human-readable expressions, i.e. "10 u = 0.142875 m".
+		HUMAN,
+		/// @brief	One JSON object per line.
+		JSONL,
+		/// @brief	Comma-separated values with a header row.
+		CSV,
+		/// @brief	Tab-separated values with a header row.
+		TSV,
+	};
+
 	static struct {
 		/// @brief	Color synchronization object
 		color::sync csync{};
@@ -29,6 +45,9 @@ namespace ckconv {
 
 		bool quiet{ false };
 		bool useFullNames{ false };
+		/// @brief	When true, conversions with multiple output units are printed on one row instead of one row per output unit.
+		bool wideRows{ false };
+		OutputFormat outputFormat{ OutputFormat::HUMAN };
 		std::optional<size_t> precision{};
 		std::optional<std::ios_base::fmtflags> floatfield{};
 		std::optional<size_t> indent{};
@@ -60,10 +79,76 @@ namespace ckconv {
 		return ss.str();
 	}
 
+	/**
+	 * @brief			Appends a number to the given string using the same format as format_fp(), without creating a temporary stream.
+	 *\n				Falls back to format_fp() for hexadecimal notation & numbers that don't fit in the stack buffer.
+	 * @param out		The string to append to.
+	 * @param value		The number to format.
+	 */
+	inline void append_fp(std::string& out, const long double value)
+	{
+		const auto floatfield{ global.floatfield.value_or(std::ios_base::fmtflags{}) };
+		std::chars_format format;
+		if (floatfield == std::ios_base::fmtflags{})
+			format = std::chars_format::general;
+		else if (floatfield == std::ios_base::fixed)
+			format = std::chars_format::fixed;
+		else if (floatfield == std::ios_base::scientific)
+			format = std::chars_format::scientific;
+		else {
+			out += format_fp(value);
+			return;
+		}
+		// streams use a precision of 6 by default
+		const int precision{ static_cast<int>(global.precision.value_or(6ull)) };
+
+		char buffer[64];
+		const auto& [end, ec] { std::to_chars(buffer, buffer + sizeof(buffer), value, format, precision) };
+		if (ec != std::errc{}) {
+			out += format_fp(value);
+			return;
+		}
+		std::string_view s{ buffer, static_cast<size_t>(end - buffer) };
+		if (!global.precision.has_value() && format == std::chars_format::fixed) {
+			// remove trailing zeros for brevity if the numeric precision wasn't explicitly specified
+			while (s.ends_with('0'))
+				s.remove_suffix(1);
+			if (s.ends_with('.'))
+				s.remove_suffix(1);
+		}
+		out += s;
+	}
+
+	/**
+	 * @brief			Gets the value that append_fp() displays a number as, i.e. 11.9999996 is displayed as 12 with the default precision.
+	 * @param value		The number to round.
+	 * @returns			The displayed value, or the number itself when it is displayed in hexadecimal notation.
+	 */
+	inline long double round_fp(const long double value)
+	{
+		std::string s;
+		append_fp(s, value);
+		long double rounded;
+		if (const auto& [end, ec] { std::from_chars(s.data(), s.data() + s.size(), rounded) }; ec != std::errc{} || end != s.data() + s.size())
+			return value;
+		return rounded;
+	}
+
 	inline std::string format_unit(conv::Unit const& unit, const bool plural)
 	{
 		return  (global.useFullNames && unit.HasFullName() ? unit.GetFullName() : unit.GetSymbol());
 	}
+	/// @brief	Formats the units of a compound output unit, joined by '+'. *(i.e. "ft+in", see Compound.hpp)*
+	inline std::string format_unit(std::span<const conv::Unit> units, const bool plural)
+	{
+		std::string s;
+		for (const auto& unit : units) {
+			if (!s.empty())
+				s += '+';
+			s += format_unit(unit, plural);
+		}
+		return s;
+	}
 
 	struct converted {
 		conv::Unit inUnit, outUnit;
@@ -111,4 +196,51 @@ namespace ckconv {
 			return os << c.getExpression();
 		}
 	};
+
+	/**
+	 * @struct	converted_many
+	 * @brief	The results of converting one input value to several output units, printed on a single row.
+	 */
+	struct converted_many {
+		conv::Unit inUnit;
+		long double inValue;
+		std::vector<std::pair<conv::Unit, long double>> outputs;
+
+		std::string getExpression() const
+		{
+			std::stringstream ss;
+
+			if (!global.quiet) {
+				const auto& inValue_s{ format_fp(inValue) }, inUnit_s{ format_unit(inUnit, inValue != 1.0) };
+				const size_t margin{ global.indent.has_value() ? global.indent.value() - 1ull : 0ull };
+				const size_t used{ inValue_s.size() + 1ull + inUnit_s.size() };
+				ss
+					<< global.csync(global.InputColor) << inValue_s << global.csync() << ' '
+					<< global.csync(global.UnitColor) << inUnit_s << global.csync()
+					<< indent(margin, used)
+					;
+			}
+
+			bool first{ true };
+			for (const auto& [outUnit, outValue] : outputs) {
+				if (!global.quiet)
+					ss << " = ";
+				else if (!first)
+					ss << '\t';
+				first = false;
+
+				ss << global.csync(global.ResultColor) << format_fp(outValue) << global.csync();
+
+				if (!global.quiet)
+					ss << ' ' << global.csync(global.UnitColor) << format_unit(outUnit, outValue != 1.0) << global.csync();
+			}
+
+			return ss.str();
+		}
+
+		friend std::ostream& operator<<(std::ostream& os, const converted_many& c)
+		{
+			return os << c.getExpression();
+		}
+	};
 }
@@ -0,0 +1,60 @@
+/**
+ * @file	ckconv_accuracy.cpp
+ * @author	radj307
+ * @brief	Prints the accuracy report from Accuracy.hpp, and fails when a numeric path that ckconv uses is less accurate than the threshold.
+ *\n
+ *\n		Usage:  ckconv_accuracy [--samples <#>] [--max-ulp <#>]
+ *\n		  --samples <#>		The number of generated samples. *(default: 100000)*
+ *\n		  --max-ulp <#>		The largest error that a checked path may have on the generated samples, in units in the last place. *(default: 4)*
+ */
+#include "test.hpp"
+#include "../util.h"
+#include "../Accuracy.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+/// @brief	The paths that ckconv uses to convert values; the other paths are only reported.
+static constexpr std::array<std::string_view, 3> CHECKED_PATHS{ "factor", "convert -> double", "factor (double)" };
+
+int main(const int argc, char** argv)
+{
+	using namespace ckconv;
+
+	size_t samples{ accuracy::DEFAULT_SAMPLE_COUNT };
+	long double maxULP{ 4.0L };
+	try {
+		for (int i{ 1 }; i < argc; ++i) {
+			if (i + 1 < argc && std::strcmp(argv[i], "--samples") == 0)
+				samples = std::stoull(argv[++i]);
+			else if (i + 1 < argc && std::strcmp(argv[i], "--max-ulp") == 0)
+				maxULP = std::stold(argv[++i]);
+			else {
+				std::cerr << "Usage: " << argv[0] << " [--samples <#>] [--max-ulp <#>]" << std::endl;
+				return 2;
+			}
+		}
+	} catch (const std::exception& ex) {
+		std::cerr << "Invalid argument: " << ex.what() << std::endl;
+		return 2;
+	}
+
+	std::ios_base::sync_with_stdio(false);
+	const auto& report{ accuracy::printReport(std::cout, samples) };
+	std::cout.flush();
+
+	for (const auto& path : report.paths) {
+		if (std::find(CHECKED_PATHS.begin(), CHECKED_PATHS.end(), path.name) == CHECKED_PATHS.end())
+			continue;
+		if (path.maxGeneratedULP > maxULP) {
+			std::cerr << "Path '" << path.name << "' has an error of " << static_cast<double>(path.maxGeneratedULP) << " ULP, which is more than " << static_cast<double>(maxULP) << " ULP." << std::endl;
+			++test::failures;
+		}
+	}
+	CHECK(report.appendFormatErrors == 0);
+
+	return test::result();
+}
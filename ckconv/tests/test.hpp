@@ -0,0 +1,39 @@
+#pragma once
+/**
+ * @file	test.hpp
+ * @author	radj307
+ * @brief	Minimal check macros shared by the test executables, which are run by CTest. A test fails when its executable returns non-zero.
+ */
+#include <iostream>
+#include <string_view>
+
+namespace ckconv::test {
+	/// @brief	The number of checks that failed so far.
+	inline int failures{ 0 };
+
+	/// @brief	Prints & counts a failed check.
+	inline void fail(std::string_view const& expression, const char* file, const int line)
+	{
+		std::cerr << file << ':' << line << ": check failed: " << expression << std::endl;
+		++failures;
+	}
+
+	/// @brief	Returns true when two numbers are equal, within the given relative tolerance.
+	constexpr bool near(const long double a, const long double b, const long double tolerance = 1e-12L) noexcept
+	{
+		const long double difference{ a < b ? b - a : a - b };
+		const long double magnitude{ (a < 0 ? -a : a) > (b < 0 ? -b : b) ? (a < 0 ? -a : a) : (b < 0 ? -b : b) };
+		return difference <= tolerance * magnitude;
+	}
+
+	/// @brief	Gets the exit code of a test executable, after printing the number of failed checks.
+	inline int result()
+	{
+		if (failures != 0)
+			std::cerr << failures << " check(s) failed." << std::endl;
+		return failures == 0 ? 0 : 1;
+	}
+}
+
+/// @brief	Checks a condition, and reports it with its location when it's false. Execution continues either way.
+#define CHECK(expression) ((expression) ? (void)0 : ::ckconv::test::fail(#expression, __FILE__, __LINE__))
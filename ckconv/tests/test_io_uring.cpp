@@ -0,0 +1,235 @@
+/**
+ * @file	test_io_uring.cpp
+ * @author	radj307
+ * @brief	Round-trips multi-block files through the io_uring reader & writer in IoUring.hpp, & through the portable path that is used-
+ *\n		 -instead with --no-io-uring. The io_uring checks are skipped when the kernel doesn't support it.
+ */
+#include "test.hpp"
+#include "../CompressedStream.hpp"
+
+#include <sysarch.h>
+
+#ifdef OS_LINUX
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+	/// @brief	A small block size, so the files below span many blocks.
+	constexpr size_t TEST_BLOCK_SIZE{ 4096 };
+
+	/// @brief	Generates text that doesn't contain '#', which is used to mark writes that bypass the writer.
+	std::string makeData(const size_t size)
+	{
+		std::string data;
+		data.reserve(size);
+		for (size_t i{ 0 }; data.size() < size; ++i)
+			data += std::to_string(i * 7919 % 100003) + (i % 8 == 7 ? '\n' : ' ');
+		data.resize(size);
+		return data;
+	}
+
+	/// @brief	A temporary file that is removed when destroyed.
+	struct TempFile {
+		std::string path;
+		int fd;
+
+		TempFile() : path{ "/tmp/ckconv_test_io_uring_XXXXXX" }, fd{ mkstemp(path.data()) } {}
+		~TempFile()
+		{
+			if (fd != -1)
+				close(fd);
+			unlink(path.c_str());
+		}
+
+		void write(std::string_view const& data) const
+		{
+			for (size_t pos{ 0 }; pos < data.size(); ) {
+				const ssize_t count{ ::write(fd, data.data() + pos, data.size() - pos) };
+				if (count <= 0)
+					return;
+				pos += static_cast<size_t>(count);
+			}
+		}
+		std::string read() const
+		{
+			std::string contents(static_cast<size_t>(lseek(fd, 0, SEEK_END)), '\0');
+			size_t pos{ 0 };
+			for (ssize_t count; pos < contents.size() && (count = pread(fd, contents.data() + pos, contents.size() - pos, static_cast<off_t>(pos))) > 0; )
+				pos += static_cast<size_t>(count);
+			contents.resize(pos);
+			return contents;
+		}
+	};
+
+	/// @brief	Reads everything from a file descriptor through a DecompressingStreamBuf, which uses io_uring when it's enabled & supported.
+	std::string readStream(const int fd)
+	{
+		ckconv::io::DecompressingStreamBuf buffer{ fd, false };
+		return { std::istreambuf_iterator<char>{ &buffer }, std::istreambuf_iterator<char>{} };
+	}
+
+#ifdef ENABLE_IO_URING
+	/// @brief	Reads a file through a uring::FileReader, starting at its current position.
+	std::string readBlocks(ckconv::io::uring::FileReader& reader)
+	{
+		std::string contents;
+		for (std::string_view block; !(block = reader.next()).empty(); )
+			contents += block;
+		return contents;
+	}
+
+	void checkReader(const size_t size)
+	{
+		TempFile file;
+		const std::string data{ makeData(size) };
+		file.write(data);
+
+		// reading starts at the current position, & the position is left after the data that was read
+		const off_t START{ std::min<off_t>(100, static_cast<off_t>(size)) };
+		lseek(file.fd, START, SEEK_SET);
+		{
+			const auto& reader{ ckconv::io::uring::FileReader::open(file.fd, TEST_BLOCK_SIZE) };
+			CHECK(reader != nullptr);
+			if (reader == nullptr)
+				return;
+			CHECK(readBlocks(*reader) == data.substr(static_cast<size_t>(START)));
+		}
+		CHECK(lseek(file.fd, 0, SEEK_CUR) == static_cast<off_t>(data.size()));
+	}
+
+	void checkWriter(const size_t size)
+	{
+		TempFile file;
+		const std::string data{ makeData(size) };
+		// a duplicate shares the file position, like STDERR when both are redirected with "> out.txt 2>&1"
+		const int other{ dup(file.fd) };
+
+		std::string markers;
+		{
+			const auto& writer{ ckconv::io::uring::FileWriter::open(file.fd, TEST_BLOCK_SIZE) };
+			CHECK(writer != nullptr);
+			if (writer == nullptr) {
+				close(other);
+				return;
+			}
+			std::ostream os{ writer.get() };
+			// uneven chunks, with direct writes in between that must not be overwritten by the blocks that are in flight
+			for (size_t pos{ 0 }, i{ 0 }; pos < data.size(); ++i) {
+				const size_t length{ std::min(data.size() - pos, 1000 + i * 37 % 3000) };
+				os.write(data.data() + pos, static_cast<std::streamsize>(length));
+				pos += length;
+				if (i % 5 == 0) {
+					const std::string marker{ "#" + std::to_string(i) + "#" };
+					CHECK(::write(other, marker.data(), marker.size()) == static_cast<ssize_t>(marker.size()));
+					markers += marker;
+				}
+			}
+			os.flush();
+		}
+		close(other);
+
+		// the file position is after everything that was written
+		CHECK(lseek(file.fd, 0, SEEK_CUR) == static_cast<off_t>(data.size() + markers.size()));
+		const std::string contents{ file.read() };
+		CHECK(contents.size() == data.size() + markers.size());
+		// the markers are intact & in order, & removing them leaves the data that was written through the stream
+		std::string found, remaining;
+		for (size_t pos{ 0 }; pos < contents.size(); ) {
+			if (contents[pos] == '#') {
+				const size_t end{ contents.find('#', pos + 1) };
+				CHECK(end != std::string::npos);
+				if (end == std::string::npos)
+					break;
+				found += contents.substr(pos, end + 1 - pos);
+				pos = end + 1;
+			}
+			else remaining += contents[pos++];
+		}
+		CHECK(found == markers);
+		CHECK(remaining == data);
+	}
+#endif
+
+	void checkPortable(const size_t size)
+	{
+		TempFile file;
+		const std::string data{ makeData(size) };
+		file.write(data);
+		lseek(file.fd, 0, SEEK_SET);
+		CHECK(readStream(file.fd) == data);
+	}
+
+	/// @brief	Reads from a pipe that is written in small, uneven chunks, so every read returns less than a full block.
+	void checkShortReads(const size_t size)
+	{
+		int fds[2];
+		CHECK(pipe(fds) == 0);
+		const std::string data{ makeData(size) };
+		std::thread producer{ [&data, fd = fds[1]]() {
+			for (size_t pos{ 0 }, i{ 0 }; pos < data.size(); ++i) {
+				const size_t length{ std::min(data.size() - pos, 1 + i * 131 % 700) };
+				const ssize_t count{ ::write(fd, data.data() + pos, length) };
+				if (count <= 0)
+					break;
+				pos += static_cast<size_t>(count);
+			}
+			close(fd);
+		} };
+		CHECK(readStream(fds[0]) == data);
+		producer.join();
+		close(fds[0]);
+	}
+}
+
+int main()
+{
+	using namespace ckconv::io;
+
+	// sizes that are smaller than, equal to, & not multiples of both the test block size & the stream block size
+	const size_t sizes[]{ 1, TEST_BLOCK_SIZE, TEST_BLOCK_SIZE * 9 + 123, BLOCK_SIZE * 3 + 4567 };
+
+	// --no-io-uring
+#ifdef ENABLE_IO_URING
+	uring::enabled = false;
+	{
+		TempFile file;
+		CHECK(uring::FileReader::open(file.fd, TEST_BLOCK_SIZE) == nullptr);
+		CHECK(uring::FileWriter::open(file.fd, TEST_BLOCK_SIZE) == nullptr);
+		CHECK(!uring::AsyncOutput(std::cout, file.fd, TEST_BLOCK_SIZE).isActive());
+	}
+#endif
+	for (const size_t size : sizes) {
+		checkPortable(size);
+		checkShortReads(size);
+	}
+
+#ifdef ENABLE_IO_URING
+	uring::enabled = true;
+	if (const TempFile file; uring::FileReader::open(file.fd, TEST_BLOCK_SIZE) == nullptr)
+		std::cerr << "io_uring isn't available; only the portable path was checked." << std::endl;
+	else {
+		for (const size_t size : sizes) {
+			checkReader(size);
+			checkWriter(size);
+			checkPortable(size);
+		}
+	}
+#endif
+
+	return ckconv::test::result();
+}
+#else
+int main()
+{
+	// io_uring & pipes are only tested on Linux
+	return 0;
+}
+#endif
@@ -0,0 +1,300 @@
+/**
+ * @file	test_plugin.cpp
+ * @author	radj307
+ * @brief	Builds small synthetic plugin files with 20 & 24 byte headers, & checks that Plugin.hpp extracts & rewrites the positions-
+ *\n		 -of their placed references. The plugins have nested groups, XXXX fields, & compressed references that shrink when they're-
+ *\n		 -recompressed after group headers were already flushed, so the rewritten group sizes are compared with the expected output.
+ */
+#include "test.hpp"
+#include "../util.h"
+#include "../Plugin.hpp"
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+	using namespace ckconv::plugin;
+	using ckconv::test::near;
+
+	/// @brief	A placed reference, or a record that has a DATA field which must not be converted.
+	struct Placed {
+		std::string_view type;
+		uint32_t formID;
+		float position[3];
+		/// @brief	True when the record is expected to be converted.
+		bool converted;
+		/// @brief	True when the record is compressed, which requires zlib.
+		bool compressed;
+	};
+
+	/// @brief	A temporary file that is removed when destroyed.
+	struct TempFile {
+		std::filesystem::path path;
+
+		TempFile(std::string const& name) : path{ std::filesystem::temp_directory_path() / ("ckconv_test_plugin_" + name) } {}
+		~TempFile()
+		{
+			std::error_code ec;
+			std::filesystem::remove(path, ec);
+		}
+
+		void write(std::string const& contents) const
+		{
+			std::ofstream ofs{ path, std::ios_base::binary | std::ios_base::trunc };
+			ofs.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+		}
+		std::string read() const
+		{
+			std::ifstream ifs{ path, std::ios_base::binary };
+			std::stringstream ss;
+			ss << ifs.rdbuf();
+			return ss.str();
+		}
+	};
+
+	/// @brief	Builds the records, fields, & groups of a plugin in memory.
+	struct Builder {
+		size_t headerSize;
+
+		std::string header(const uint32_t type, const size_t size, const uint32_t flags, const uint32_t formID) const
+		{
+			std::string s(headerSize, '\0');
+			store32(s.data(), type);
+			store32(s.data() + 4, static_cast<uint32_t>(size));
+			store32(s.data() + 8, flags);
+			store32(s.data() + 12, formID);
+			// version control info, which must be copied as-is
+			for (size_t i{ 16 }; i < headerSize; ++i)
+				s[i] = static_cast<char>(0xA0 + i);
+			return s;
+		}
+		/// @brief	Builds a field, which is preceded by an XXXX field when it's too large for a uint16 size.
+		static std::string field(std::string_view const& type, std::string_view const& data)
+		{
+			std::string s;
+			const auto& append{ [&s](std::string_view const& type, const uint16_t size) {
+				s += type;
+				s += static_cast<char>(size & 0xFF);
+				s += static_cast<char>(size >> 8);
+			} };
+			if (data.size() > UINT16_MAX) {
+				append("XXXX", 4);
+				char size[4];
+				store32(size, static_cast<uint32_t>(data.size()));
+				s.append(size, sizeof(size));
+				append(type, 0);
+			}
+			else append(type, static_cast<uint16_t>(data.size()));
+			s += data;
+			return s;
+		}
+		/// @brief	Builds a DATA field with a position & a rotation.
+		static std::string data(const float(&position)[3])
+		{
+			const float values[6]{ position[0], position[1], position[2], 0.5f, -1.25f, 3.0f };
+			return field("DATA", { reinterpret_cast<const char*>(values), sizeof(values) });
+		}
+		/// @brief	Builds a field with a repeating pattern, which compresses well.
+		static std::string filler(const size_t size)
+		{
+			std::string s(size, '\0');
+			for (size_t i{ 0 }; i < size; ++i)
+				s[i] = static_cast<char>('a' + i % 23);
+			return field("XNAM", s);
+		}
+
+		std::string record(std::string_view const& type, const uint32_t formID, std::string const& fields) const
+		{
+			return header(makeType(type), fields.size(), 0, formID) + fields;
+		}
+	#ifdef ENABLE_ZLIB
+		std::string compressed(std::string_view const& type, const uint32_t formID, std::string const& fields, const int level) const
+		{
+			uLongf length{ compressBound(static_cast<uLong>(fields.size())) };
+			std::string data(4 + length, '\0');
+			store32(data.data(), static_cast<uint32_t>(fields.size()));
+			compress2(reinterpret_cast<Bytef*>(data.data() + 4), &length, reinterpret_cast<const Bytef*>(fields.data()), static_cast<uLong>(fields.size()), level);
+			data.resize(4 + length);
+			return header(makeType(type), data.size(), FLAG_COMPRESSED, formID) + data;
+		}
+	#endif
+		std::string group(const uint32_t label, std::string const& contents) const
+		{
+			return header(TYPE_GRUP, headerSize + contents.size(), 0, label) + contents;
+		}
+		std::string tes4() const
+		{
+			return record("TES4", 0, field("HEDR", std::string(12, '\x01')));
+		}
+	};
+
+	/// @brief	Gets a position multiplied by a factor, the same way that Plugin.hpp converts it.
+	std::array<float, 3> scale(const float(&position)[3], const double factor)
+	{
+		return { static_cast<float>(position[0] * factor), static_cast<float>(position[1] * factor), static_cast<float>(position[2] * factor) };
+	}
+
+	/**
+	 * @brief			Builds the test plugin.
+	 * @param b			Builder with the header size of the plugin.
+	 * @param placed	The records that have a position, in the order they appear in the plugin.
+	 * @param factor	The factor that positions are multiplied by; 1 for the input file, or the conversion factor for the expected output.
+	 * @param stored	When true, compressed records are stored without compression so they shrink when they're rewritten.
+	 */
+	std::string makePlugin(Builder const& b, std::vector<Placed> const& placed, const double factor, [[maybe_unused]] const bool stored)
+	{
+	#ifdef ENABLE_ZLIB
+		const int level{ stored ? Z_NO_COMPRESSION : Z_DEFAULT_COMPRESSION };
+	#endif
+		const auto& data{ [&](Placed const& p) {
+			const auto& xyz{ p.converted ? scale(p.position, factor) : scale(p.position, 1.0) };
+			const float position[3]{ xyz[0], xyz[1], xyz[2] };
+			return Builder::data(position);
+		} };
+
+		std::string inner;
+		// larger than the flush size, so the headers of the groups that contain it are written before the records after it change size
+		inner += b.record(placed[1].type, placed[1].formID, Builder::field("EDID", "large") + Builder::filler(FLUSH_SIZE + 4096) + data(placed[1]));
+	#ifdef ENABLE_ZLIB
+		inner += b.compressed(placed[2].type, placed[2].formID, Builder::field("EDID", "packed") + Builder::filler(4096) + data(placed[2]), level);
+	#endif
+		inner += b.record(placed[3].type, placed[3].formID, data(placed[3]));
+		// a DATA field that is the wrong size for a position
+		inner += b.record("REFR", 0x00000F00, Builder::field("DATA", std::string(12, '\x02')));
+
+		std::string outer;
+		outer += b.record(placed[0].type, placed[0].formID, Builder::field("EDID", "xxxx") + Builder::filler(70000) + data(placed[0]));
+		outer += b.group(0x00000001, inner);
+		outer += b.group(0x00000002, {});
+		outer += b.record(placed[4].type, placed[4].formID, Builder::field("EDID", "static") + data(placed[4]));
+
+		std::string last;
+	#ifdef ENABLE_ZLIB
+		// the header of this group is still buffered when its size changes
+		last += b.compressed(placed[5].type, placed[5].formID, data(placed[5]), level);
+	#endif
+		last += b.record(placed[6].type, placed[6].formID, data(placed[6]));
+
+		return b.tes4() + b.group(makeType("CELL"), b.group(0x00000010, outer)) + b.group(makeType("WRLD"), last);
+	}
+
+	/// @brief	Splits a CSV line.
+	std::vector<std::string> split(std::string const& line)
+	{
+		std::vector<std::string> cells;
+		std::stringstream ss{ line };
+		for (std::string cell; std::getline(ss, cell, ','); )
+			cells.emplace_back(cell);
+		return cells;
+	}
+
+	void checkPlugin(const size_t headerSize)
+	{
+		const Builder b{ headerSize };
+		const std::vector<Placed> placed{
+			{ "REFR", 0x00010001, { 512.0f, 0.0f, -128.0f }, true, false },
+			{ "REFR", 0x00010002, { 128.0f, -256.0f, 64.0f }, true, false },
+			{ "ACHR", 0x00010003, { 1000.5f, 2.0f, -3.0f }, true, true },
+			{ "PGRE", 0x00010004, { 0.0f, 1e6f, -0.125f }, true, false },
+			{ "STAT", 0x00010005, { 7.0f, 8.0f, 9.0f }, false, false },
+			{ "REFR", 0x00010006, { -4096.0f, 4096.0f, 1.0f }, true, true },
+			{ "ACRE", 0x00010007, { 3.5f, -3.5f, 33.0f }, true, false },
+		};
+		size_t expectedCount{ 0 };
+		for (const auto& p : placed) {
+		#ifndef ENABLE_ZLIB
+			if (p.compressed)
+				continue;
+		#endif
+			if (p.converted)
+				++expectedCount;
+		}
+		const auto& u{ conv::getUnit("u") };
+		const auto& m{ conv::getUnit("m") };
+		const double factor{ static_cast<double>(conv::getConversionFactor(u, m)) };
+
+		const std::string name{ std::to_string(headerSize) };
+		TempFile input{ name + ".esp" }, output{ name + ".out.esp" };
+		input.write(makePlugin(b, placed, 1.0, true));
+
+		CHECK(Reader{ input.path }.getHeaderSize() == headerSize);
+
+		// extract
+		std::stringstream ss;
+		CHECK(extract(input.path, u, m, ss) == expectedCount);
+		std::vector<std::vector<std::string>> rows;
+		for (std::string line; std::getline(ss, line); )
+			rows.emplace_back(split(line));
+		CHECK(rows.size() == expectedCount);
+		size_t row{ 0 };
+		for (const auto& p : placed) {
+			if (!p.converted)
+				continue;
+		#ifndef ENABLE_ZLIB
+			if (p.compressed)
+				continue;
+		#endif
+			if (row == rows.size())
+				break;
+			const auto& cells{ rows[row++] };
+			CHECK(cells.size() == 6);
+			if (cells.size() != 6)
+				continue;
+			CHECK(cells[0] == p.type);
+			CHECK(cells[1] == formatFormID(p.formID));
+			for (size_t axis{ 0 }; axis < 3; ++axis)
+				CHECK(near(std::stold(cells[2 + axis]), static_cast<long double>(p.position[axis]) * factor, 1e-9L));
+			CHECK(cells[5] == "m");
+		}
+
+		// rewrite; comparing the whole file also checks the record & group sizes, & that everything else is copied as-is
+		CHECK(rewrite(input.path, output.path, u, m) == expectedCount);
+		const std::string contents{ output.read() };
+		const std::string expected{ makePlugin(b, placed, factor, false) };
+		CHECK(contents.size() == expected.size());
+		CHECK(contents == expected);
+	#ifdef ENABLE_ZLIB
+		// the compressed records shrank, so the group sizes were patched
+		CHECK(contents.size() < std::filesystem::file_size(input.path));
+	#endif
+
+		// the output can't overwrite the plugin that is being read
+		bool threw{ false };
+		try {
+			rewrite(input.path, input.path, u, m);
+		} catch (const std::exception&) {
+			threw = true;
+		}
+		CHECK(threw);
+	}
+}
+
+int main()
+{
+	ckconv::global.outputFormat = ckconv::OutputFormat::CSV;
+	ckconv::global.quiet = true;
+	ckconv::global.precision = 15;
+
+	checkPlugin(24);
+	// Oblivion
+	checkPlugin(20);
+
+	// files that aren't plugins are rejected
+	const TempFile file{ "invalid.esp" };
+	file.write("GRUP");
+	bool threw{ false };
+	try {
+		const Reader reader{ file.path };
+	} catch (const std::exception&) {
+		threw = true;
+	}
+	CHECK(threw);
+
+	return ckconv::test::result();
+}
@@ -0,0 +1,55 @@
+/**
+ * @file	test_quantity.cpp
+ * @author	radj307
+ * @brief	Checks the compile-time quantity types & literals in Quantity.hpp. Most checks are static_asserts, so this fails to build-
+ *\n		 -when a conversion is wrong.
+ */
+#include "test.hpp"
+#include "../Quantity.hpp"
+
+using namespace conv::literals;
+using ckconv::test::near;
+
+// literals have the expected types & values
+static_assert(std::is_same_v<decltype(1.5_m), conv::Meters>);
+static_assert(std::is_same_v<decltype(12_in), conv::Inches>);
+static_assert(std::is_same_v<decltype(128_u), conv::Units>);
+static_assert((3.5_m).count() == 3.5L);
+static_assert((12_ft).count() == 12.0L);
+
+// conversions within a system reduce the ratio first, so they're exact when the reduced ratio is a whole number
+static_assert(conv::Feet{ 12_in }.count() == 1.0L);
+static_assert(conv::Yards{ 36_in }.count() == 1.0L);
+static_assert(conv::Inches{ 1_mi }.count() == 63'360.0L);
+static_assert(near(conv::Miles{ 1760_yd }.count(), 1.0L));
+static_assert(conv::Millimeters{ 1_km }.count() == 1'000'000.0L);
+static_assert(conv::Kilounits{ 2500_u }.count() == 2.5L);
+static_assert(conv::quantity_cast<conv::Centimeters>(2_m).count() == 200.0L);
+
+// conversions between systems
+static_assert(near(conv::Meters{ 1_ft }.count(), 0.3048L));
+static_assert(near(conv::Inches{ 2.54_cm }.count(), 1.0L));
+static_assert(near(conv::Meters{ 1_mi }.count(), 1609.344L));
+static_assert(near(conv::Units{ conv::Meters{ 128_u } }.count(), 128.0L));
+static_assert(near(conv::Feet{ 64_u }.count(), 3.0L, 1e-5L));
+static_assert(near(conv::Meters{ 128_u }.count(), 1.8288L, 1e-5L));
+
+// arithmetic & comparisons convert the right operand to the type of the left operand
+static_assert(std::is_same_v<decltype(1_ft + 6_in), conv::Feet>);
+static_assert((1_ft + 6_in).count() == 1.5L);
+static_assert(near((1_yd - 1_ft).count(), 2.0L / 3.0L));
+static_assert((2 * 3_m).count() == 6.0L);
+static_assert((3_m / 2).count() == 1.5L);
+static_assert(3_m / 1.5_m == 2.0L);
+static_assert(12_in == 1_ft);
+static_assert(1_m > 1_yd);
+static_assert(1_mm < 1_th * 100);
+
+int main()
+{
+	// runtime units give the same results as the compile-time quantity types
+	CHECK(near((128_u).to(conv::getUnit("m")), conv::Meters{ 128_u }.count()));
+	CHECK(near((1_mi).to(conv::getUnit("ft")), 5280.0L));
+	CHECK(near((1_km).to(conv::getUnit("cm")), 100'000.0L));
+	return ckconv::test::result();
+}
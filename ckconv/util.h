@@ -5,25 +5,55 @@
  * @brief	Contains general utility functions for the ckconv application.
  */
 #include "conv.hpp"
+#include "Compound.hpp"
+#include "CompressedStream.hpp"
 
 #include <sysarch.h>
 #include <hasPendingDataSTDIN.h>
 #include <str.hpp>
 
 #include <algorithm>
+#include <array>
 #include <concepts>
 #include <cmath>
 #include <filesystem>
+#include <memory_resource>
+#include <optional>
+#include <ranges>
+#include <string>
+#include <string_view>
 #include <vector>
 
 
 namespace ckconv {
-	// gets piped input from STDIN as a vector of strings, where each element was received as a space-delimited string.
-	inline std::vector<std::string> getInputsFromSTDIN()
+	// a list of input tokens. The list & its strings are allocated from the same memory resource, which may be a BatchArena.
+	using token_list = std::pmr::vector<std::pmr::string>;
+
+	// gets input from a stream as a vector of strings, where each element was received as a space-delimited string.
+	inline token_list getInputs(std::istream& is, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+	{
+		token_list vec{ resource };
+		for (std::string buf; std::getline(is, buf, ' '); is.clear()) { vec.emplace_back(buf); }
+		return vec;
+	}
+	// gets piped input from STDIN as a vector of strings, where each element was received as a space-delimited string. Compressed input is decompressed automatically.
+	inline token_list getInputsFromSTDIN(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
 	{
-		std::vector<std::string> vec;
-		if (hasPendingDataSTDIN())
-			for (std::string buf; std::getline(std::cin, buf, ' '); std::cin.clear()) { vec.emplace_back(buf); }
+		if (!hasPendingDataSTDIN())
+			return token_list{ resource };
+		io::InputStream is;
+		return getInputs(is, resource);
+	}
+
+	// splits a line of input into a vector of strings, where each element was delimited by whitespace.
+	inline token_list splitWhitespace(std::string_view const& line, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+	{
+		token_list vec{ resource };
+		for (size_t pos{ line.find_first_not_of(" \t\v\r\n") }; pos < line.size(); ) {
+			const size_t end{ std::min(line.find_first_of(" \t\v\r\n", pos), line.size()) };
+			vec.emplace_back(line.substr(pos, end - pos));
+			pos = line.find_first_not_of(" \t\v\r\n", end);
+		}
 		return vec;
 	}
 
@@ -42,104 +72,254 @@ namespace ckconv {
 	// defines characters that represent digits
 	inline constexpr auto DIGITS{ "0123456789-." };
 
-	// enumerates a given vector of strings and 'expands' any arguments that contain a number AND a unit, i.e. "250m".
-	inline std::vector<std::string> expandUnits(std::vector<std::string> const& input)
+	// checks if the given string is a word that makes the following unit an area or volume, i.e. "sq" in "sq ft".
+	inline bool isDimensionWord(std::string const& s)
 	{
-		std::vector<std::string> vec;
-		vec.reserve(input.size());
-		for (auto it{ input.begin() }, end{ input.end() }; it != end; ++it) {
-			auto s{ str::trim(std::string(*it), " \t\v\r\n"s) };
-			s.erase(std::remove(s.begin(), s.end(), ','), s.end()); //< erase all commas
-
-			bool
-				digit{ false },			//< has digit chars
-				alpha{ false },			//< has alphabetic chars
-				invalid{ s.empty() };	//< has invalid chars
-			size_t decimalPointCount{ 0ull };
-
-			if (!invalid) {
-				for (const auto& c : s) {
-					if (str::stdpred::isdigit(c))
-						digit = true;
-					else if (str::stdpred::isalpha(c) || c == '\'' || c == '\"')
-						alpha = true;
-					else if (c == '.') {
-						if (++decimalPointCount > 1)
-							throw make_exception("Input '", s, "' isn't valid! (Too many decimal places)");
-					}
-					else if (c == '-') {
-						if (digit) throw make_exception("Input '", s, "' isn't valid! (Negative sign must precede number)");
-					}
-					else {
-						invalid = true;
-						break;
-					}
-				}
+		return str::equalsAny<true>(s, "sq", "sq.", "square", "cu", "cu.", "cubic");
+	}
+
+	// gets the length of the dimension exponent at the end of a unit string, i.e. 2 for "m^2", or 0 if there isn't one.
+	inline size_t getDimensionSuffixLength(std::string const& s)
+	{
+		if (const auto& [unit, dimension] { conv::parseDimension(s) }; dimension != 1 && unit.data() == s.data())
+			return s.size() - unit.size();
+		return 0ull;
+	}
+
+	// checks if the given string starts with a number.
+	inline bool isNumeric(std::string_view const& s)
+	{
+		return !s.empty() && std::string_view{ DIGITS }.find(s.front()) != std::string_view::npos;
+	}
+
+	// checks if the given string is a comma-separated list of units, i.e. "m,ft,in".
+	inline bool isUnitList(std::string_view const& s)
+	{
+		return !isNumeric(s) && s.find(',') != std::string_view::npos;
+	}
+
+	// a sequence of input tokens that can be inspected ahead of time, which is used by expandNext().
+	//  peek(n) gets the nth token after the next one *(0 is the next one)*, or std::nullopt; compound values look up to compound::MAX_TOKENS ahead.
+	template<typename T>
+	concept token_source = requires(T & src, const size_t n) {
+		{ src.empty() } -> std::convertible_to<bool>;
+		{ src.peek() } -> std::convertible_to<std::string_view>;
+		{ src.peek(n) } -> std::same_as<std::optional<std::string_view>>;
+		{ src.take() } -> std::same_as<std::string>;
+	};
+
+	// token_source that reads from an input range of strings or string_views. Tokens are only copied when peek(n) looks past the-
+	//  -next one, so single-pass ranges are supported.
+	template<std::ranges::input_range TRange>
+	class RangeTokenSource {
+		std::ranges::iterator_t<TRange> it;
+		std::ranges::sentinel_t<TRange> end;
+		// tokens that were read ahead by peek(n), which are taken before the rest of the range. This is a ring buffer, so the views-
+		//  -returned by peek(n) stay valid until the token is taken.
+		std::array<std::string, compound::MAX_TOKENS> ahead;
+		size_t head{ 0ull }, count{ 0ull };
+
+	public:
+		RangeTokenSource(TRange& range) : it{ std::ranges::begin(range) }, end{ std::ranges::end(range) } {}
+
+		bool empty() const { return count == 0ull && it == end; }
+		std::string_view peek() const
+		{
+			if (count != 0ull)
+				return ahead[head];
+			return std::string_view{ *it };
+		}
+		std::optional<std::string_view> peek(const size_t n)
+		{
+			if (n == 0ull && count == 0ull)
+				return it == end ? std::nullopt : std::optional<std::string_view>{ peek() };
+			for (; count <= n && count < ahead.size() && it != end; ++it, ++count)
+				ahead[(head + count) % ahead.size()].assign(std::string_view{ *it });
+			if (n >= count)
+				return std::nullopt;
+			return ahead[(head + n) % ahead.size()];
+		}
+		std::string take()
+		{
+			if (count != 0ull) {
+				std::string s{ std::move(ahead[head]) };
+				head = (head + 1ull) % ahead.size();
+				--count;
+				return s;
 			}
+			std::string s(*it);
+			++it;
+			return s;
+		}
+	};
 
-			if (invalid) // check invalid regardless of whether previous if statement triggered or not
-				throw make_exception("Malformed input '", s, "' contains unexpected characters!");
+	// 'expands' the next token from the given source if it contains a number AND a unit, i.e. "250m". The results are written to out, & the number of results (1 or 2) is returned.
+	//  compound values are summed into one number & unit, i.e. "5ft 3in" -> "in", "63", unless compoundValues is false. See Compound.hpp.
+	//   they're disabled when the output unit is set by --to, since the input is then a list of '<VALUE> <UNIT>' pairs & "5 ft 3 in" is two conversions.
+	//  area & volume units are kept together, i.e. "250m2" or "250 sq ft", which may take an additional token from the source.
+	//  lists of output units are kept together, i.e. "m,ft,in" or "m, ft, in", which may take additional tokens from the source.
+	template<token_source TSource>
+	inline size_t expandNext(TSource& src, std::array<std::string, 2>& out, const bool compoundValues = true)
+	{
+		// compound values, i.e. 6'2" or 5 ft 3 in, are summed into a single value in their smallest unit
+		if (const auto& sum{ compoundValues ? compound::parse(src) : std::nullopt }; sum.has_value()) {
+			for (size_t i{ 0ull }; i < sum->tokenCount; ++i)
+				src.take();
+			out[0] = sum->unit->HasSymbol() ? sum->unit->GetSymbol() : sum->unit->GetFullName();
+			out[1] = compound::toString(sum->value);
+			return 2ull;
+		}
 
-			if (digit && alpha) {
-				const size_t alphaPos{ s.find_first_not_of(DIGITS) };
+		auto s{ str::trim(src.take(), " \t\v\r\n"s) };
+		if (isUnitList(s)) {
+			// join lists that were split by whitespace
+			while (s.ends_with(',') && !src.empty() && !isNumeric(src.peek()))
+				s += str::trim(src.take(), " \t\v\r\n"s);
+			// trailing commas separate conversions, they aren't part of the list
+			while (s.ends_with(','))
+				s.pop_back();
+			if (s.find(',') != std::string::npos) {
+				out[0] = std::move(s);
+				return 1ull;
+			}
+		}
+		s.erase(std::remove(s.begin(), s.end(), ','), s.end()); //< erase all commas
+		if (compound::isCompoundUnit(s)) {
+			out[0] = std::move(s);
+			return 1ull;
+		}
 
-				if (s.find_first_of(DIGITS) > alphaPos || s.find_last_of(DIGITS) > alphaPos)
-					throw make_exception("Malformed input '", s, "' is invalid!");
+		bool
+			digit{ false },			//< has digit chars
+			alpha{ false },			//< has alphabetic chars
+			invalid{ s.empty() };	//< has invalid chars
+		size_t decimalPointCount{ 0ull };
+		// the dimension exponent is excluded from validation, since it's part of the unit
+		const size_t unitEnd{ s.size() - getDimensionSuffixLength(s) };
+
+		if (!invalid) {
+			for (const auto& c : std::string_view{ s }.substr(0ull, unitEnd)) {
+				if (str::stdpred::isdigit(c))
+					digit = true;
+				else if (str::stdpred::isalpha(c) || c == '\'' || c == '\"')
+					alpha = true;
+				else if (c == '.') {
+					if (++decimalPointCount > 1)
+						throw make_exception("Input '", s, "' isn't valid! (Too many decimal places)");
+				}
+				else if (c == '-') {
+					if (digit) throw make_exception("Input '", s, "' isn't valid! (Negative sign must precede number)");
+				}
+				else {
+					invalid = true;
+					break;
+				}
+			}
+		}
 
-				vec.reserve(vec.capacity() + 1ull);
-				vec.emplace_back(s.substr(alphaPos));
-				vec.emplace_back(s.substr(0ull, alphaPos));
+		if (invalid) // check invalid regardless of whether previous if statement triggered or not
+			throw make_exception("Malformed input '", s, "' contains unexpected characters!");
+
+		// appends the next argument to a dimension word, i.e. "sq" + "ft". "cu" is also a unit *(centi-unit)*, so the words are only-
+		//  -joined when the next argument isn't a number & the result is a unit; otherwise "5 m cu 10 m ft" would swallow the "10".
+		const auto& withDimensionWord{ [&src](std::string&& unit) {
+			if (isDimensionWord(unit) && !src.empty() && !isNumeric(src.peek())) {
+				std::string joined{ unit + ' ' + str::trim(std::string{ src.peek() }, " \t\v\r\n"s) };
+				try {
+					conv::getUnit(joined);
+				} catch (const std::exception&) {
+					return std::move(unit);
+				}
+				src.take();
+				return joined;
 			}
-			else vec.emplace_back(s);
+			return std::move(unit);
+		} };
+
+		if (digit && alpha) {
+			const size_t alphaPos{ s.find_first_not_of(DIGITS) };
+
+			if (s.find_first_of(DIGITS) > alphaPos || s.find_last_of(DIGITS, unitEnd - 1ull) > alphaPos)
+				throw make_exception("Malformed input '", s, "' is invalid!");
+
+			out[0] = withDimensionWord(s.substr(alphaPos));
+			out[1] = s.substr(0ull, alphaPos);
+			return 2ull;
+		}
+		else if (alpha) out[0] = withDimensionWord(std::move(s));
+		else out[0] = std::move(s);
+		return 1ull;
+	}
+
+	// enumerates a given vector of strings and 'expands' any arguments that contain a number AND a unit, i.e. "250m". See expandNext().
+	//  the result is allocated from the same memory resource as the input. compoundValues is passed to expandNext().
+	inline token_list expandUnits(token_list const& input, const bool compoundValues = true)
+	{
+		token_list vec{ input.get_allocator() };
+		vec.reserve(input.size());
+		RangeTokenSource src{ input };
+		for (std::array<std::string, 2> out; !src.empty(); ) {
+			const size_t count{ expandNext(src, out, compoundValues) };
+			for (size_t i{ 0ull }; i < count; ++i)
+				vec.emplace_back(std::move(out[i]));
 		}
-		vec.shrink_to_fit();
 		return vec;
 	}
 
+	// an operation parsed from the input; the input unit, input value, & output unit(s), in that order.
+	using operation = std::tuple<std::pmr::string, std::pmr::string, std::pmr::string>;
+	// a list of operations, which is allocated from the same memory resource as its tokens.
+	using operation_list = std::pmr::vector<operation>;
+
+	// creates an operation from a group of 3 (or 2) tokens, where missing tokens are empty. The input unit & value are swapped if they were specified in the opposite order.
+	inline operation makeOperation(std::pmr::string&& first, std::pmr::string&& second, std::pmr::string&& third)
+	{
+		if (std::all_of(first.begin(), first.end(), [](auto&& ch) { return str::stdpred::isdigit(ch) || ch == '-' || ch == '.'; }))
+			return{ std::move(second), std::move(first), std::move(third) };
+		return{ std::move(first), std::move(second), std::move(third) };
+	}
+
 	// Splits a given vector of strings into a vector of 3-string tuples. Also sorts entries into the correct order, so that input units are defined first, them the input value, then the output unit.
-	inline WINCONSTEXPR std::vector<std::tuple<std::string, std::string, std::string>> processInput(std::vector<std::string> const& input)
+	//  when outputUnits isn't empty, the input is split into pairs instead & outputUnits is used as the output unit of each tuple.
+	//  the result is allocated from the same memory resource as the input.
+	inline WINCONSTEXPR operation_list processInput(token_list const& input, std::string_view const& outputUnits = {})
 	{
-		std::vector<std::tuple<std::string, std::string, std::string>> vec;
+		operation_list vec{ input.get_allocator() };
 
 		const size_t inputSize{ input.size() };
 		if (inputSize == 0ull) return vec;
 
+		const size_t groupSize{ outputUnits.empty() ? 3ull : 2ull };
+
 		// calculate the amount of space required & reserve it
-		size_t size{ $c(size_t, ceil($c(double, input.size()) / 3.0)) };
+		size_t size{ $c(size_t, ceil($c(double, input.size()) / $c(double, groupSize))) };
 		vec.reserve(size);
 
-		// insert each pair of 3 into the new vector
-		for (size_t i{ 0ull }; i < inputSize; i += 3) {
-			std::tuple<std::string, std::string, std::string> tpl;
-			if (i + 2 >= inputSize) {
-				bool secondResult{};
-				tpl = std::make_tuple(
-					input[i],
-					((secondResult = (i + 1 < inputSize)) ? input[i + 1] : std::string{}),
-					(secondResult && i + 2 < inputSize ? input[i + 2] : std::string{})
-				);
-			}
-			else tpl = std::make_tuple(input[i], input[i + 1], input[i + 2]);
-
-			if (const auto fst{ std::get<0>(tpl) }; std::all_of(fst.begin(), fst.end(), [](auto&& ch) { return str::stdpred::isdigit(ch) || ch == '-' || ch == '.'; })) {
-				// reorder inputs
-				std::get<0>(tpl) = std::get<1>(tpl);
-				std::get<1>(tpl) = fst;
-			}
-
-			vec.emplace_back(tpl);
-		}
+		// insert each group of 3 (or 2) into the new vector
+		const auto& at{ [&input, &inputSize](const size_t i) { return i < inputSize ? std::pmr::string{ input[i], input.get_allocator() } : std::pmr::string{ input.get_allocator() }; } };
+		for (size_t i{ 0ull }; i < inputSize; i += groupSize)
+			vec.emplace_back(makeOperation(at(i), at(i + 1), groupSize == 2ull ? std::pmr::string{ outputUnits, input.get_allocator() } : at(i + 2)));
 
 		//vec.shrink_to_fit(); //< this doesn't have to be called since we precalculated the size
 		return vec;
 	}
 
+	// Parses a comma-separated list of units, i.e. "m,ft,u".
+	inline std::vector<conv::Unit> getUnitList(std::string_view const& list)
+	{
+		std::vector<conv::Unit> vec;
+		for (const auto& name : str::split_all(std::string{ list }, ","))
+			if (const auto& trimmed{ str::trim(name, " \t\v\r\n"s) }; !trimmed.empty())
+				vec.emplace_back(conv::getUnit(trimmed));
+		return vec;
+	}
+
 	// Converts from a tuple of 3 strings to a tuple where the first item is the operand's unit, the second item is the operand, and the third item is the output (or 'target') unit.
 	template<var::numeric T = long double>
-	inline std::tuple<conv::Unit, T, conv::Unit> toConvertible(std::tuple<std::string, std::string, std::string> const& tpl)
+	inline std::tuple<conv::Unit, T, conv::Unit> toConvertible(operation const& tpl)
 	{
-		const auto inValue{ str::stold(std::get<1>(tpl)) };
-		const auto inUnit{ conv::getUnit(std::get<0>(tpl)) }, outUnit{ conv::getUnit(std::get<2>(tpl)) };
+		const auto inValue{ str::stold(std::string{ std::get<1>(tpl) }) };
+		const auto inUnit{ conv::getUnit(std::string{ std::get<0>(tpl) }) }, outUnit{ conv::getUnit(std::string{ std::get<2>(tpl) }) };
 		return{ inUnit, inValue, outUnit };
 	}
 